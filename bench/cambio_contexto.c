@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/my_pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Costo de un cambio de contexto: dos hilos Round Robin se ceden el CPU con
+ * my_thread_yield() y se mide el tiempo por cambio. Se compila dos veces
+ * (bench_cambio_contexto y bench_cambio_contexto_asm) para comparar
+ * swapcontext con el cambio en ensamblador de MY_PTHREAD_ASM_SWITCH.
+ *
+ * Uso: bench_cambio_contexto [cambios_por_hilo]
+ */
+
+#define CAMBIOS_DEFECTO 2000000L
+#define QUANTUM_BENCH_MS 1000   // 1 s: el timer no debe interrumpir la medición
+
+static RR_Scheduler rr;
+static long cambios_por_hilo = CAMBIOS_DEFECTO;
+
+static void ceder(void *arg) {
+    (void)arg;
+    for (long i = 0; i < cambios_por_hilo; i++) {
+        my_thread_yield();
+    }
+}
+
+static double segundos(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    if (getcontext(&scheduler_ctx) == -1) {
+        perror("getcontext scheduler");
+        return 1;
+    }
+    if (argc > 1) {
+        cambios_por_hilo = atol(argv[1]);
+    }
+
+    rr_scheduler_init(&rr, QUANTUM_BENCH_MS);
+    for (int i = 0; i < 2; i++) {
+        if (my_thread_create(ceder, NULL, (Scheduler*)&rr, 1, 0, 0) < 0) {
+            fprintf(stderr, "No se pudo crear el hilo %d\n", i);
+            return 1;
+        }
+    }
+
+    double inicio = segundos();
+    hilo_actual = rr.base.siguiente_hilo((Scheduler*)&rr);
+    swapcontext(&scheduler_ctx, &hilo_actual->context);
+    double total = segundos() - inicio;
+
+#ifdef MY_PTHREAD_ASM_SWITCH
+    const char *modo = "asm";
+#else
+    const char *modo = "swapcontext";
+#endif
+    long cambios = 2 * cambios_por_hilo;
+    printf("%-12s %ld cambios en %.3f s = %.1f ns/cambio\n",
+           modo, cambios, total, total * 1e9 / (double)cambios);
+    return 0;
+}
@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/my_pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Mensajes por segundo entre un productor y un consumidor: my_channel acotado
+ * contra la alternativa sin canales, una lista enlazada protegida con
+ * my_mutex y avisada con my_cond.
+ *
+ * Uso: bench_canales [mensajes] [capacidad_canal]
+ */
+
+#define MENSAJES_DEFECTO  1000000L
+#define CAPACIDAD_DEFECTO 64
+#define QUANTUM_BENCH_MS  1        // quantum de 1 ms: los hilos se desalojan como en uso normal
+
+typedef struct Nodo {
+    long         valor;
+    struct Nodo *siguiente;
+} Nodo;
+
+static RR_Scheduler rr;
+static long mensajes = MENSAJES_DEFECTO;
+static long suma_recibida;
+
+static my_channel canal;
+
+static my_mutex lista_mutex;
+static my_cond  lista_no_vacia;
+static Nodo    *lista_cabeza;
+static Nodo    *lista_cola;
+static int      lista_fin;
+
+static void productor_canal(void *arg) {
+    (void)arg;
+    for (long i = 1; i <= mensajes; i++) {
+        my_channel_send(&canal, (void*)i);
+    }
+    my_channel_close(&canal);
+}
+
+static void consumidor_canal(void *arg) {
+    (void)arg;
+    void *msg;
+    while (my_channel_recv(&canal, &msg) == 0) {
+        suma_recibida += (long)msg;
+    }
+}
+
+static void productor_lista(void *arg) {
+    (void)arg;
+    for (long i = 1; i <= mensajes; i++) {
+        Nodo *nodo = malloc(sizeof(Nodo));
+        nodo->valor     = i;
+        nodo->siguiente = NULL;
+
+        my_mutex_lock(&lista_mutex);
+        if (lista_cola) lista_cola->siguiente = nodo;
+        else            lista_cabeza = nodo;
+        lista_cola = nodo;
+        my_cond_signal(&lista_no_vacia);
+        my_mutex_unlock(&lista_mutex);
+    }
+    my_mutex_lock(&lista_mutex);
+    lista_fin = 1;
+    my_cond_signal(&lista_no_vacia);
+    my_mutex_unlock(&lista_mutex);
+}
+
+static void consumidor_lista(void *arg) {
+    (void)arg;
+    for (;;) {
+        my_mutex_lock(&lista_mutex);
+        while (!lista_cabeza && !lista_fin) {
+            my_cond_wait(&lista_no_vacia, &lista_mutex);
+        }
+        Nodo *nodo = lista_cabeza;
+        if (nodo) {
+            lista_cabeza = nodo->siguiente;
+            if (!lista_cabeza) lista_cola = NULL;
+        }
+        my_mutex_unlock(&lista_mutex);
+
+        if (!nodo) break;
+        suma_recibida += nodo->valor;
+        free(nodo);
+    }
+}
+
+static double segundos(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/*
+ * Corre un productor y un consumidor hasta que ambos terminan e imprime el
+ * caudal. Retorna 0 si llegaron todos los mensajes, 1 si no.
+ */
+static int medir(const char *nombre, void (*productor)(void*), void (*consumidor)(void*)) {
+    suma_recibida = 0;
+    my_thread_create(productor, NULL, (Scheduler*)&rr, 1, 0, 0);
+    my_thread_create(consumidor, NULL, (Scheduler*)&rr, 1, 0, 0);
+
+    double inicio = segundos();
+    hilo_actual = rr.base.siguiente_hilo((Scheduler*)&rr);
+    swapcontext(&scheduler_ctx, &hilo_actual->context);
+    double total = segundos() - inicio;
+
+    printf("%-14s %ld mensajes en %.3f s = %.2f M mensajes/s\n",
+           nombre, mensajes, total, (double)mensajes / total / 1e6);
+    if (suma_recibida != mensajes * (mensajes + 1) / 2) {
+        fprintf(stderr, "%s: se perdieron mensajes\n", nombre);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (getcontext(&scheduler_ctx) == -1) {
+        perror("getcontext scheduler");
+        return 1;
+    }
+    int capacidad = CAPACIDAD_DEFECTO;
+    if (argc > 1) mensajes  = atol(argv[1]);
+    if (argc > 2) capacidad = atoi(argv[2]);
+
+    rr_scheduler_init(&rr, QUANTUM_BENCH_MS);
+    my_channel_init(&canal, capacidad);
+    my_mutex_init(&lista_mutex);
+    my_cond_init(&lista_no_vacia);
+
+    int error = medir("canal", productor_canal, consumidor_canal);
+    error |= medir("mutex+lista", productor_lista, consumidor_lista);
+
+    my_channel_destroy(&canal);
+    my_cond_destroy(&lista_no_vacia);
+    my_mutex_destroy(&lista_mutex);
+    return error;
+}
@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/my_pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Latencia de despacho del EDF_Scheduler según la cantidad de hilos listos.
+ * Cada iteración saca al hilo de menor deadline, le corre el deadline un
+ * período (como una tarea periódica que termina su trabajo) y lo vuelve a
+ * encolar. Los TCB son falsos (sin pila ni contexto): solo se ejercita el
+ * montículo. También verifica que los deadlines salgan en orden.
+ *
+ * Uso: bench_edf_despacho [iteraciones_por_tamano]
+ */
+
+#define ITERACIONES_DEFECTO 2000000L
+#define PERIODO_BENCH 1000000L     // mayor que cualquier deadline inicial
+
+static const int tamanos[] = { 10, 100, 1000, 10000, 100000 };
+static EDF_Scheduler edf;   // queda registrado en el runtime: no puede vivir en la pila
+
+static double segundos(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    long iteraciones = (argc > 1) ? atol(argv[1]) : ITERACIONES_DEFECTO;
+    int error = 0;
+
+    printf("%8s %14s\n", "hilos", "ns/despacho");
+    for (size_t k = 0; k < sizeof(tamanos) / sizeof(tamanos[0]); k++) {
+        int n = tamanos[k];
+        edf_scheduler_init(&edf);
+        Scheduler *sched = (Scheduler*)&edf;
+
+        TCB *hilos = calloc((size_t)n, sizeof(TCB));
+        if (!hilos) {
+            fprintf(stderr, "Sin memoria para %d hilos\n", n);
+            return 1;
+        }
+        uint64_t semilla = 1;
+        for (int i = 0; i < n; i++) {
+            semilla = semilla * 6364136223846793005ULL + 1442695040888963407ULL;
+            hilos[i].tid      = i + 1;
+            hilos[i].state    = BLOCKED;
+            hilos[i].deadline = (long)((semilla >> 33) % PERIODO_BENCH);
+            sched->encolar_hilo(sched, &hilos[i]);
+        }
+
+        long anterior = -1;
+        double inicio = segundos();
+        for (long i = 0; i < iteraciones; i++) {
+            TCB *hilo = sched->siguiente_hilo(sched);
+            if (hilo->deadline < anterior) error = 1;
+            anterior = hilo->deadline;
+            hilo->deadline += PERIODO_BENCH;
+            sched->encolar_hilo(sched, hilo);
+        }
+        double total = segundos() - inicio;
+        printf("%8d %14.1f\n", n, total * 1e9 / (double)iteraciones);
+
+        for (int i = 0; i < n; i++) {
+            sched->remover_hilo(sched, &hilos[i]);
+        }
+        free(hilos);
+    }
+    if (error) {
+        fprintf(stderr, "EDF despachó un deadline fuera de orden\n");
+    }
+    return error;
+}
@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/my_pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*
+ * Escalado del runtime M:N: la misma carga se ejecuta con 1, 2, ..., N
+ * workers y se reporta el tiempo y la aceleración respecto de un worker.
+ * Cada medición corre en un proceso hijo, porque mn_runtime_iniciar solo se
+ * puede llamar una vez por proceso.
+ *
+ *   calculo: hilos Round Robin (quantum de 10 ms) que solo calculan y
+ *            nunca ceden el CPU; sin la alarma de cada worker no habría
+ *            reparto. "primero" es cuándo terminó el primer hilo, como
+ *            fracción del total: cerca de 1 si el quantum los turna a todos.
+ *   ceder:   hilos que llaman a my_thread_yield() en un lazo: mide
+ *            cambios de hilo por segundo entre todos los workers.
+ *
+ * Uso: bench_escalado [max_workers] [hilos]
+ *      (por defecto, los CPUs en línea y 4 hilos por worker máximo)
+ */
+
+#define QUANTUM_BENCH_MS 10
+#define ITERACIONES  40000000L   // cálculo de cada hilo
+#define CESIONES     200000L     // my_thread_yield de cada hilo
+
+static RR_Scheduler rr;
+static volatile uint64_t sumidero;
+static _Atomic long long primero_ns = 0;   // primer hilo en terminar
+
+static long long ahora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void calcular(void *arg) {
+    uint64_t x = (uintptr_t)arg;
+    for (long i = 0; i < ITERACIONES; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    sumidero = x;
+    long long cero = 0;
+    atomic_compare_exchange_strong(&primero_ns, &cero, ahora_ns());
+}
+
+static void ceder(void *arg) {
+    (void)arg;
+    for (long i = 0; i < CESIONES; i++) {
+        my_thread_yield();
+    }
+}
+
+/* Corre una carga con n workers en este proceso; deja en res los segundos y la fracción del primero */
+static int medir(int workers, int hilos, int carga, double res[2]) {
+    if (getcontext(&scheduler_ctx) == -1) {
+        return -1;
+    }
+    rr_scheduler_init(&rr, QUANTUM_BENCH_MS);
+    if (mn_runtime_iniciar(workers) != 0) {
+        return -1;
+    }
+    for (long i = 0; i < hilos; i++) {
+        void (*funcion)(void *) = carga == 0 ? calcular : ceder;
+        if (my_thread_create(funcion, (void*)(i + 1), (Scheduler*)&rr, 1, 0, 0) < 0) {
+            return -1;
+        }
+    }
+    long long inicio = ahora_ns();
+    if (mn_runtime_ejecutar() != 0) {
+        return -1;
+    }
+    long long total = ahora_ns() - inicio;
+    res[0] = (double)total * 1e-9;
+    res[1] = carga == 0 ? (double)(primero_ns - inicio) / (double)total : 0.0;
+    return 0;
+}
+
+/* Mide en un proceso hijo y recibe el resultado por un pipe */
+static int medir_en_hijo(int workers, int hilos, int carga, double res[2]) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        double r[2];
+        int ok = medir(workers, hilos, carga, r) == 0 &&
+                 write(fds[1], r, sizeof r) == (ssize_t)sizeof r;
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t leidos = read(fds[0], res, 2 * sizeof(double));
+    close(fds[0]);
+    int estado;
+    waitpid(pid, &estado, 0);
+    return leidos == (ssize_t)(2 * sizeof(double)) && WIFEXITED(estado) &&
+           WEXITSTATUS(estado) == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_workers = argc > 1 ? atoi(argv[1]) : (cpus > 0 ? (int)cpus : 1);
+    if (max_workers < 1) {
+        max_workers = 1;
+    }
+    int hilos = argc > 2 ? atoi(argv[2]) : 4 * max_workers;
+    if (hilos < 1) {
+        hilos = 1;
+    }
+    printf("CPUs en línea: %ld, hilos por carga: %d\n", cpus, hilos);
+
+    const char *nombres[] = { "calculo", "ceder" };
+    for (int carga = 0; carga < 2; carga++) {
+        double base = 0.0;
+        for (int w = 1; w <= max_workers; w++) {
+            double res[2];
+            if (medir_en_hijo(w, hilos, carga, res) != 0) {
+                fprintf(stderr, "%s con %d workers: la medición falló\n", nombres[carga], w);
+                return 1;
+            }
+            if (w == 1) {
+                base = res[0];
+            }
+            if (carga == 0) {
+                printf("%-8s workers=%-3d %8.3f s  aceleración %5.2fx  primero %3.0f%%\n",
+                       nombres[carga], w, res[0], base / res[0], res[1] * 100.0);
+            } else {
+                double cambios = (double)hilos * (double)CESIONES;
+                printf("%-8s workers=%-3d %8.3f s  aceleración %5.2fx  %6.2f M cambios/s\n",
+                       nombres[carga], w, res[0], base / res[0], cambios / res[0] * 1e-6);
+            }
+        }
+    }
+    return 0;
+}
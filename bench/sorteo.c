@@ -0,0 +1,65 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/my_pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Costo de un sorteo del Lottery_Scheduler según la cantidad de hilos listos.
+ * Cada iteración saca al ganador (siguiente_hilo) y lo vuelve a encolar, igual
+ * que schedule() al vencer el quantum. Los TCB son falsos (sin pila ni
+ * contexto): solo se ejercita la estructura del scheduler.
+ *
+ * Uso: bench_sorteo [iteraciones_por_tamano]
+ */
+
+#define ITERACIONES_DEFECTO 2000000L
+#define TICKETS_MAX 10
+
+static const int tamanos[] = { 10, 100, 1000, 10000, 100000 };
+static Lottery_Scheduler ls;   // queda registrado en el runtime: no puede vivir en la pila
+
+static double segundos(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    long iteraciones = (argc > 1) ? atol(argv[1]) : ITERACIONES_DEFECTO;
+
+    printf("%8s %14s\n", "hilos", "ns/sorteo");
+    for (size_t k = 0; k < sizeof(tamanos) / sizeof(tamanos[0]); k++) {
+        int n = tamanos[k];
+        lottery_scheduler_init(&ls, 100);
+        lottery_scheduler_semilla(&ls, 42);   // misma secuencia en cada corrida
+        Scheduler *sched = (Scheduler*)&ls;
+
+        TCB *hilos = calloc((size_t)n, sizeof(TCB));
+        if (!hilos) {
+            fprintf(stderr, "Sin memoria para %d hilos\n", n);
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            hilos[i].tid     = i + 1;
+            hilos[i].state   = BLOCKED;
+            hilos[i].tickets = 1 + i % TICKETS_MAX;
+            sched->encolar_hilo(sched, &hilos[i]);
+        }
+
+        double inicio = segundos();
+        for (long i = 0; i < iteraciones; i++) {
+            TCB *ganador = sched->siguiente_hilo(sched);
+            sched->encolar_hilo(sched, ganador);
+        }
+        double total = segundos() - inicio;
+        printf("%8d %14.1f\n", n, total * 1e9 / (double)iteraciones);
+
+        for (int i = 0; i < n; i++) {
+            sched->remover_hilo(sched, &hilos[i]);
+        }
+        free(hilos);
+    }
+    return 0;
+}
@@ -2,17 +2,57 @@
 #define MY_PTHREAD_H
 
 #include "scheduler.h"
+#include <sys/types.h>
+#include <sys/socket.h>
 
+typedef struct my_thread_attr {
+    size_t      stack_size;   // bytes de pila (0: por defecto o según el perfil), se redondea a su clase
+    const char *nombre;       // nombre de depuración (se copia), NULL sin nombre
+    long        quantum_us;   // quantum propio, 0: el del scheduler
+    Scheduler  *scheduler;    // scheduler inicial
+    int         tickets;
+    int         priority;
+    long        deadline;     // instante absoluto en reloj_ms(); con periodo_ms > 0 se calcula en cada liberación
+    long        periodo_ms;   // tarea periódica: distancia entre liberaciones, 0: no es periódica
+    long        plazo_ms;     // deadline relativo a cada liberación, 0: igual al período
+    long        desfase_ms;   // primera liberación, relativa a la creación
+    long        wcet_ms;      // peor tiempo de ejecución de un trabajo (control de admisión)
+    int         esporadica;   // 1: cada trabajo lo libera my_thread_release, separados al menos periodo_ms
+} my_thread_attr_t;
+
+int   my_thread_attr_init(my_thread_attr_t *attr);
+int   my_thread_create_attr(void (*func)(void*), void *arg, const my_thread_attr_t *attr);
 int   my_thread_create(void (*func)(void*),
                        void *arg,
                        Scheduler *sched,
                        int tickets,
                        int priority,
                        long deadline);
-void  my_thread_end(void);
+_Noreturn void my_thread_end(void);
+_Noreturn void my_thread_exit(void *retval);
 void  my_thread_yield(void);
-void  my_thread_join(int tid);
+void  my_thread_sleep(long ms);
+void  my_thread_sleep_until(long long instante_ms);
+
+ssize_t my_thread_read(int fd, void *buf, size_t count);
+ssize_t my_thread_write(int fd, const void *buf, size_t count);
+int     my_thread_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+int   my_thread_join(int tid, void **retval);
 int   my_thread_detach(int tid);
+int   my_thread_self(void);
+int   my_thread_setquantum(int tid, long quantum_us);
+int   my_thread_getname(int tid, char *buf, size_t largo);
+int   my_thread_next_job(void);
+int   my_thread_release(int tid);
+int   my_thread_job_stats(int tid, long *trabajos, long *plazos_perdidos);
+void  my_thread_estadisticas_rt(long *trabajos, long *plazos_perdidos);
+
+typedef int my_thread_key_t;
+
+int   my_thread_key_create(my_thread_key_t *clave, void (*destructor)(void*));
+int   my_thread_key_delete(my_thread_key_t clave);
+int   my_thread_setspecific(my_thread_key_t clave, const void *valor);
+void *my_thread_getspecific(my_thread_key_t clave);
 
 typedef struct canvas_position {
     int x;
@@ -28,6 +68,7 @@ typedef struct my_mutex {
     TCB *head;
     TCB *tail;
     CanvasPosition *occupied_positions;
+    struct my_mutex *siguiente_tomado;
 } my_mutex;
 
 /* -------------------------------------------------------------
@@ -38,6 +79,132 @@ int my_mutex_destroy(my_mutex *m);
 int my_mutex_lock(my_mutex *m);
 int my_mutex_trylock(my_mutex *m);
 int my_mutex_unlock(my_mutex *m);
+long my_mutex_inversiones_evitadas(void);
+
+
+typedef struct my_cond {
+    ColaEspera espera;
+} my_cond;
+
+
+typedef struct my_sem {
+    int        valor;
+    ColaEspera espera;
+} my_sem;
+
+
+typedef struct my_barrier {
+    int        total;
+    int        llegados;
+    ColaEspera espera;
+} my_barrier;
+
+
+typedef struct my_rwlock {
+    int        lectores;
+    TCB       *escritor;
+    ColaEspera lectores_espera;
+    ColaEspera escritores_espera;
+} my_rwlock;
+
+
+typedef struct SelectEspera {
+    TCB                 *hilo;
+    int                 *despertado;
+    struct SelectEspera *siguiente;
+} SelectEspera;
+
+typedef struct my_channel {
+    void        **datos;
+    int           capacidad;
+    int           inicio;
+    int           cantidad;
+    int           cerrado;
+    ColaEspera    emisores;
+    ColaEspera    receptores;
+    SelectEspera *selects;
+} my_channel;
+
+typedef struct my_channel_caso {
+    my_channel *canal;
+    int         enviar;
+    void       *msg;
+    int         resultado;
+} my_channel_caso;
+
+
+typedef struct my_future {
+    void              *(*funcion)(void*);
+    void               *arg;
+    void               *valor;
+    int                 listo;
+    ColaEspera          esperando;
+    struct my_executor *ejecutor;
+    struct my_future   *siguiente;
+    struct my_future   *continuaciones;
+} my_future;
+
+typedef struct my_executor {
+    int        n_hilos;
+    int       *tids;
+    my_future *cabeza;
+    my_future *cola;
+    ColaEspera ociosos;
+    int        cerrando;
+} my_executor;
+
+/* -------------------------------------------------------------
+   Prototipos de condiciones, semáforos y barreras
+------------------------------------------------------------- */
+int my_cond_init(my_cond *c);
+int my_cond_destroy(my_cond *c);
+int my_cond_wait(my_cond *c, my_mutex *m);
+int my_cond_timedwait(my_cond *c, my_mutex *m, long long limite_ms);
+int my_cond_signal(my_cond *c);
+int my_cond_broadcast(my_cond *c);
+
+int my_sem_init(my_sem *s, int valor);
+int my_sem_destroy(my_sem *s);
+int my_sem_wait(my_sem *s);
+int my_sem_trywait(my_sem *s);
+int my_sem_post(my_sem *s);
+
+int my_barrier_init(my_barrier *b, int total);
+int my_barrier_destroy(my_barrier *b);
+int my_barrier_wait(my_barrier *b);
+
+/* -------------------------------------------------------------
+   Prototipos del lock de lectores/escritor
+------------------------------------------------------------- */
+int my_rwlock_init(my_rwlock *rw);
+int my_rwlock_destroy(my_rwlock *rw);
+int my_rwlock_rdlock(my_rwlock *rw);
+int my_rwlock_wrlock(my_rwlock *rw);
+int my_rwlock_unlock(my_rwlock *rw);
+
+/* -------------------------------------------------------------
+   Prototipos de canales
+------------------------------------------------------------- */
+int my_channel_init(my_channel *canal, int capacidad);
+int my_channel_destroy(my_channel *canal);
+int my_channel_close(my_channel *canal);
+int my_channel_send(my_channel *canal, void *msg);
+int my_channel_recv(my_channel *canal, void **msg);
+int my_channel_trysend(my_channel *canal, void *msg);
+int my_channel_tryrecv(my_channel *canal, void **msg);
+int my_channel_select(my_channel_caso *casos, int n);
+
+/* -------------------------------------------------------------
+   Prototipos del executor y futuros
+------------------------------------------------------------- */
+int my_executor_init(my_executor *ex, int n_hilos, Scheduler *sched,
+                     int tickets, long deadline);
+int my_executor_shutdown(my_executor *ex);
+my_future *my_executor_submit(my_executor *ex, void *(*funcion)(void*), void *arg);
+my_future *my_future_then(my_future *futuro, void *(*funcion)(void*));
+int my_future_wait(my_future *futuro);
+int my_future_get(my_future *futuro, void **valor);
+int my_future_destroy(my_future *futuro);
 
 
 
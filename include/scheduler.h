@@ -3,6 +3,7 @@
 
 #include <ucontext.h>
 #include <stddef.h>
+#include <stdint.h>
 
 
 
@@ -19,6 +20,16 @@ typedef struct TCB          TCB;
 typedef struct RR_Scheduler RR_Scheduler;
 typedef struct Lottery_Scheduler Lottery_Scheduler;
 typedef struct EDF_Scheduler EDF_Scheduler;
+typedef struct Stride_Scheduler Stride_Scheduler;
+typedef struct RMS_Scheduler RMS_Scheduler;
+typedef struct ColaEspera   ColaEspera;
+struct my_mutex;
+
+#define TLS_CLAVES_MAX  32   // claves de my_thread_key_create disponibles
+#define PILA_TAMANO_DEFECTO (64 * 1024)   // pila de un hilo si no se pide otro tamaño
+#define PILA_TAMANO_MINIMO  (8 * 1024)    // pila más chica que se reserva
+#define HILO_NOMBRE_MAX     16            // largo del nombre de depuración, con el '\0'
+#define RMS_PRIORIDADES     64            // niveles del scheduler RMS (un bit de mapa_listos por nivel)
 
 /**
  * Scheduler
@@ -34,11 +45,62 @@ typedef struct EDF_Scheduler EDF_Scheduler;
  *
  *   void (*remover_hilo)(Scheduler *self, TCB *t):
  *     – puntero a la función que remueve un hilo (TCB) de la estructura interna.
+ *
+ *   void (*actualizar_hilo)(Scheduler *self, TCB *t):
+ *     – opcional (NULL si no hace falta): reubica un hilo encolado cuyos
+ *       tickets o deadline cambiaron (por ejemplo, por herencia de un mutex).
+ *
+ *   long quantum_us:
+ *     – quantum en microsegundos de sus hilos (0: no se desalojan por tiempo).
+ *
+ *   long utilizacion_ppm, utilizacion_max_ppm:
+ *     – carga (en millonésimas de CPU) de las tareas periódicas admitidas y
+ *       tope del control de admisión (0: no se controla).
+ *
+ *   int desaloja_al_despertar:
+ *     – indicador (0/1) de si un hilo que despierta puede desalojar al actual
+ *       (EDF); en ese caso la alarma también se arma para el próximo
+ *       despertar de la rueda, aunque el hilo no tenga quantum.
+ *
+ *   Scheduler *(*replicar)(Scheduler *self):
+ *     – crea un scheduler vacío con la misma política y parámetros; en modo
+ *       M:N cada worker usa una réplica como cola local. NULL si no hay memoria.
+ *
+ *   Scheduler *origen:
+ *     – scheduler que se anota en los hilos que encola: él mismo, o el
+ *       original si es una réplica.
  */
 struct Scheduler {
     void   (*encolar_hilo)(Scheduler *self, TCB *t);
     TCB   *(*siguiente_hilo)(Scheduler *self);
     void   (*remover_hilo)   (Scheduler *self, TCB *t);
+    void   (*actualizar_hilo)(Scheduler *self, TCB *t);
+    Scheduler *(*replicar)(Scheduler *self);
+    Scheduler *origen;
+    long     quantum_us;
+    long     utilizacion_ppm;
+    long     utilizacion_max_ppm;
+    int      desaloja_al_despertar;
+};
+
+
+/**
+ * ColaEspera
+ *
+ * Cola FIFO de hilos bloqueados en una primitiva de sincronización. Los
+ * hilos se enlazan con su campo next (no están en ninguna cola del scheduler
+ * mientras esperan).
+ *
+ * Campos:
+ *   TCB *head:
+ *     – primer hilo en espera.
+ *
+ *   TCB *tail:
+ *     – último hilo en espera.
+ */
+struct ColaEspera {
+    TCB *head;
+    TCB *tail;
 };
 
 
@@ -56,14 +118,27 @@ struct Scheduler {
  *     – contexto de usuario que almacena registros y stack pointer para
  *       cambio de contexto (swapcontext).
  *
+ *   void *sp:
+ *     – stack pointer guardado por el cambio de contexto en ensamblador
+ *       (solo se usa si se compila con MY_PTHREAD_ASM_SWITCH).
+ *
  *   ThreadState state:
  *     – estado actual del hilo (READY, RUNNING, TERMINATED, BLOCKED, etc.).
  *
  *   Scheduler *scheduler:
  *     – puntero al scheduler al que pertenece este hilo.
  *
+ *   int cola_worker:
+ *     – en modo M:N, worker en cuya cola local está encolado (-1 si en
+ *       ninguna); solo es confiable con el lock de ese worker tomado.
+ *
  *   void *stack:
- *     – puntero a la memoria asignada para la pila del hilo.
+ *     – puntero a la memoria asignada para la pila del hilo (justo después
+ *       de la página de guarda PROT_NONE).
+ *
+ *   size_t stack_size:
+ *     – tamaño utilizable de la pila, sin contar la página de guarda (el
+ *       pedido al crear el hilo, redondeado a su clase de tamaño).
  *
  *   TCB *next:
  *     – puntero al siguiente bloque de control en la lista/cola del scheduler.
@@ -73,30 +148,179 @@ struct Scheduler {
  *       probabilidad de ser elegido.
  *
  *   int priority:
- *     – prioridad del hilo (usada si se extiende para schedulers por prioridad).
+ *     – prioridad fija del hilo en un scheduler RMS (0 es la más alta; fuera de
+ *       0..RMS_PRIORIDADES-1 se ajusta al extremo más cercano).
  *
  *   long deadline:
  *     – marca de tiempo límite en milisegundos (usada por scheduler EDF).
  *
- *   TCB *joiner:
- *     – puntero al hilo que está esperando al hilo actual en una operación join.
+ *   ColaEspera joiners:
+ *     – hilos bloqueados en my_thread_join esperando a que este termine.
+ *
+ *   int joins_pendientes:
+ *     – joiners despertados que todavía no han recogido retval; el TCB se
+ *       recicla cuando el último lo recoge.
+ *
+ *   void *retval:
+ *     – valor pasado a my_thread_exit, lo recibe cada joiner.
  *
  *   int detached:
  *     – indicador (0/1) de si el hilo está detached (desvinculado para que
  *       su terminación libere automáticamente recursos).
+ *
+ *   size_t pool_idx:
+ *     – posición del hilo dentro de global_thread_pool.threads, permite
+ *       sacarlo del arreglo en O(1) cuando se recicla.
+ *
+ *   long long despertar_ms:
+ *     – instante (reloj_ms) en que un hilo dormido debe volver a READY.
+ *
+ *   TCB *timer_next, *timer_prev:
+ *     – enlaces de la lista del slot de la rueda de tiempo donde duerme el hilo.
+ *
+ *   TCB **timer_slot:
+ *     – slot de la rueda donde duerme, para sacarlo en O(1) aunque sea la cabeza.
+ *
+ *   int espera_fd:
+ *     – fd por el que el hilo espera E/S, o -1 si no espera ninguno.
+ *
+ *   unsigned espera_eventos:
+ *     – eventos de epoll (EPOLLIN/EPOLLOUT) que espera sobre espera_fd.
+ *
+ *   TCB *es_next:
+ *     – siguiente hilo en la lista de espera del mismo fd.
+ *
+ *   ColaEspera *en_cola:
+ *     – cola de espera (condición, semáforo, barrera) donde está bloqueado, o NULL.
+ *
+ *   int en_rueda:
+ *     – indicador (0/1) de si el hilo está en la rueda de tiempo.
+ *
+ *   int espera_vencida:
+ *     – indicador (0/1) de si su última espera con límite terminó por tiempo.
+ *
+ *   int tickets_propios, long deadline_propio, int priority_propia:
+ *     – tickets, deadline y prioridad asignados al hilo; tickets, deadline y
+ *       priority pueden diferir mientras hereda de hilos que esperan un mutex
+ *       suyo.
+ *
+ *   struct my_mutex *mutex_esperado:
+ *     – mutex en el que el hilo está bloqueado, o NULL.
+ *
+ *   struct my_mutex *mutex_tomados:
+ *     – lista (enlazada por siguiente_tomado) de los mutex que posee el hilo.
+ *
+ *   void *tls[TLS_CLAVES_MAX]:
+ *     – valores del hilo para cada clave de my_thread_key_create (indexado
+ *       directamente por la clave).
+ *
+ *   long quantum_us:
+ *     – quantum propio en microsegundos; 0 usa el de su scheduler.
+ *
+ *   char nombre[HILO_NOMBRE_MAX]:
+ *     – nombre de depuración del hilo (vacío si no se le dio uno).
+ *
+ *   void (*funcion)(void*):
+ *     – función de entrada del hilo (para el perfil de uso de pila).
+ *
+ *   int pila_pintada:
+ *     – indicador (0/1) de si la pila se pintó al crear el hilo y hay que
+ *       medir su uso al reciclarla.
+ *
+ *   int sorteo_pos, sorteo_peso:
+ *     – posición (desde 1; 0 si no está encolado) y boletos con los que
+ *       participa en el árbol de un scheduler Lottery.
+ *
+ *   int monticulo_pos:
+ *     – posición en el montículo de su scheduler (desde 1; 0 si no está).
+ *
+ *   long long pase, pase_desde_ns:
+ *     – pase del hilo en un scheduler Stride y cuándo tomó la CPU por
+ *       última vez (para cobrarle solo la parte del quantum que usó).
+ *
+ *   long long llegada:
+ *     – orden en que entró a la cola EDF (desempata deadlines iguales).
+ *
+ *   long long desaloja_desde_ns:
+ *     – instante en que quedó listo para desalojar al hilo en ejecución (el
+ *       pedido, si lo despertó la rueda); 0 si no espera para desalojar.
+ *
+ *   long periodo_ms, plazo_ms:
+ *     – período (o separación mínima, si es esporádica) y deadline relativo de
+ *       cada trabajo de una tarea periódica; periodo_ms 0 si no lo es.
+ *
+ *   int esporadica:
+ *     – indicador (0/1) de si cada trabajo lo libera my_thread_release.
+ *
+ *   int espera_liberacion, liberaciones_pendientes:
+ *     – la tarea esporádica está bloqueada esperando una liberación, y
+ *       liberaciones pedidas mientras ejecutaba un trabajo.
+ *
+ *   long long liberacion_ms:
+ *     – instante (en la base de reloj_ms) en que se liberó el trabajo actual.
+ *
+ *   long densidad_ppm, Scheduler *admitido_en:
+ *     – carga que aporta la tarea (wcet / min(plazo, período)) y scheduler
+ *       en cuyo control de admisión está contada.
+ *
+ *   long trabajos, plazos_perdidos:
+ *     – trabajos terminados y cuántos de ellos terminaron después del deadline.
  */
 struct TCB {
     int               tid;
     ucontext_t        context;
+    void             *sp;
     ThreadState       state;
     Scheduler        *scheduler;
+    int               cola_worker;
     void             *stack;
+    size_t            stack_size;
     TCB              *next;
     int               tickets;
     int               priority;
     long              deadline;
-    TCB              *joiner;
+    ColaEspera        joiners;
+    int               joins_pendientes;
+    void             *retval;
     int               detached;
+    size_t            pool_idx;
+    long long         despertar_ms;
+    TCB              *timer_next;
+    TCB              *timer_prev;
+    TCB             **timer_slot;
+    int               espera_fd;
+    unsigned          espera_eventos;
+    TCB              *es_next;
+    ColaEspera       *en_cola;
+    int               en_rueda;
+    int               espera_vencida;
+    int               tickets_propios;
+    long              deadline_propio;
+    int               priority_propia;
+    struct my_mutex  *mutex_esperado;
+    struct my_mutex  *mutex_tomados;
+    void             *tls[TLS_CLAVES_MAX];
+    long              quantum_us;
+    char              nombre[HILO_NOMBRE_MAX];
+    void            (*funcion)(void*);
+    int               pila_pintada;
+    int               sorteo_pos;
+    int               sorteo_peso;
+    int               monticulo_pos;
+    long long         pase;
+    long long         pase_desde_ns;
+    long long         llegada;
+    long long         desaloja_desde_ns;
+    long              periodo_ms;
+    long              plazo_ms;
+    int               esporadica;
+    int               espera_liberacion;
+    int               liberaciones_pendientes;
+    long long         liberacion_ms;
+    long              densidad_ppm;
+    Scheduler        *admitido_en;
+    long              trabajos;
+    long              plazos_perdidos;
 };
 
 
@@ -110,7 +334,8 @@ struct TCB {
  *     – parte común de la interfaz (punteros a funciones encolar, siguiente y remover).
  *
  *   int quantum:
- *     – duración del quantum en milisegundos para preempción con setitimer.
+ *     – duración del quantum en milisegundos (base.quantum_us lo guarda en
+ *       microsegundos y se puede ajustar por debajo del milisegundo).
  *
  *   TCB *head:
  *     – puntero al primer hilo en la cola Round Robin.
@@ -129,15 +354,32 @@ struct RR_Scheduler {
 /**
  * Lottery_Scheduler
  *
- * Scheduler de tipo Lottery: mantiene una lista enlazada de hilos con boletos
- * y selecciona aleatoriamente según el número de tickets.
+ * Scheduler de tipo Lottery: guarda los hilos listos en un arreglo compacto y
+ * sus boletos en un árbol de Fenwick (árbol binario indexado) paralelo, de
+ * modo que sortear, encolar, remover y cambiar boletos cuesta O(log n).
  *
  * Campos:
  *   Scheduler base:
  *     – parte común de la interfaz (punteros a funciones encolar, siguiente y remover).
  *
- *   TCB *head:
- *     – puntero al primer hilo en la lista de Lottery.
+ *   TCB **hilos:
+ *     – hilos encolados en las posiciones 1..cantidad (hilos[0] no se usa).
+ *
+ *   long *arbol:
+ *     – árbol de Fenwick de boletos: arbol[i] suma los boletos de las
+ *       posiciones (i - (i & -i), i].
+ *
+ *   int cantidad:
+ *     – cantidad de hilos encolados.
+ *
+ *   int capacidad:
+ *     – tamaño de hilos y arbol (potencia de dos, sin contar la posición 0).
+ *
+ *   long total:
+ *     – suma de los boletos de todos los hilos encolados.
+ *
+ *   uint64_t rng[4]:
+ *     – estado del generador xoshiro256** propio del scheduler.
  *
  *   int quantum:
  *     – duración del quantum en milisegundos para preempción (puede coincidir
@@ -145,41 +387,168 @@ struct RR_Scheduler {
  */
 struct Lottery_Scheduler {
     Scheduler base;
-    TCB      *head;
+    TCB     **hilos;
+    long     *arbol;
+    int       cantidad;
+    int       capacidad;
+    long      total;
+    uint64_t  rng[4];
     int quantum;
 };
 
 
 
 
+/**
+ * Monticulo
+ *
+ * Montículo binario de mínimos de hilos (arreglo desde la posición 1). El
+ * orden lo da una función de comparación del scheduler que lo usa, y cada
+ * hilo guarda su posición en monticulo_pos para poder removerlo en O(log n).
+ *
+ * Campos:
+ *   TCB **nodos:
+ *     – hilos en las posiciones 1..cantidad (nodos[0] no se usa).
+ *
+ *   int cantidad:
+ *     – cantidad de hilos en el montículo.
+ *
+ *   int capacidad:
+ *     – posiciones reservadas en nodos (sin contar la 0).
+ */
+typedef struct {
+    TCB **nodos;
+    int   cantidad;
+    int   capacidad;
+} Monticulo;
+
+
+/**
+ * Stride_Scheduler
+ *
+ * Scheduler de reparto proporcional determinista (stride scheduling): cada
+ * hilo tiene un pase que avanza, por cada quantum de CPU que usa, un paso
+ * inversamente proporcional a sus tickets, y siempre se elige el hilo de menor
+ * pase. Los hilos listos se ordenan en un montículo por pase.
+ *
+ * Campos:
+ *   Scheduler base:
+ *     – parte común de la interfaz (punteros a funciones encolar, siguiente y remover).
+ *
+ *   Monticulo cola:
+ *     – hilos listos ordenados por pase (y por tid si empatan).
+ *
+ *   long long pase_global:
+ *     – pase del último hilo elegido; un hilo que vuelve de dormir o de
+ *       esperar no puede quedar por debajo (no acumula CPU mientras no compite).
+ *
+ *   int quantum:
+ *     – duración del quantum en milisegundos para preempción.
+ */
+struct Stride_Scheduler {
+    Scheduler base;
+    Monticulo cola;
+    long long pase_global;
+    int       quantum;
+};
+
+
 /**
  * EDF_Scheduler
  *
- * Scheduler de tipo EDF (Earliest Deadline First): mantiene una lista enlazada
- * de hilos y siempre elige para ejecución aquel con el deadline más cercano.
+ * Scheduler de tipo EDF (Earliest Deadline First): mantiene los hilos listos
+ * en un montículo ordenado por deadline y siempre elige para ejecución aquel
+ * con el deadline más cercano (O(log n) para encolar, elegir y remover).
  *
  * Campos:
  *   Scheduler base:
  *     – parte común de la interfaz (punteros a funciones encolar, siguiente y remover).
  *
- *   TCB *head:
- *     – puntero al primer hilo en la lista de hilos manejados por EDF.
+ *   Monticulo cola:
+ *     – hilos listos ordenados por deadline y, si empatan, por orden de llegada.
+ *
+ *   long long llegadas:
+ *     – contador de hilos encolados, para desempatar deadlines iguales en orden FIFO.
  */
 struct EDF_Scheduler {
     Scheduler base;
-    TCB      *head;
+    Monticulo cola;
+    long long llegadas;
 };
 
 
+/**
+ * RMS_Scheduler
+ *
+ * Scheduler de prioridades fijas con desalojo (pensado para Rate Monotonic):
+ * una cola FIFO por prioridad y un mapa de bits de las colas no vacías, de
+ * modo que encolar y elegir cuestan O(1) sin importar cuántos hilos haya (la
+ * prioridad más alta con hilos listos es el primer bit encendido).
+ *
+ * Campos:
+ *   Scheduler base:
+ *     – parte común de la interfaz (punteros a funciones encolar, siguiente y remover).
+ *
+ *   TCB *cabeza[RMS_PRIORIDADES], *cola[RMS_PRIORIDADES]:
+ *     – primer y último hilo listo de cada prioridad (enlazados por next).
+ *
+ *   uint64_t mapa_listos:
+ *     – bit p encendido si la cola de la prioridad p no está vacía.
+ *
+ *   int quantum:
+ *     – quantum en milisegundos entre hilos de la misma prioridad (0: FIFO,
+ *       un hilo solo deja la CPU si se bloquea, cede o llega uno más prioritario).
+ */
+struct RMS_Scheduler {
+    Scheduler base;
+    TCB      *cabeza[RMS_PRIORIDADES];
+    TCB      *cola[RMS_PRIORIDADES];
+    uint64_t  mapa_listos;
+    int       quantum;
+};
+
+
+#define TID_BITS_SLOT   20                              // bits del tid para el índice del slot
+#define TID_MASK_SLOT   ((1 << TID_BITS_SLOT) - 1)
+#define TID_MASK_GEN    ((1 << (31 - TID_BITS_SLOT)) - 1)   // bits restantes: generación
+
+
+/**
+ * HiloSlot
+ *
+ * Entrada de la tabla de slots que traduce un tid al TCB en O(1).
+ *
+ * Campos:
+ *   TCB *hilo:
+ *     – hilo que ocupa el slot, o NULL si el slot está libre.
+ *
+ *   unsigned generacion:
+ *     – generación actual del slot; se incrementa cada vez que el slot se
+ *       libera, así un tid viejo que apunte al mismo slot ya no coincide.
+ *
+ *   int siguiente_libre:
+ *     – índice del siguiente slot libre (-1 si no hay), solo válido si el
+ *       slot está libre.
+ */
+typedef struct {
+    TCB     *hilo;
+    unsigned generacion;
+    int      siguiente_libre;
+} HiloSlot;
+
+
 /**
  * ThreadPool
  *
  * Administrador de un conjunto de hilos (TCB) para facilitar
  * creación, registro y manejo global.
  *
+ * Un tid se forma con la generación del slot en los bits altos y el índice
+ * del slot en los TID_BITS_SLOT bits bajos.
+ *
  * Campos:
  *   size_t created_threads_counter:
- *     – contador total de hilos creados (se puede usar como base para tid).
+ *     – contador total de hilos creados.
  *
  *   TCB **threads:
  *     – arreglo dinámico de punteros a TCB, representando todos los hilos registrados.
@@ -190,32 +559,212 @@ struct EDF_Scheduler {
  *   size_t capacity:
  *     – capacidad máxima actual del arreglo, cuando count + 1 > capacity,
  *       se expande el arreglo (realloc).
+ *
+ *   HiloSlot *slots:
+ *     – tabla de slots indexada por la parte baja del tid.
+ *
+ *   size_t slot_count:
+ *     – número de slots usados alguna vez (los libres se reutilizan).
+ *
+ *   size_t slot_capacity:
+ *     – capacidad actual de la tabla de slots.
+ *
+ *   int slot_libre:
+ *     – primer slot de la lista de libres, o -1 si no hay.
  */
 typedef struct {
     size_t created_threads_counter;
     TCB   **threads;
     size_t  count;
     size_t  capacity;
+    HiloSlot *slots;
+    size_t  slot_count;
+    size_t  slot_capacity;
+    int     slot_libre;
 } ThreadPool;
 
 
+/**
+ * EstadisticasSueno
+ *
+ * Precisión de los despertares de la rueda de tiempo.
+ *
+ * Campos:
+ *   long long despertados:
+ *     – cantidad de hilos despertados por la rueda.
+ *
+ *   long long retraso_total_us:
+ *     – suma de los retrasos (instante real menos instante pedido) en microsegundos.
+ *
+ *   long long retraso_max_us:
+ *     – mayor retraso observado en microsegundos.
+ */
+typedef struct {
+    long long despertados;
+    long long retraso_total_us;
+    long long retraso_max_us;
+} EstadisticasSueno;
+
+
+/**
+ * EstadisticasQuantum
+ *
+ * Precisión del temporizador del quantum: cuánto después del instante
+ * programado llegó cada alarma.
+ *
+ * Campos:
+ *   long long alarmas:
+ *     – alarmas del quantum recibidas.
+ *
+ *   long long retraso_total_ns:
+ *     – suma de los retrasos (instante real menos instante programado) en nanosegundos.
+ *
+ *   long long retraso_max_ns:
+ *     – mayor retraso observado en nanosegundos.
+ *
+ *   long long desarmados:
+ *     – veces que un hilo con quantum tomó la CPU sin alarma porque no había
+ *       otro hilo listo para desalojarlo.
+ */
+typedef struct {
+    long long alarmas;
+    long long retraso_total_ns;
+    long long retraso_max_ns;
+    long long desarmados;
+} EstadisticasQuantum;
+
+
+/**
+ * EstadisticasDesalojo
+ *
+ * Latencia de desalojo: desde que un hilo queda listo con más prioridad que
+ * el que ejecuta (para un despertar de la rueda, desde el instante pedido)
+ * hasta que toma la CPU.
+ *
+ * Campos:
+ *   long long desalojos:
+ *     – hilos que desalojaron al hilo en ejecución.
+ *
+ *   long long latencia_total_ns:
+ *     – suma de las latencias en nanosegundos.
+ *
+ *   long long latencia_max_ns:
+ *     – mayor latencia observada en nanosegundos.
+ */
+typedef struct {
+    long long desalojos;
+    long long latencia_total_ns;
+    long long latencia_max_ns;
+} EstadisticasDesalojo;
+
+
+/**
+ * PilaPerfilModo
+ *
+ * Modo del perfil de uso de pila: APAGADO no mide nada; MEDIR pinta la pila
+ * de cada hilo nuevo y mide al reciclarla cuánto llegó a usar; AUTO además
+ * reserva las pilas de los hilos que no piden tamaño según el pico observado
+ * para su función de entrada.
+ */
+typedef enum {
+    PILA_PERFIL_APAGADO,
+    PILA_PERFIL_MEDIR,
+    PILA_PERFIL_AUTO
+} PilaPerfilModo;
+
+
+/**
+ * PerfilPila
+ *
+ * Uso de pila observado para una función de entrada de hilos.
+ *
+ * Campos:
+ *
+ *   void (*funcion)(void*):
+ *     – función de entrada de los hilos medidos.
+ *
+ *   long hilos:
+ *     – cantidad de hilos medidos.
+ *
+ *   size_t pico_max, pico_total:
+ *     – mayor uso de pila observado y suma de los picos (para el promedio), en bytes.
+ *
+ *   size_t pila_tam:
+ *     – tamaño de la pila del último hilo medido.
+ */
+typedef struct {
+    void  (*funcion)(void*);
+    long    hilos;
+    size_t  pico_max;
+    size_t  pico_total;
+    size_t  pila_tam;
+} PerfilPila;
+
+
 extern ThreadPool   global_thread_pool;
-extern TCB         *hilo_actual;
-extern int          next_tid;
+extern _Thread_local TCB *hilo_actual;
 extern ucontext_t   scheduler_ctx;
 extern int scheduler_activo;
+extern int          modo_mn;
 
 
 int    registrar_hilo(ThreadPool *p, TCB *t);
 int    my_thread_chsched(TCB *t, Scheduler *new_sch);
 TCB   *buscar_hilo_id(ThreadPool *p, int tid);
 void   encolar_hilo(Scheduler *sched, TCB *t);
+void   hilo_pesos_cambiados(TCB *t);
+void   recalcular_herencia(TCB *t);
+int    tarea_admitir(Scheduler *sched, TCB *t);
+void   tarea_retirar(TCB *t);
 void   schedule(void);
+_Noreturn void hilo_salir(void);
 void print_all_rr_snapshots(void);
 int threadpool_alive_count(void);
+void   cambiar_estado(TCB *t, ThreadState estado);
+int    hilos_en_estado(ThreadState estado);
+
+TCB   *tcb_pool_obtener(size_t tam_pila);
+void   tcb_pool_devolver(TCB *t);
+int    tcb_pool_precalentar(size_t n);
+void   pila_perfil_modo(PilaPerfilModo modo);
+size_t pila_tamano_para(void (*funcion)(void*), size_t pedido);
+int    pila_pintar(TCB *t);
+int    pila_perfiles(PerfilPila *out, int max);
+void   hilo_terminado(TCB *t);
+void   hilo_reciclar(TCB *t);
+void   preparar_contexto(TCB *t);
+
+long long reloj_ms(void);
+uint64_t  runtime_aleatorio(void);
+void   temporizador_agregar(TCB *t);
+void   temporizador_quitar(TCB *t);
+void   estadisticas_sueno(EstadisticasSueno *out);
+void   estadisticas_quantum(EstadisticasQuantum *out);
+void   estadisticas_desalojo(EstadisticasDesalojo *out);
+int    es_esperar(TCB *t, int fd, unsigned eventos);
+
+void   desalojo_suspender(void);
+void   desalojo_reanudar(void);
+long   desalojos_aplazados(void);
+void   hilo_comenzar(void);
+
+void   cola_espera_init(ColaEspera *cola);
+void   cola_espera_bloquear(ColaEspera *cola, TCB *t, long long limite_ms);
+TCB   *cola_espera_despertar(ColaEspera *cola);
+int    cola_espera_despertar_todos(ColaEspera *cola);
+int    cola_espera_quitar(ColaEspera *cola, TCB *t);
+
+void   runtime_lock(void);
+void   runtime_unlock(void);
+int    mn_runtime_iniciar(int n_workers);
+int    mn_runtime_ejecutar(void);
 
 void   rr_scheduler_init(RR_Scheduler *rr, int quantum_ms);
 void   lottery_scheduler_init(Lottery_Scheduler *ls, int quantum_ms);
+void   lottery_scheduler_semilla(Lottery_Scheduler *ls, uint64_t semilla);
+void   stride_scheduler_init(Stride_Scheduler *ss, int quantum_ms);
 void   edf_scheduler_init(EDF_Scheduler *es);
+void   rms_scheduler_init(RMS_Scheduler *rs, int quantum_ms);
+int    rms_asignar_prioridades(RMS_Scheduler *rs, int primera);
 
 #endif
@@ -0,0 +1,11 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+
+// Crea la clave TLS de los buffers de trabajo de rotate_ascii (una vez, desde main)
+int scratch_init(void);
+
+// Matriz del buffer de trabajo del hilo actual, NULL si no hay memoria
+char **scratch_grid(int height, int width);
+
+#endif
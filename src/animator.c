@@ -12,16 +12,17 @@
 #include <sys/time.h>
 #include "../include/my_pthread.h"
 #include "../include/scheduler.h"
-#include <x86intrin.h>
+#include "../include/scratch.h"
 #include <stdint.h>
 
-#define CPU_HZ 2800000000UL
 #ifdef LINE_MAX
 #undef LINE_MAX
 #endif
 #define LINE_MAX 256
 #define INITIAL_SHAPE_CAP   4
 #define INITIAL_MONITOR_CAP 4
+#define FRAME_MS      100  // período de los cuadros de cada figura
+#define FRAME_WCET_MS 2    // peor costo estimado de un cuadro (control de admisión)
 #ifndef MAX
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #endif
@@ -165,16 +166,22 @@ static void load_shapes_content(Config *cfg) {
 // --- Animación con hilos y ncurses
 
 static WINDOW *win;
-static my_mutex canvas_mutex;
+static my_rwlock canvas_lock;         // ocupación del canvas y dibujo en win
+static CanvasPosition *occupied_positions;   // celdas ocupadas (bajo canvas_lock)
+static _Atomic unsigned long canvas_version; // cambia con cada movimiento (con canvas_lock exclusivo)
+static my_mutex canvas_mutex;         // solo para esperar cambios con canvas_cond
+static my_cond  canvas_cond;
 static Config *global_cfg = NULL;
 
 char **rotate_ascii(char **lines, int h, int w,
                     int rotation, int *out_h, int *out_w)
 {
 
-    char **grid = malloc(sizeof(char*) * h);
+    char **grid = scratch_grid(h, w);
+    if (grid == NULL) {
+        return NULL;
+    }
     for (int i = 0; i < h; i++) {
-        grid[i] = malloc(w+1);
         int len = strlen(lines[i]);
         memcpy(grid[i], lines[i], len);
         memset(grid[i] + len, ' ', w - len);
@@ -240,20 +247,18 @@ char **rotate_ascii(char **lines, int h, int w,
     }
 
 
-    for (int i = 0; i < h; i++) free(grid[i]);
-    free(grid);
     return res;
 }
 
 
 // Función para verificar si un carácter de la figura colisiona
-static int is_position_occupied(my_mutex *mutex, int x, int y, int current_tid) {
+static int is_position_occupied(int x, int y, int current_tid) {
     // Verificar límites del canvas
     if (x < 0 || x >= global_cfg->width || y < 0 || y >= global_cfg->height) {
         return 1;
     }
 
-    CanvasPosition *pos = mutex->occupied_positions;
+    CanvasPosition *pos = occupied_positions;
     while (pos) {
         if (pos->x == x && pos->y == y) {
             // Si la posición está ocupada por otro hilo
@@ -264,17 +269,17 @@ static int is_position_occupied(my_mutex *mutex, int x, int y, int current_tid)
     return 0;
 }
 
-static void occupy_position(my_mutex *mutex, int x, int y, int owner_tid) {
+static void occupy_position(int x, int y, int owner_tid) {
     CanvasPosition *new_pos = malloc(sizeof(CanvasPosition));
     new_pos->x = x;
     new_pos->y = y;
     new_pos->owner_tid = owner_tid;
-    new_pos->next = mutex->occupied_positions;
-    mutex->occupied_positions = new_pos;
+    new_pos->next = occupied_positions;
+    occupied_positions = new_pos;
 }
 
-static void free_position(my_mutex *mutex, int x, int y, int owner_tid) {
-    CanvasPosition **ptr = &mutex->occupied_positions;
+static void free_position(int x, int y, int owner_tid) {
+    CanvasPosition **ptr = &occupied_positions;
     while (*ptr) {
         if ((*ptr)->x == x && (*ptr)->y == y && (*ptr)->owner_tid == owner_tid) {
             CanvasPosition *to_free = *ptr;
@@ -285,24 +290,38 @@ static void free_position(my_mutex *mutex, int x, int y, int owner_tid) {
         ptr = &(*ptr)->next;
     }
 }
-static inline uint64_t rdtsc_counter(void) {
-    return __rdtsc();
+
+// Verifica si todos los caracteres visibles de la forma caben libres en (x, y).
+// Basta con tener canvas_lock en modo compartido.
+static int footprint_free(char **rotated, int rot_h, int rot_w,
+                          int x, int y, int current_tid) {
+    for (int ly = 0; ly < rot_h; ly++) {
+        for (int lx = 0; lx < rot_w; lx++) {
+            if (rotated[ly][lx] != ' ' &&
+                is_position_occupied(x + lx, y + ly, current_tid)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Despierta a las figuras que esperan un cambio (canvas_version ya incrementada)
+static void notify_canvas_change(void) {
+    my_mutex_lock(&canvas_mutex);
+    my_cond_broadcast(&canvas_cond);
+    my_mutex_unlock(&canvas_mutex);
 }
 
-void custom_napms(uint64_t ms) {
-    uint64_t start          = rdtsc_counter();
-    uint64_t target         = start + (CPU_HZ / 1000ULL) * ms;
-    uint64_t last_yield_ts  = start;
-    uint64_t yield_interval = (CPU_HZ / 1000ULL) * 5;  // cede cada 5 ms
-
-    while (rdtsc_counter() < target) {
-        uint64_t now = rdtsc_counter();
-        if (now - last_yield_ts >= yield_interval) {
-            last_yield_ts = now;
-            if (threadpool_alive_count() > 1) my_thread_yield();
+// Espera a que canvas_version deje de valer seen_version o a limit_ms
+static void wait_canvas_change(unsigned long seen_version, long long limit_ms) {
+    my_mutex_lock(&canvas_mutex);
+    while (canvas_version == seen_version) {
+        if (my_cond_timedwait(&canvas_cond, &canvas_mutex, limit_ms) != 0) {
+            break;
         }
-        // si no toca yield, puro spin en usuario
     }
+    my_mutex_unlock(&canvas_mutex);
 }
 
 
@@ -310,8 +329,8 @@ static void draw_explosion(int cx, int cy) {
     const int R = 3;
     int max_y, max_x;
 
-    // 1) Bloqueamos el mutex para no interferir con otros hilos
-    my_mutex_lock(&canvas_mutex);
+    // 1) Tomamos el canvas en exclusivo para no interferir con otros hilos
+    my_rwlock_wrlock(&canvas_lock);
 
     // 2) Obtenemos el tamaño actual de la ventana
     getmaxyx(win, max_y, max_x);
@@ -342,8 +361,7 @@ static void draw_explosion(int cx, int cy) {
         // Refrescamos y pausamos un poco para que se vea la animación
         wrefresh(win);
 
-        if (scheduler_activo != 1) napms(50);
-        else ;
+        my_thread_sleep(50);
 
 
     }
@@ -359,7 +377,7 @@ static void draw_explosion(int cx, int cy) {
 
     wrefresh(win);
 
-    my_mutex_unlock(&canvas_mutex);
+    my_rwlock_unlock(&canvas_lock);
 }
 
 
@@ -377,23 +395,14 @@ void animate_shape(void *arg) {
         orig_w = MAX(orig_w, (int)strlen(sh->shape_lines[k]));
     }
 
-    struct timeval tv0;
-    gettimeofday(&tv0, NULL);
-    long thread_start_ms = tv0.tv_sec*1000 + tv0.tv_usec/1000;
-
-
-    while (1) {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        long now = tv.tv_sec*1000 + tv.tv_usec/1000;
-        if (now - thread_start_ms >= sh->start_time) break;
-        if (scheduler_activo != 1) napms(10);
-        else custom_napms(10);
-
+    // Como tarea periódica el runtime libera el primer cuadro en sh->start_time
+    int periodica = my_thread_job_stats(my_thread_self(), NULL, NULL) == 0;
+    if (!periodica) {
+        my_thread_sleep(sh->start_time);
     }
 
 
-    long deadline_ms = thread_start_ms + sh->start_time + sh->end_time;
+    long deadline_ms = sh->start_ms + sh->start_time + sh->end_time;
 
     int prev_x = sh->x_start, prev_y = sh->y_start;
     int angle_current = 0;
@@ -402,18 +411,20 @@ void animate_shape(void *arg) {
         sh->shape_lines, orig_h, orig_w,
         angle_current, &rot_h_prev, &rot_w_prev
     );
+    if (rotated_prev == NULL) {
+        my_thread_end();    // sin memoria para rotar la forma
+    }
 
-    int current_tid = hilo_actual->tid;
+    int current_tid = my_thread_self();
 
 
-    my_mutex_lock(&canvas_mutex);
+    my_rwlock_wrlock(&canvas_lock);
       wattron(win, COLOR_PAIR(sh->color_pair));
       for (int ly = 0; ly < rot_h_prev; ly++) {
         for (int lx = 0; lx < rot_w_prev; lx++) {
           char c = rotated_prev[ly][lx];
           if (c != ' ') {
-            occupy_position(&canvas_mutex,
-                            prev_x + lx, prev_y + ly,
+            occupy_position(prev_x + lx, prev_y + ly,
                             current_tid);
             mvwaddch(win,
                      prev_y + ly + 1,
@@ -424,7 +435,8 @@ void animate_shape(void *arg) {
       }
       wattroff(win, COLOR_PAIR(sh->color_pair));
       wrefresh(win);
-    my_mutex_unlock(&canvas_mutex);
+      canvas_version++;
+    my_rwlock_unlock(&canvas_lock);
 
 
     for (int i = 1; i <= steps; i++) {
@@ -453,19 +465,25 @@ void animate_shape(void *arg) {
             sh->shape_lines, orig_h, orig_w,
             angle_current, &rot_h, &rot_w
         );
+        if (rotated == NULL) {
+            break;          // sin memoria: se borra la forma y termina
+        }
 
 
-        int can_move = 1;
-        my_mutex_lock(&canvas_mutex);
-        for (int ly = 0; ly < rot_h && can_move; ly++) {
-            for (int lx = 0; lx < rot_w; lx++) {
-                if (rotated[ly][lx] != ' ' &&
-                    is_position_occupied(&canvas_mutex,
-                                         x + lx, y + ly,
-                                         current_tid)) {
-                    can_move = 0;
-                    break;
-                }
+        my_rwlock_rdlock(&canvas_lock);
+        int can_move = footprint_free(rotated, rot_h, rot_w, x, y, current_tid);
+        unsigned long seen_version = canvas_version;
+        my_rwlock_unlock(&canvas_lock);
+
+        if (can_move) {
+            my_rwlock_wrlock(&canvas_lock);
+            // Si otra figura se movió entre ambos locks hay que volver a verificar
+            if (canvas_version != seen_version) {
+                seen_version = canvas_version;
+                can_move = footprint_free(rotated, rot_h, rot_w, x, y, current_tid);
+            }
+            if (!can_move) {
+                my_rwlock_unlock(&canvas_lock);
             }
         }
 
@@ -474,11 +492,9 @@ void animate_shape(void *arg) {
             for (int ly = 0; ly < rot_h_prev; ly++) {
                 for (int lx = 0; lx < rot_w_prev; lx++) {
                     if (rotated_prev[ly][lx] != ' ') {
-                        free_position(&canvas_mutex,
-                                      prev_x + lx, prev_y + ly,
+                        free_position(prev_x + lx, prev_y + ly,
                                       current_tid);
-                        if (!is_position_occupied(&canvas_mutex,
-                                                  prev_x + lx, prev_y + ly,
+                        if (!is_position_occupied(prev_x + lx, prev_y + ly,
                                                   current_tid)) {
                             mvwaddch(win,
                                      prev_y + ly + 1,
@@ -495,8 +511,7 @@ void animate_shape(void *arg) {
                 for (int lx = 0; lx < rot_w; lx++) {
                     char c = rotated[ly][lx];
                     if (c != ' ') {
-                        occupy_position(&canvas_mutex,
-                                        x + lx, y + ly,
+                        occupy_position(x + lx, y + ly,
                                         current_tid);
                         mvwaddch(win,
                                  y + ly + 1,
@@ -515,31 +530,35 @@ void animate_shape(void *arg) {
             rotated_prev = rotated;
             rot_h_prev   = rot_h;
             rot_w_prev   = rot_w;
+            canvas_version++;
+            my_rwlock_unlock(&canvas_lock);
+            notify_canvas_change();   // posiciones liberadas
+            if (periodica) {
+                my_thread_next_job();
+            } else {
+                my_thread_sleep(FRAME_MS);
+            }
         } else {
 
             for (int k = 0; k < rot_h; k++) free(rotated[k]);
             free(rotated);
             i--;
+            // Espera a que otra figura se mueva o termine (o a su deadline)
+            wait_canvas_change(seen_version, reloj_ms() + (deadline_ms - now_ms));
         }
-        my_mutex_unlock(&canvas_mutex);
-
-        if (scheduler_activo != 1) napms(100);
-        else custom_napms(100);
 
 
 
     }
 
 
-    my_mutex_lock(&canvas_mutex);
+    my_rwlock_wrlock(&canvas_lock);
     for (int ly = 0; ly < rot_h_prev; ly++) {
         for (int lx = 0; lx < rot_w_prev; lx++) {
             if (rotated_prev[ly][lx] != ' ') {
-                free_position(&canvas_mutex,
-                              prev_x + lx, prev_y + ly,
+                free_position(prev_x + lx, prev_y + ly,
                               current_tid);
-                if (!is_position_occupied(&canvas_mutex,
-                                          prev_x + lx, prev_y + ly,
+                if (!is_position_occupied(prev_x + lx, prev_y + ly,
                                           current_tid)) {
                     mvwaddch(win,
                              prev_y + ly + 1,
@@ -550,7 +569,9 @@ void animate_shape(void *arg) {
         }
     }
     wrefresh(win);
-    my_mutex_unlock(&canvas_mutex);
+    canvas_version++;
+    my_rwlock_unlock(&canvas_lock);
+    notify_canvas_change();
 
     for (int k = 0; k < rot_h_prev; k++) free(rotated_prev[k]);
     free(rotated_prev);
@@ -610,11 +631,15 @@ int main(int argc, char *argv[]) {
     box(win, 0, 0);
     wattroff(win, COLOR_PAIR(10));
     wrefresh(win);
+    scratch_init();
+    my_rwlock_init(&canvas_lock);
     my_mutex_init(&canvas_mutex);
+    my_cond_init(&canvas_cond);
 
 
 
     edf_scheduler_init(&edf);
+    tcb_pool_precalentar((size_t)global_cfg->shape_count);
     //lottery_scheduler_init(&ls, QUANTUM_MS);
     //rr_scheduler_init(&rr, QUANTUM_MS);
 
@@ -626,16 +651,25 @@ int main(int argc, char *argv[]) {
 
     for (int i = 0; i < global_cfg->shape_count; i++) {
         ShapeConfig *sh = &global_cfg->shapes[i];
-
-        my_thread_create(
-            animate_shape,
-            sh,
-            (Scheduler*)&edf,
-            sh->tickets,
-            0,
-            sh->end_time
-        );
         sh->start_ms = global_start_ms;
+
+        // Un cuadro cada FRAME_MS desde start_time, como en el servidor
+        my_thread_attr_t attr;
+        my_thread_attr_init(&attr);
+        attr.scheduler  = (Scheduler*)&edf;
+        attr.nombre     = sh->name;
+        attr.tickets    = sh->tickets;
+        attr.periodo_ms = FRAME_MS;
+        attr.desfase_ms = sh->start_time;
+        attr.wcet_ms    = FRAME_WCET_MS;
+        int tid = my_thread_create_attr(animate_shape, sh, &attr);
+        if (tid < 0) {
+            // No cabe en el control de admisión: deadline absoluto en reloj_ms
+            attr.periodo_ms = 0;
+            attr.deadline   = (long)(reloj_ms() + sh->start_time + sh->end_time);
+            tid = my_thread_create_attr(animate_shape, sh, &attr);
+        }
+        my_thread_detach(tid);   // nadie hace join: se recicla al terminar
     }
 
 
@@ -1,21 +1,38 @@
 #define _POSIX_C_SOURCE 200809L
 #include <ucontext.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
 #include "../include/my_pthread.h"
 #include <stdio.h>
-#define STACK_SIZE (64 * 1024)
 
 extern ucontext_t scheduler_ctx;
 extern ThreadPool global_thread_pool;
-extern TCB *hilo_actual;
-extern int next_tid;
+extern _Thread_local TCB *hilo_actual;
+
+static long inversiones_evitadas = 0;   // préstamos de deadline/tickets/prioridad a dueños de mutex
+static long trabajos_rt        = 0;     // trabajos de tareas periódicas terminados
+static long plazos_perdidos_rt = 0;     // de ellos, cuántos terminaron después de su deadline
+
+#define TLS_RONDAS_DESTRUCTORES 4      // un destructor puede volver a asignar valores
+
+static void (*tls_destructores[TLS_CLAVES_MAX])(void*);
+static int    tls_en_uso[TLS_CLAVES_MAX];
+static void  *tls_sin_hilo[TLS_CLAVES_MAX];   // valores de código fuera de los hilos
 
 /**
  * pasar_funcion
  *
  * Función auxiliar que actúa como puente para arrancar la ejecución de un hilo.
  * Recibe un puntero a la función que el hilo debe ejecutar y su argumento.
- * Internamente invoca la función  y al finalizar, llama a my_thread_end().
+ * Sale primero de la sección crítica del schedule() que lo eligió
+ * (hilo_comenzar), invoca la función  y al finalizar, llama a my_thread_end().
  *
  * Entradas:
  *  - funcion: puntero a la función que ejecutará el hilo.
@@ -25,88 +42,292 @@ extern int next_tid;
  *  - void (no devuelve valor; al terminar, marca el hilo como terminado).
  */
 static void pasar_funcion(void (*funcion)(void*), void *arg) {
+    hilo_comenzar();
     funcion(arg);
     my_thread_end();
 }
 
 /**
- * my_thread_create
+ * my_thread_attr_init
  *
- * Crea un nuevo hilo con los parámetros y scheduler especificados. Reserva y
- * configura el TCB y la pila, inicializa el contexto para que arranque en
- * thread_trampoline(funcion, arg), le asigna un TID único, lo registra en el pool
- * global y lo encola en la cola de READY del scheduler. Si ocurre un error, retorna -1.
+ * Deja los atributos de creación con sus valores por defecto: pila de
+ * PILA_TAMANO_DEFECTO (o la que indique el perfil en modo AUTO), sin nombre, quantum del scheduler, sin tickets ni
+ * deadline y sin período (no es tarea periódica). El scheduler inicial queda en NULL y hay que asignarlo.
  *
  * Entradas:
- *  - funcion : puntero a la función que ejecutará el hilo.
- *  - arg     : puntero al argumento que se pasará a la función del hilo.
- *  - sched   : puntero al Scheduler.
- *  - tickets : número de tickets (para  lottery).
- *  - priority: prioridad del hilo (para  RMS, no se utilizó).
- *  - deadline: plazo límite de ejecución (para EDF).
+ *  - attr: atributos a inicializar.
  *
  * Retorna:
- *  - int: TID del hilo recién creado, o -1 si falla la creación.
+ *  - int: 0 si no falló, -1 si attr es NULL.
  */
-int my_thread_create( void (*funcion)(void*), void *arg, Scheduler *sched, int tickets, int priority, long deadline) {
-    TCB *hilo = malloc(sizeof *hilo);
-    if (hilo==NULL) return -1;
+int my_thread_attr_init(my_thread_attr_t *attr) {
+    if (attr == NULL) {
+        return -1;
+    }
+    attr->stack_size = 0;
+    attr->nombre     = NULL;
+    attr->quantum_us = 0;
+    attr->scheduler  = NULL;
+    attr->tickets    = 0;
+    attr->priority   = 0;
+    attr->deadline   = 0;
+    attr->periodo_ms = 0;
+    attr->plazo_ms   = 0;
+    attr->desfase_ms = 0;
+    attr->wcet_ms    = 0;
+    attr->esporadica = 0;
+    return 0;
+}
 
-    if (getcontext(&hilo->context) == -1) {
-        free(hilo);
+/**
+ * my_thread_create_attr
+ *
+ * Crea un nuevo hilo con los atributos indicados. Obtiene del pool un TCB con
+ * una pila del tamaño pedido (reciclado de la misma clase de tamaño si hay
+ * alguno libre; sin tamaño pedido y con el perfil de pila en modo AUTO, el
+ * que se observó para la misma función), la pinta si el perfil está activo,
+ * inicializa el contexto para que arranque en
+ * pasar_funcion(funcion, arg), lo registra en el pool global (que le asigna
+ * un TID a partir de su slot) y lo encola en la cola de READY del scheduler
+ * inicial. Si ocurre un error, retorna -1.
+ *
+ * Con periodo_ms > 0 el hilo es una tarea periódica (o esporádica): primero
+ * pasa el control de admisión del scheduler con su densidad
+ * wcet / min(plazo, período), y su primer trabajo se libera desfase_ms después
+ * de crearlo (hasta entonces duerme en la rueda de tiempo), con deadline
+ * absoluto liberación + plazo en la base de reloj_ms. Cada trabajo termina
+ * con my_thread_next_job.
+ *
+ * Entradas:
+ *  - funcion: puntero a la función que ejecutará el hilo.
+ *  - arg    : puntero al argumento que se pasará a la función del hilo.
+ *  - attr   : atributos del hilo (ver my_thread_attr_init); el nombre se copia.
+ *
+ * Retorna:
+ *  - int: TID del hilo recién creado, o -1 si falla la creación, los
+ *         atributos no son válidos (sin scheduler, quantum o tiempos negativos,
+ *         wcet mayor que el plazo) o la tarea no pasa el control de admisión.
+ */
+int my_thread_create_attr(void (*funcion)(void*), void *arg, const my_thread_attr_t *attr) {
+    if (attr == NULL || attr->scheduler == NULL || attr->quantum_us < 0) {
         return -1;
     }
-    hilo->stack = malloc(STACK_SIZE);
-    if (hilo->stack == NULL) {
-        free(hilo);
+    long plazo = attr->plazo_ms > 0 ? attr->plazo_ms : attr->periodo_ms;
+    if (attr->periodo_ms < 0 || attr->plazo_ms < 0 || attr->desfase_ms < 0 ||
+        attr->wcet_ms < 0 || (attr->periodo_ms > 0 && attr->wcet_ms > plazo)) {
+        return -1;
+    }
+    Scheduler *sched = attr->scheduler;
+    runtime_lock();
+    TCB *hilo = tcb_pool_obtener(pila_tamano_para(funcion, attr->stack_size));
+    if (hilo==NULL) {
+        runtime_unlock();
+        return -1;
+    }
+    int pintada = pila_pintar(hilo);
+
+    if (getcontext(&hilo->context) == -1) {
+        tcb_pool_devolver(hilo);
+        runtime_unlock();
         return -1;
     }
     hilo->context.uc_stack.ss_sp = hilo->stack;
-    hilo->context.uc_stack.ss_size = STACK_SIZE;
+    hilo->context.uc_stack.ss_size = hilo->stack_size;
     hilo->context.uc_link = &scheduler_ctx;
     makecontext(&hilo->context,
             (void(*)(void))pasar_funcion,
             2, funcion, arg);
+    preparar_contexto(hilo);
 
-    hilo->tid = next_tid++;
-    hilo->state = READY;
+    hilo->state = READY;   // estado inicial, se cuenta al registrar el hilo
     hilo->scheduler = sched;
+    hilo->cola_worker = -1;
     hilo->next = NULL;
-    hilo->tickets = tickets;
-    hilo->priority = priority;
-    hilo->deadline = deadline;
-    hilo->joiner = NULL;
+    hilo->tickets = attr->tickets;
+    hilo->priority = attr->priority;
+    hilo->deadline = attr->deadline;
+    hilo->tickets_propios = attr->tickets;
+    hilo->deadline_propio = attr->deadline;
+    hilo->priority_propia = attr->priority;
+    hilo->mutex_esperado = NULL;
+    hilo->mutex_tomados = NULL;
+    memset(hilo->tls, 0, sizeof hilo->tls);
+    hilo->quantum_us = attr->quantum_us;
+    hilo->nombre[0] = '\0';
+    if (attr->nombre) {
+        strncpy(hilo->nombre, attr->nombre, HILO_NOMBRE_MAX - 1);
+        hilo->nombre[HILO_NOMBRE_MAX - 1] = '\0';
+    }
+    cola_espera_init(&hilo->joiners);
+    hilo->joins_pendientes = 0;
+    hilo->retval = NULL;
     hilo->detached = 0;
+    hilo->timer_next = NULL;
+    hilo->timer_prev = NULL;
+    hilo->timer_slot = NULL;
+    hilo->espera_fd = -1;
+    hilo->es_next = NULL;
+    hilo->en_cola = NULL;
+    hilo->en_rueda = 0;
+    hilo->sorteo_pos = 0;
+    hilo->monticulo_pos = 0;
+    hilo->pase = 0;
+    hilo->pase_desde_ns = 0;
+    hilo->desaloja_desde_ns = 0;
+    hilo->periodo_ms = attr->periodo_ms;
+    hilo->plazo_ms = plazo;
+    hilo->esporadica = attr->periodo_ms > 0 && attr->esporadica;
+    hilo->espera_liberacion = 0;
+    hilo->liberaciones_pendientes = 0;
+    hilo->densidad_ppm = 0;
+    hilo->admitido_en = NULL;
+    hilo->trabajos = 0;
+    hilo->plazos_perdidos = 0;
+    if (hilo->periodo_ms > 0) {
+        long menor = plazo < attr->periodo_ms ? plazo : attr->periodo_ms;
+        hilo->densidad_ppm = (long)((long long)attr->wcet_ms * 1000000 / menor);
+        if (tarea_admitir(sched, hilo) != 0) {
+            tcb_pool_devolver(hilo);
+            runtime_unlock();
+            return -1;
+        }
+        hilo->liberacion_ms = reloj_ms() + attr->desfase_ms;
+        hilo->deadline = hilo->deadline_propio = (long)(hilo->liberacion_ms + plazo);
+    }
+    hilo->funcion = funcion;
 
-    registrar_hilo(&global_thread_pool, hilo);
-    encolar_hilo(sched, hilo);
+    int tid = registrar_hilo(&global_thread_pool, hilo);
+    if (tid == -1) {
+        tarea_retirar(hilo);
+        tcb_pool_devolver(hilo);
+        runtime_unlock();
+        return -1;
+    }
+    hilo->pila_pintada = pintada;
+    if (hilo->periodo_ms > 0 && attr->desfase_ms > 0) {
+        // El primer trabajo todavía no se libera: duerme hasta entonces
+        hilo->despertar_ms = hilo->liberacion_ms;
+        cambiar_estado(hilo, BLOCKED);
+        temporizador_agregar(hilo);
+    } else {
+        encolar_hilo(sched, hilo);
+    }
+    runtime_unlock();
 
-    return hilo->tid;
+    return tid;
 }
 
 /**
- * my_thread_end
+ * my_thread_create
  *
- * Marca el hilo actual (hilo_actual) como TERMINATED. Si existe un hilo que
- * llamó a join, lo desbloquea y lo encola nuevamente
- * en su scheduler. Finalmente, invoca schedule() para hacer el cambio entre hilos.
+ * Crea un nuevo hilo con los parámetros y scheduler especificados y los
+ * demás atributos por defecto (pila de PILA_TAMANO_DEFECTO o automática,
+ * sin nombre, quantum del scheduler). Ver my_thread_create_attr.
  *
  * Entradas:
- *  - Ninguna
+ *  - funcion : puntero a la función que ejecutará el hilo.
+ *  - arg     : puntero al argumento que se pasará a la función del hilo.
+ *  - sched   : puntero al Scheduler.
+ *  - tickets : número de tickets (para  lottery).
+ *  - priority: prioridad fija del hilo (para RMS, 0 es la más alta).
+ *  - deadline: instante absoluto de reloj_ms() en que vence el hilo (para
+ *              EDF); para un plazo relativo, reloj_ms() + plazo.
+ *
+ * Retorna:
+ *  - int: TID del hilo recién creado, o -1 si falla la creación.
+ */
+int my_thread_create( void (*funcion)(void*), void *arg, Scheduler *sched, int tickets, int priority, long deadline) {
+    my_thread_attr_t attr;
+    my_thread_attr_init(&attr);
+    attr.scheduler = sched;
+    attr.tickets   = tickets;
+    attr.priority  = priority;
+    attr.deadline  = deadline;
+    return my_thread_create_attr(funcion, arg, &attr);
+}
+
+/**
+ * tls_ejecutar_destructores
+ *
+ * Llama al destructor de cada clave TLS en uso cuyo valor en el hilo no sea
+ * NULL, poniendo antes el valor en NULL. Como un destructor puede asignar
+ * valores nuevos, repite hasta que no quede ninguno o se agoten las rondas.
+ *
+ * Entradas:
+ *  - hilo: hilo que está terminando (el hilo actual).
  *
  * Retorna:
  *  - Ninguna
  */
-void my_thread_end(void) {
-    TCB *actual = hilo_actual;
-    actual->state = TERMINATED;
+static void tls_ejecutar_destructores(TCB *hilo) {
+    for (int ronda = 0; ronda < TLS_RONDAS_DESTRUCTORES; ronda++) {
+        int llamados = 0;
+        for (int clave = 0; clave < TLS_CLAVES_MAX; clave++) {
+            void *valor = hilo->tls[clave];
+            if (valor != NULL && tls_en_uso[clave] && tls_destructores[clave]) {
+                hilo->tls[clave] = NULL;
+                tls_destructores[clave](valor);
+                llamados++;
+            }
+        }
+        if (llamados == 0) {
+            return;
+        }
+    }
+}
 
-    if (actual->joiner) {
-        actual->joiner->state = READY;
-        encolar_hilo(actual->scheduler, actual->joiner);
+/**
+ * my_thread_exit
+ *
+ * Ejecuta los destructores de sus claves TLS y marca el hilo actual
+ * (hilo_actual) como TERMINATED guardando retval para quienes hagan join.
+ * Despierta de una vez a todos los hilos bloqueados en join sobre él; el TCB
+ * y su pila vuelven al pool cuando el último de ellos recoge retval, o en el
+ * siguiente schedule() si el hilo está detached y nadie lo esperaba.
+ * Finalmente, invoca schedule() para hacer el cambio entre hilos; no retorna
+ * nunca al llamador (si no quedaba otro hilo listo, hilo_salir vuelve a
+ * main). Llamarla fuera de un hilo es un error y termina el programa.
+ *
+ * Entradas:
+ *  - retval: valor que recibirán los hilos que hagan join.
+ *
+ * Retorna:
+ *  - Ninguna (no retorna)
+ */
+_Noreturn void my_thread_exit(void *retval) {
+    TCB *actual = hilo_actual;
+    if (actual == NULL) {
+        fprintf(stderr, "my_thread_exit: no hay un hilo en ejecución\n");
+        abort();
     }
+    tls_ejecutar_destructores(actual);
+    runtime_lock();
+    actual->retval = retval;
+    cambiar_estado(actual, TERMINATED);
+    tarea_retirar(actual);
+
+    desalojo_suspender();
+    actual->joins_pendientes = cola_espera_despertar_todos(&actual->joiners);
+    desalojo_reanudar();   // ya está TERMINATED, no cambia de hilo aquí
+    hilo_terminado(actual);
 
     schedule();
+    hilo_salir();          // no quedaba otro hilo listo
+}
+
+/**
+ * my_thread_end
+ *
+ * Termina el hilo actual sin valor de retorno; equivale a my_thread_exit(NULL).
+ *
+ * Entradas:
+ *  - Ninguna
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+_Noreturn void my_thread_end(void) {
+    my_thread_exit(NULL);
 }
 
 
@@ -125,247 +346,2293 @@ void my_thread_end(void) {
  */
 void my_thread_yield(void) {
     TCB *actual = hilo_actual;
-    actual->state = READY;
+    desalojo_suspender();
+    cambiar_estado(actual, READY);
     encolar_hilo(actual->scheduler, actual);
+    desalojo_reanudar();
     schedule();
 }
 
 /**
- * my_thread_join
+ * my_thread_sleep_until
  *
- * Bloquea el hilo actual hasta que el hilo identificado por tid termine su
- * ejecución. Si el hilo objetivo no existe, ya está TERMINATED, es el mismo
- * hilo o está en modo detached, retorna sin bloquearse. En caso contrario,
- * marca el hilo actual como BLOCKED, asigna hilo_actual a joiner del nuevo hilo
- * y llama a schedule().
+ * Duerme el hilo actual hasta el instante indicado (en la base de tiempo de
+ * reloj_ms, CLOCK_MONOTONIC). El hilo queda BLOCKED en la rueda de tiempo del
+ * runtime y no ocupa la CPU; al vencer vuelve a READY en su scheduler. Si se
+ * llama fuera de un hilo del runtime, duerme el proceso con clock_nanosleep.
  *
  * Entradas:
- *  - tid: identificador del hilo que va a esperar.
+ *  - instante_ms: instante absoluto en milisegundos en que debe despertar.
  *
  * Retorna:
  *  - Ninguna
  */
-void my_thread_join(int tid) {
+void my_thread_sleep_until(long long instante_ms) {
     TCB *actual = hilo_actual;
-    TCB *hilo_prioritario = buscar_hilo_id(&global_thread_pool, tid);
-    if (hilo_prioritario == NULL || hilo_prioritario->state == TERMINATED || hilo_prioritario == actual ||
-        hilo_prioritario->detached) return;
-    actual->state = BLOCKED;
-    hilo_prioritario->joiner = actual;
+    if (actual == NULL) {
+        struct timespec ts = { .tv_sec  = instante_ms / 1000,
+                               .tv_nsec = (instante_ms % 1000) * 1000000L };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        return;
+    }
+    runtime_lock();
+    actual->despertar_ms = instante_ms;
+    cambiar_estado(actual, BLOCKED);
+    temporizador_agregar(actual);
     schedule();
 }
 
 /**
- * my_thread_detach
+ * my_thread_sleep
  *
- * Marca el hilo con el identificador tid como detached. Si no existe un hilo con
- * ese TID, retorna -1, si sí existe, establece detached = 1 en su TCB.
+ * Duerme el hilo actual durante la cantidad de milisegundos indicada, cediendo
+ * la CPU a los demás hilos mientras tanto.
  *
  * Entradas:
- *  - tid: identificador del hilo que va a poner en modo detached.
+ *  - ms: milisegundos a dormir; con 0 o menos solo cede la CPU.
  *
  * Retorna:
- *  - int: 0 si no falló, -1 si no se encontró el hilo.
+ *  - Ninguna
  */
-int my_thread_detach(int tid) {
-    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
-    if (hilo == NULL) return -1;
-    hilo->detached = 1;
-    return 0;
+void my_thread_sleep(long ms) {
+    if (ms <= 0) {
+        if (hilo_actual != NULL) {
+            my_thread_yield();
+        }
+        return;
+    }
+    my_thread_sleep_until(reloj_ms() + ms);
 }
 
 /**
- * encolar_mutex
+ * esperar_fd
  *
- * Añade el TCB de un hilo a la cola de espera de un mutex. Si la cola estaba
- * vacía, este hilo pasa a ser cabeza y cola, si no estaba vacia, se encola al final
- * (despues de tail, y pasa a ser el nuevo tail).
+ * Espera a que el fd esté listo para leer o escribir. Dentro de un hilo del
+ * runtime lo estaciona en la tabla de esperas (epoll) y cede la CPU a los
+ * demás hilos; fuera del runtime bloquea el proceso con poll().
  *
  * Entradas:
- *  - mutex: puntero al mutex.
- *  - hilo : puntero al TCB del hilo que se va a encolar.
+ *  - fd      : descriptor a esperar.
+ *  - escribir: 1 para esperar escritura, 0 para lectura.
  *
  * Retorna:
- *  - Ninguna
+ *  - 0 cuando el fd puede estar listo (se debe reintentar), -1 en error.
  */
-static void encolar_mutex(my_mutex *mutex, TCB *hilo) {
-    hilo->next = NULL;
-    if (mutex->head == NULL) {
-        mutex->head = mutex->tail = hilo;
+static int esperar_fd(int fd, int escribir) {
+    TCB *actual = hilo_actual;
+    if (actual == NULL) {
+        struct pollfd pfd = { .fd = fd, .events = escribir ? POLLOUT : POLLIN };
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            return -1;
+        }
+        return 0;
     }
-    else {
-        mutex->tail->next = hilo;
-        //Ahora el tail en siguiente es el nuevo ultimo
-        mutex->tail = hilo;
+    runtime_lock();
+    if (es_esperar(actual, fd, escribir ? EPOLLOUT : EPOLLIN) != 0) {
+        runtime_unlock();
+        return -1;
     }
+    schedule();
+    return 0;
 }
 
+/**
+ * poner_no_bloqueante
+ *
+ * Activa O_NONBLOCK en el fd si aún no lo tiene.
+ *
+ * Entradas:
+ *  - fd: descriptor a modificar.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si fcntl falla.
+ */
+static int poner_no_bloqueante(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        return -1;
+    }
+    if (flags & O_NONBLOCK) {
+        return 0;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
 
 /**
- * desencolar_mutex
+ * my_thread_read
  *
- * Extrae el primer hilo en espera de la cola del mutex. Si la cola está vacía,
- * retorna NULL. Si se extrae un hilo, actualiza head, limpia next del hilo y lo
- * retorna.
+ * Lee del fd como read(), pero si todavía no hay datos (EAGAIN) estaciona el
+ * hilo actual hasta que el fd sea legible en lugar de bloquear el proceso.
+ * El fd queda en modo no bloqueante.
  *
  * Entradas:
- *  - mutex: puntero al mutex.
+ *  - fd   : descriptor del que se lee.
+ *  - buf  : buffer destino.
+ *  - count: máximo de bytes a leer.
  *
  * Retorna:
- *  - TCB*: puntero al TCB extraído, o NULL si no había hilos.
+ *  - bytes leídos (0 en fin de archivo), o -1 en error con errno asignado.
  */
-static TCB *desencolar_mutex(my_mutex *mutex) {
-    TCB *hilo = mutex->head;
-    if (hilo == NULL) {
-        return NULL;
+ssize_t my_thread_read(int fd, void *buf, size_t count) {
+    if (poner_no_bloqueante(fd) != 0) {
+        return -1;
     }
-    mutex->head = hilo->next;
-    if (mutex->head == NULL) {
-        mutex->tail = NULL;
+    while (1) {
+        ssize_t n = read(fd, buf, count);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || esperar_fd(fd, 0) != 0) {
+            return -1;
+        }
     }
-    hilo->next = NULL;
-    return hilo;
 }
 
 /**
- * my_mutex_init
+ * my_thread_write
  *
- * Inicializa un mutex con valores NULL o 0. Si el puntero recibido es NULL,
- * retorna -1.
+ * Escribe en el fd como write() (sin SIGPIPE si es un socket), pero si el
+ * buffer del kernel está lleno (EAGAIN) estaciona el hilo actual hasta que el
+ * fd sea escribible en lugar de bloquear el proceso. Puede escribir menos de
+ * count bytes, igual que write(). El fd queda en modo no bloqueante.
  *
  * Entradas:
- *  - mutex: puntero al mutex que se va a inicializar.
+ *  - fd   : descriptor en el que se escribe.
+ *  - buf  : datos a escribir.
+ *  - count: cantidad de bytes.
  *
  * Retorna:
- *  - 0 si la inicialización fue correcta, -1 si mutex es NULL.
+ *  - bytes escritos, o -1 en error con errno asignado.
  */
-int my_mutex_init(my_mutex *mutex) {
-    if (mutex == NULL) {
+ssize_t my_thread_write(int fd, const void *buf, size_t count) {
+    if (poner_no_bloqueante(fd) != 0) {
         return -1;
     }
-    mutex->bloqueado = 0;
-    mutex->propietario = NULL;
-    mutex->head = NULL;
-    mutex->tail = NULL;
-    mutex->occupied_positions = NULL;
-    return 0;
+    int es_socket = 1;
+    while (1) {
+        ssize_t n = es_socket ? send(fd, buf, count, MSG_NOSIGNAL)
+                              : write(fd, buf, count);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == ENOTSOCK) {
+            es_socket = 0;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || esperar_fd(fd, 1) != 0) {
+            return -1;
+        }
+    }
 }
 
 /**
- * my_mutex_destroy
+ * my_thread_accept
  *
- * Destruye un mutex que no esté bloqueado y no tenga hilos en espera. Si
- * mutex es NULL, está bloqueado o aún tiene una lista de espera, retorna -1. En
- * caso contrario,reestablece los valores a 0 o Null.
+ * Acepta una conexión como accept(), pero si no hay ninguna pendiente
+ * estaciona el hilo actual hasta que llegue una. El socket de escucha queda
+ * en modo no bloqueante; el socket aceptado se retorna tal como lo entrega
+ * accept().
  *
  * Entradas:
- *  - mutex: puntero al mutex que se va a destruir.
+ *  - fd     : socket en escucha.
+ *  - addr   : dirección del cliente (puede ser NULL).
+ *  - addrlen: tamaño de addr (puede ser NULL).
  *
  * Retorna:
- *  - 0 si la destrucción fue exitosa, -1 si hay algun error.
+ *  - descriptor del socket aceptado, o -1 en error con errno asignado.
  */
-int my_mutex_destroy(my_mutex *mutex) {
-    if (mutex  == NULL || mutex->bloqueado || mutex->head) {
+int my_thread_accept(int fd, struct sockaddr *addr, socklen_t *addrlen) {
+    if (poner_no_bloqueante(fd) != 0) {
         return -1;
     }
-    mutex->bloqueado = 0;
-    mutex->propietario  = NULL;
-    mutex->head = NULL;
-    mutex->tail = NULL;
-    return 0;
+    while (1) {
+        int c = accept(fd, addr, addrlen);
+        if (c >= 0) {
+            return c;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || esperar_fd(fd, 0) != 0) {
+            return -1;
+        }
+    }
 }
 
 /**
- * my_mutex_lock
+ * my_thread_join
  *
- * Intenta apropiarse del mutex. Si mutex es NULL, retorna -1. Si el mutex está libre,
- * lo marca como bloqueado y establece propietario = hilo_actual, retornando 0. Si el
- * mutex ya pertenece al hilo actual, retorna -1. Si está
- * bloqueado por otro hilo, encola hilo_actual en la cola de espera, marca su estado
- * como BLOCKED y llama a schedule().
+ * Bloquea el hilo actual hasta que el hilo identificado por tid termine su
+ * ejecución y recoge el valor que pasó a my_thread_exit. Varios hilos pueden
+ * esperar al mismo; todos reciben el valor y el último en recogerlo devuelve
+ * el TCB al pool. Si el hilo ya había terminado, recoge el valor sin
+ * bloquearse.
  *
  * Entradas:
- *  - mutex: puntero al mutex que se desea bloquear.
+ *  - tid   : identificador del hilo que va a esperar.
+ *  - retval: dónde guardar el valor de retorno, o NULL si no interesa.
  *
  * Retorna:
- *  - 0 si logra bloquear, -1 si mutex es NULL o lo solicita el mismo hilo propietario.
+ *  - 0 si el hilo terminó y se recogió su valor, -1 si no existe (o ya fue
+ *    reciclado), es el mismo hilo, está detached o se llama fuera de un hilo
+ *    sin que el objetivo haya terminado.
  */
-int my_mutex_lock(my_mutex *mutex) {
-    if (mutex == NULL) {
+int my_thread_join(int tid, void **retval) {
+    runtime_lock();
+    TCB *actual = hilo_actual;
+    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
+    if (hilo == NULL || hilo == actual || hilo->detached ||
+        (actual == NULL && hilo->state != TERMINATED)) {
+        runtime_unlock();
         return -1;
     }
-    if (mutex->bloqueado == 0) {
-        mutex->bloqueado = 1;
-        mutex->propietario  = hilo_actual;
-        return 0;
+    if (hilo->state == TERMINATED) {
+        hilo->joins_pendientes++;
+    } else {
+        // my_thread_exit lo cuenta en joins_pendientes al despertarlo
+        cola_espera_bloquear(&hilo->joiners, actual, -1);
+        schedule();
+        runtime_lock();
     }
-    if (mutex->propietario == hilo_actual) {
+    if (retval) {
+        *retval = hilo->retval;
+    }
+    if (--hilo->joins_pendientes == 0) {
+        hilo_reciclar(hilo);
+    }
+    runtime_unlock();
+    return 0;
+}
+
+/**
+ * my_thread_detach
+ *
+ * Marca el hilo con el identificador tid como detached. Si no existe un hilo con
+ * ese TID, retorna -1, si sí existe, establece detached = 1 en su TCB. Si el
+ * hilo ya había terminado y nadie lo esperaba, su TCB vuelve al pool de una vez.
+ *
+ * Entradas:
+ *  - tid: identificador del hilo que va a poner en modo detached.
+ *
+ * Retorna:
+ *  - int: 0 si no falló, -1 si no se encontró el hilo.
+ */
+int my_thread_detach(int tid) {
+    runtime_lock();
+    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
+    if (hilo == NULL) {
+        runtime_unlock();
         return -1;
     }
+    hilo->detached = 1;
+    if (hilo->state == TERMINATED && hilo->joins_pendientes == 0) {
+        hilo_reciclar(hilo);
+    }
+    runtime_unlock();
+    return 0;
+}
 
-    //Si esta ocupado lo mete en la cola
+/**
+ * my_thread_self
+ *
+ * Retorna el identificador del hilo actual.
+ *
+ * Entradas:
+ *  - Ninguna
+ *
+ * Retorna:
+ *  - int: TID del hilo actual, o -1 si se llama fuera de un hilo del runtime.
+ */
+int my_thread_self(void) {
     TCB *actual = hilo_actual;
-    encolar_mutex(mutex, actual);
-    actual->state = BLOCKED;
-    schedule();
-    return 0;
+    return actual ? actual->tid : -1;
 }
 
 /**
- * my_mutex_trylock
+ * my_thread_setquantum
  *
- * Intenta adquirir el mutex, pero si ya está bloqueado, no se encola ni se bloquea.
- * Si mutex es NULL, retorna -1. Si el mutex está libre, lo marca como bloqueado,
- * asigna propietario = hilo_actual y devuelve 0. Si ya está ocupado, retorna -1
- * sin encolarse ni cambiar el estado a BLOCKED.
+ * Le da al hilo un quantum propio, que puede ser menor a un milisegundo, en
+ * lugar del de su scheduler. Se aplica desde la próxima vez que el hilo tome
+ * la CPU.
  *
  * Entradas:
- *  - mutex: puntero al mutex que se va a intentar bloquear.
+ *  - tid       : identificador del hilo.
+ *  - quantum_us: quantum en microsegundos; 0 vuelve al de su scheduler.
  *
  * Retorna:
- *  - 0 si lo adquirió, -1 si mutex era NULL o ya estaba bloqueado.
+ *  - int: 0 si no falló, -1 si no existe el hilo o el quantum es negativo.
  */
-int my_mutex_trylock(my_mutex *mutex) {
-    if (mutex == NULL) {
+int my_thread_setquantum(int tid, long quantum_us) {
+    if (quantum_us < 0) {
         return -1;
     }
-    if (mutex->bloqueado == 0) {
-        mutex->bloqueado = 1;
-        mutex->propietario  = hilo_actual;
-        return 0;
+    runtime_lock();
+    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
+    if (hilo == NULL) {
+        runtime_unlock();
+        return -1;
     }
-    return -1;
+    hilo->quantum_us = quantum_us;
+    runtime_unlock();
+    return 0;
 }
 
 /**
- * my_mutex_unlock
+ * my_thread_getname
  *
- * Libera el mutex que posee el hilo actual. Si mutex es NULL, no estaba bloqueado o
- * propietario != hilo_actual, retorna -1. Si hay hilos en espera, desencola el
- * siguiente, lo marca como READY, lo encola en su scheduler y le asigna el mutex como
- * nuevo propietario. Si no hay ningún hilo en la cola, simplemente libera el mutex.
+ * Copia el nombre de depuración de un hilo (el que se le dio al crearlo con
+ * my_thread_create_attr; cadena vacía si no tiene).
  *
  * Entradas:
- *  - mutex: puntero al mutex que se va a liberar.
+ *  - tid  : identificador del hilo.
+ *  - buf  : dónde copiar el nombre.
+ *  - largo: tamaño de buf; HILO_NOMBRE_MAX alcanza para cualquier nombre.
  *
  * Retorna:
- *  - 0 si la operación tuvo éxito, -1 si hubo error.
+ *  - int: 0 si no falló, -1 si no existe el hilo o buf no es válido.
  */
-int my_mutex_unlock(my_mutex *mutex) {
-    if (mutex == NULL || mutex->bloqueado == 0 || mutex->propietario != hilo_actual) {
+int my_thread_getname(int tid, char *buf, size_t largo) {
+    if (buf == NULL || largo == 0) {
         return -1;
     }
-    // Si hay un hilo esperando se le da acceso al mutex
-    TCB *siguiente = desencolar_mutex(mutex);
-    if (siguiente != NULL) {
-        siguiente->state = READY;
-        encolar_hilo(siguiente->scheduler, siguiente);
-        mutex->propietario = siguiente;
-
-    } else {
-        // No hay nadie esperando, solo se libera
-        mutex->bloqueado = 0;
-        mutex->propietario = NULL;
+    runtime_lock();
+    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
+    if (hilo == NULL) {
+        runtime_unlock();
+        return -1;
     }
+    strncpy(buf, hilo->nombre, largo - 1);
+    buf[largo - 1] = '\0';
+    runtime_unlock();
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * liberar_trabajo
+ *
+ * Libera el siguiente trabajo de una tarea periódica o esporádica en el
+ * instante liberacion: fija su deadline absoluto (liberación + plazo, o el
+ * heredado si es más cercano) y, si la liberación es futura, la duerme hasta
+ * entonces en la rueda de tiempo. Si ya llegó, el hilo queda como estaba para
+ * que el llamador lo encole o lo siga ejecutando. El llamador debe tener
+ * runtime_lock y el hilo no debe estar encolado.
+ *
+ * Entradas:
+ *  - hilo      : tarea a liberar.
+ *  - liberacion: instante de liberación en la base de reloj_ms.
+ *
+ * Retorna:
+ *  - int: 1 si quedó dormida hasta la liberación, 0 si ya está liberada.
+ */
+static int liberar_trabajo(TCB *hilo, long long liberacion) {
+    hilo->liberacion_ms   = liberacion;
+    hilo->deadline_propio = (long)(liberacion + hilo->plazo_ms);
+    recalcular_herencia(hilo);
+    if (liberacion <= reloj_ms()) {
+        return 0;
+    }
+    hilo->despertar_ms = liberacion;
+    cambiar_estado(hilo, BLOCKED);
+    temporizador_agregar(hilo);
+    return 1;
+}
+
+/**
+ * my_thread_next_job
+ *
+ * Termina el trabajo actual de una tarea periódica: lo cuenta (y si terminó
+ * después de su deadline, también como plazo perdido) y espera la liberación
+ * del siguiente. En una tarea periódica el siguiente trabajo se libera un
+ * período después del anterior, sin acumular deriva; si ese instante ya
+ * pasó, sigue de inmediato (y si se atrasó más de un período se salta las
+ * liberaciones perdidas en vez de encadenar trabajos atrasados). En una esporádica espera a que alguien llame a
+ * my_thread_release (o usa una liberación que quedó pendiente), respetando la
+ * separación mínima. En ambos casos se reevalúa quién debe ejecutarse, porque
+ * el deadline del hilo acaba de alejarse.
+ *
+ * Entradas:
+ *  - Ninguna
+ *
+ * Retorna:
+ *  - int: 0 si el trabajo terminó a tiempo, 1 si perdió su deadline, -1 si
+ *         el hilo actual no es una tarea periódica.
+ */
+int my_thread_next_job(void) {
+    TCB *actual = hilo_actual;
+    if (actual == NULL || actual->periodo_ms <= 0) {
+        return -1;
+    }
+    runtime_lock();
+    long long ahora = reloj_ms();
+    int perdido = ahora > actual->deadline_propio;
+    actual->trabajos++;
+    actual->plazos_perdidos += perdido;
+    trabajos_rt++;
+    plazos_perdidos_rt += perdido;
+
+    long long siguiente = actual->liberacion_ms + actual->periodo_ms;
+    if (!actual->esporadica && siguiente < ahora) {
+        // Atrasado más de un período: se saltan las liberaciones que ya pasaron
+        siguiente += (ahora - siguiente) / actual->periodo_ms * actual->periodo_ms;
+    }
+    if (actual->esporadica) {
+        if (actual->liberaciones_pendientes == 0) {
+            actual->espera_liberacion = 1;    // la libera my_thread_release
+            cambiar_estado(actual, BLOCKED);
+            schedule();
+            return perdido;
+        }
+        actual->liberaciones_pendientes--;
+        if (siguiente < ahora) {
+            siguiente = ahora;
+        }
+    }
+    if (liberar_trabajo(actual, siguiente)) {
+        schedule();
+        return perdido;
+    }
+    runtime_unlock();
+    my_thread_yield();
+    return perdido;
+}
+
+/**
+ * my_thread_release
+ *
+ * Libera un trabajo de una tarea esporádica. Si la tarea está esperando, el
+ * trabajo se libera ahora o, si no pasó la separación mínima desde el
+ * anterior, cuando pase; si está ejecutando otro trabajo, la liberación queda
+ * pendiente para cuando lo termine.
+ *
+ * Entradas:
+ *  - tid: identificador de la tarea esporádica.
+ *
+ * Retorna:
+ *  - int: 0 si no falló, -1 si no existe el hilo o no es esporádico.
+ */
+int my_thread_release(int tid) {
+    runtime_lock();
+    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
+    if (hilo == NULL || !hilo->esporadica || hilo->state == TERMINATED) {
+        runtime_unlock();
+        return -1;
+    }
+    if (!hilo->espera_liberacion) {
+        hilo->liberaciones_pendientes++;
+        runtime_unlock();
+        return 0;
+    }
+    hilo->espera_liberacion = 0;
+    long long liberacion = hilo->liberacion_ms + hilo->periodo_ms;
+    long long ahora      = reloj_ms();
+    if (!liberar_trabajo(hilo, liberacion > ahora ? liberacion : ahora)) {
+        cambiar_estado(hilo, READY);
+        encolar_hilo(hilo->scheduler, hilo);
+    }
+    runtime_unlock();
+    return 0;
+}
+
+/**
+ * my_thread_job_stats
+ *
+ * Consulta cuántos trabajos terminó una tarea periódica y cuántos de ellos
+ * perdieron su deadline.
+ *
+ * Entradas:
+ *  - tid            : identificador de la tarea.
+ *  - trabajos       : dónde dejar los trabajos terminados (puede ser NULL).
+ *  - plazos_perdidos: dónde dejar los plazos perdidos (puede ser NULL).
+ *
+ * Retorna:
+ *  - int: 0 si no falló, -1 si no existe el hilo o no es una tarea periódica.
+ */
+int my_thread_job_stats(int tid, long *trabajos, long *plazos_perdidos) {
+    runtime_lock();
+    TCB *hilo = buscar_hilo_id(&global_thread_pool, tid);
+    if (hilo == NULL || hilo->periodo_ms <= 0) {
+        runtime_unlock();
+        return -1;
+    }
+    if (trabajos) {
+        *trabajos = hilo->trabajos;
+    }
+    if (plazos_perdidos) {
+        *plazos_perdidos = hilo->plazos_perdidos;
+    }
+    runtime_unlock();
+    return 0;
+}
+
+/**
+ * my_thread_estadisticas_rt
+ *
+ * Totales de todas las tareas periódicas desde el inicio (también las que ya
+ * terminaron): trabajos terminados y plazos perdidos.
+ *
+ * Entradas:
+ *  - trabajos       : dónde dejar los trabajos terminados (puede ser NULL).
+ *  - plazos_perdidos: dónde dejar los plazos perdidos (puede ser NULL).
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+void my_thread_estadisticas_rt(long *trabajos, long *plazos_perdidos) {
+    runtime_lock();
+    if (trabajos) {
+        *trabajos = trabajos_rt;
+    }
+    if (plazos_perdidos) {
+        *plazos_perdidos = plazos_perdidos_rt;
+    }
+    runtime_unlock();
+}
+
+/**
+ * my_thread_key_create
+ *
+ * Reserva una clave de almacenamiento por hilo. Cada hilo empieza con NULL en
+ * la clave; al terminar un hilo, si su valor no es NULL se llama a destructor
+ * con ese valor.
+ *
+ * Entradas:
+ *  - clave     : dónde guardar la clave reservada.
+ *  - destructor: función que libera el valor de un hilo al terminar, o NULL.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si clave es NULL o ya se usaron las TLS_CLAVES_MAX claves.
+ */
+int my_thread_key_create(my_thread_key_t *clave, void (*destructor)(void*)) {
+    if (clave == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    int libre = 0;
+    while (libre < TLS_CLAVES_MAX && tls_en_uso[libre]) {
+        libre++;
+    }
+    if (libre == TLS_CLAVES_MAX) {
+        runtime_unlock();
+        return -1;
+    }
+    // Una clave reciclada no debe mostrar valores de su uso anterior
+    for (size_t i = 0; i < global_thread_pool.count; i++) {
+        global_thread_pool.threads[i]->tls[libre] = NULL;
+    }
+    tls_sin_hilo[libre]     = NULL;
+    tls_destructores[libre] = destructor;
+    tls_en_uso[libre]       = 1;
+    runtime_unlock();
+    *clave = libre;
+    return 0;
+}
+
+/**
+ * my_thread_key_delete
+ *
+ * Libera una clave. Los valores que los hilos tenían en ella no se destruyen;
+ * liberarlos queda a cargo del programa.
+ *
+ * Entradas:
+ *  - clave: clave a liberar.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si la clave no es válida o no estaba en uso.
+ */
+int my_thread_key_delete(my_thread_key_t clave) {
+    if (clave < 0 || clave >= TLS_CLAVES_MAX) {
+        return -1;
+    }
+    runtime_lock();
+    int resultado = tls_en_uso[clave] ? 0 : -1;
+    tls_en_uso[clave]       = 0;
+    tls_destructores[clave] = NULL;
+    runtime_unlock();
+    return resultado;
+}
+
+/**
+ * my_thread_setspecific
+ *
+ * Asigna el valor del hilo actual para una clave. No toma ningún lock: cada
+ * hilo solo toca su propio arreglo tls.
+ *
+ * Entradas:
+ *  - clave: clave reservada con my_thread_key_create.
+ *  - valor: valor a guardar.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si la clave no es válida.
+ */
+int my_thread_setspecific(my_thread_key_t clave, const void *valor) {
+    if (clave < 0 || clave >= TLS_CLAVES_MAX || !tls_en_uso[clave]) {
+        return -1;
+    }
+    TCB *actual = hilo_actual;
+    if (actual) {
+        actual->tls[clave] = (void*)valor;
+    } else {
+        tls_sin_hilo[clave] = (void*)valor;
+    }
+    return 0;
+}
+
+/**
+ * my_thread_getspecific
+ *
+ * Retorna el valor del hilo actual para una clave: una lectura directa del
+ * arreglo tls del TCB, apta para caminos calientes.
+ *
+ * Entradas:
+ *  - clave: clave reservada con my_thread_key_create.
+ *
+ * Retorna:
+ *  - void*: el valor guardado, o NULL si no hay o la clave no es válida.
+ */
+void *my_thread_getspecific(my_thread_key_t clave) {
+    if ((unsigned)clave >= TLS_CLAVES_MAX) {
+        return NULL;
+    }
+    TCB *actual = hilo_actual;
+    return actual ? actual->tls[clave] : tls_sin_hilo[clave];
+}
+
+/**
+ * encolar_mutex
+ *
+ * Añade el TCB de un hilo a la cola de espera de un mutex. Si la cola estaba
+ * vacía, este hilo pasa a ser cabeza y cola, si no estaba vacia, se encola al final
+ * (despues de tail, y pasa a ser el nuevo tail).
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex.
+ *  - hilo : puntero al TCB del hilo que se va a encolar.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void encolar_mutex(my_mutex *mutex, TCB *hilo) {
+    hilo->next = NULL;
+    if (mutex->head == NULL) {
+        mutex->head = mutex->tail = hilo;
+    }
+    else {
+        mutex->tail->next = hilo;
+        //Ahora el tail en siguiente es el nuevo ultimo
+        mutex->tail = hilo;
+    }
+}
+
+
+/**
+ * desencolar_mutex
+ *
+ * Extrae el primer hilo en espera de la cola del mutex. Si la cola está vacía,
+ * retorna NULL. Si se extrae un hilo, actualiza head, limpia next del hilo y lo
+ * retorna.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex.
+ *
+ * Retorna:
+ *  - TCB*: puntero al TCB extraído, o NULL si no había hilos.
+ */
+static TCB *desencolar_mutex(my_mutex *mutex) {
+    TCB *hilo = mutex->head;
+    if (hilo == NULL) {
+        return NULL;
+    }
+    mutex->head = hilo->next;
+    if (mutex->head == NULL) {
+        mutex->tail = NULL;
+    }
+    hilo->next = NULL;
+    return hilo;
+}
+
+/**
+ * tomar_mutex
+ *
+ * Marca el mutex como bloqueado por el hilo indicado y lo agrega a la lista
+ * de mutex que ese hilo posee (la usa la herencia de deadline, tickets y
+ * prioridad).
+ *
+ * Entradas:
+ *  - mutex: mutex que se adquiere.
+ *  - hilo : nuevo propietario (puede ser NULL fuera de un hilo del runtime).
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void tomar_mutex(my_mutex *mutex, TCB *hilo) {
+    mutex->bloqueado   = 1;
+    mutex->propietario = hilo;
+    if (hilo != NULL) {
+        mutex->siguiente_tomado = hilo->mutex_tomados;
+        hilo->mutex_tomados     = mutex;
+    }
+}
+
+/**
+ * recalcular_herencia
+ *
+ * Restaura el deadline, los tickets y la prioridad propios del hilo y vuelve
+ * a aplicar lo heredado de los hilos que todavía esperan algún mutex que él
+ * posee: el deadline más cercano, la mayor cantidad de tickets y la prioridad
+ * más alta (el menor número). El llamador debe tener runtime_lock.
+ *
+ * Entradas:
+ *  - hilo: hilo a recalcular.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+void recalcular_herencia(TCB *hilo) {
+    int tickets_antes   = hilo->tickets;
+    long deadline_antes = hilo->deadline;
+    int priority_antes  = hilo->priority;
+    hilo->deadline = hilo->deadline_propio;
+    hilo->tickets  = hilo->tickets_propios;
+    hilo->priority = hilo->priority_propia;
+    for (my_mutex *m = hilo->mutex_tomados; m; m = m->siguiente_tomado) {
+        for (TCB *it = m->head; it; it = it->next) {
+            if (it->deadline < hilo->deadline) {
+                hilo->deadline = it->deadline;
+            }
+            if (it->tickets > hilo->tickets) {
+                hilo->tickets = it->tickets;
+            }
+            if (it->priority < hilo->priority) {
+                hilo->priority = it->priority;
+            }
+        }
+    }
+    if (hilo->tickets != tickets_antes || hilo->deadline != deadline_antes ||
+        hilo->priority != priority_antes) {
+        hilo_pesos_cambiados(hilo);
+    }
+}
+
+/**
+ * heredar
+ *
+ * Protocolo de herencia: un hilo que se bloquea en un mutex le presta su
+ * deadline (si es más cercano), sus tickets (si son más) y su prioridad (si
+ * es más alta, para RMS) al propietario, y se sigue la cadena si ese propietario a su vez espera otro mutex. Así el
+ * dueño no queda relegado por hilos de urgencia intermedia mientras el hilo
+ * urgente lo espera. Cada préstamo cuenta como una inversión evitada.
+ *
+ * Entradas:
+ *  - mutex : mutex en el que se bloquea el hilo.
+ *  - espera: hilo que se bloquea.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void heredar(my_mutex *mutex, TCB *espera) {
+    int prestado = 0;
+    TCB *dueno   = mutex->propietario;
+    while (dueno != NULL && dueno != espera) {
+        int cambio = 0;
+        if (espera->deadline < dueno->deadline) {
+            dueno->deadline = espera->deadline;
+            cambio = 1;
+        }
+        if (espera->tickets > dueno->tickets) {
+            dueno->tickets = espera->tickets;
+            cambio = 1;
+        }
+        if (espera->priority < dueno->priority) {
+            dueno->priority = espera->priority;
+            cambio = 1;
+        }
+        if (!cambio) {
+            break;
+        }
+        hilo_pesos_cambiados(dueno);
+        prestado = 1;
+        dueno = dueno->mutex_esperado ? dueno->mutex_esperado->propietario : NULL;
+    }
+    if (prestado) {
+        inversiones_evitadas++;
+    }
+}
+
+/**
+ * my_mutex_inversiones_evitadas
+ *
+ * Retorna cuántas veces un hilo bloqueado en un mutex le prestó su deadline,
+ * sus tickets o su prioridad al propietario (inversiones de prioridad evitadas).
+ *
+ * Entradas:
+ *  - Ninguna
+ *
+ * Retorna:
+ *  - long: cantidad de inversiones evitadas desde el inicio.
+ */
+long my_mutex_inversiones_evitadas(void) {
+    runtime_lock();
+    long total = inversiones_evitadas;
+    runtime_unlock();
+    return total;
+}
+
+/**
+ * entregar_mutex
+ *
+ * Suelta un mutex que posee el hilo actual y le devuelve su deadline, tickets
+ * y prioridad propios (menos lo que siga heredando por otros mutex). Si hay hilos en
+ * espera, desencola el siguiente, le asigna el mutex como nuevo propietario
+ * (heredando de los que sigan esperando), lo marca como READY y lo encola en
+ * su scheduler. Si no hay ningún hilo en la cola, simplemente libera el mutex.
+ * El llamador debe tener runtime_lock.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex que se va a soltar.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void entregar_mutex(my_mutex *mutex) {
+    TCB *anterior = mutex->propietario;
+    if (anterior != NULL) {
+        my_mutex **ptr = &anterior->mutex_tomados;
+        while (*ptr && *ptr != mutex) {
+            ptr = &(*ptr)->siguiente_tomado;
+        }
+        if (*ptr) {
+            *ptr = mutex->siguiente_tomado;
+        }
+    }
+    mutex->siguiente_tomado = NULL;
+
+    // Si hay un hilo esperando se le da acceso al mutex
+    TCB *siguiente = desencolar_mutex(mutex);
+    if (siguiente != NULL) {
+        // El dueño se asigna antes de encolar: en EDF encolar puede cambiar de contexto
+        siguiente->mutex_esperado = NULL;
+        tomar_mutex(mutex, siguiente);
+        recalcular_herencia(siguiente);
+    } else {
+        // No hay nadie esperando, solo se libera
+        mutex->bloqueado = 0;
+        mutex->propietario = NULL;
+    }
+    if (anterior != NULL) {
+        recalcular_herencia(anterior);
+    }
+    if (siguiente != NULL) {
+        cambiar_estado(siguiente, READY);
+        encolar_hilo(siguiente->scheduler, siguiente);
+    }
+}
+
+/**
+ * my_mutex_init
+ *
+ * Inicializa un mutex con valores NULL o 0. Si el puntero recibido es NULL,
+ * retorna -1.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex que se va a inicializar.
+ *
+ * Retorna:
+ *  - 0 si la inicialización fue correcta, -1 si mutex es NULL.
+ */
+int my_mutex_init(my_mutex *mutex) {
+    if (mutex == NULL) {
+        return -1;
+    }
+    mutex->bloqueado = 0;
+    mutex->propietario = NULL;
+    mutex->head = NULL;
+    mutex->tail = NULL;
+    mutex->occupied_positions = NULL;
+    mutex->siguiente_tomado = NULL;
+    return 0;
+}
+
+/**
+ * my_mutex_destroy
+ *
+ * Destruye un mutex que no esté bloqueado y no tenga hilos en espera. Si
+ * mutex es NULL, está bloqueado o aún tiene una lista de espera, retorna -1. En
+ * caso contrario,reestablece los valores a 0 o Null.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex que se va a destruir.
+ *
+ * Retorna:
+ *  - 0 si la destrucción fue exitosa, -1 si hay algun error.
+ */
+int my_mutex_destroy(my_mutex *mutex) {
+    if (mutex  == NULL || mutex->bloqueado || mutex->head) {
+        return -1;
+    }
+    mutex->bloqueado = 0;
+    mutex->propietario  = NULL;
+    mutex->head = NULL;
+    mutex->tail = NULL;
+    return 0;
+}
+
+/**
+ * my_mutex_lock
+ *
+ * Intenta apropiarse del mutex. Si mutex es NULL, retorna -1. Si el mutex está libre,
+ * lo marca como bloqueado y establece propietario = hilo_actual, retornando 0. Si el
+ * mutex ya pertenece al hilo actual, retorna -1. Si está
+ * bloqueado por otro hilo, encola hilo_actual en la cola de espera, le presta su
+ * deadline, tickets y prioridad al propietario (herencia, ver heredar), marca su estado
+ * como BLOCKED y llama a schedule(). En modo M:N la cola de espera se protege con
+ * runtime_lock(), que el worker libera después de guardar el contexto del hilo.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex que se desea bloquear.
+ *
+ * Retorna:
+ *  - 0 si logra bloquear, -1 si mutex es NULL o lo solicita el mismo hilo propietario.
+ */
+int my_mutex_lock(my_mutex *mutex) {
+    if (mutex == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (mutex->bloqueado == 0) {
+        tomar_mutex(mutex, hilo_actual);
+        runtime_unlock();
+        return 0;
+    }
+    if (mutex->propietario == hilo_actual) {
+        runtime_unlock();
+        return -1;
+    }
+
+    //Si esta ocupado lo mete en la cola
+    TCB *actual = hilo_actual;
+    encolar_mutex(mutex, actual);
+    actual->mutex_esperado = mutex;
+    heredar(mutex, actual);
+    cambiar_estado(actual, BLOCKED);
+    schedule();
+    return 0;
+}
+
+/**
+ * my_mutex_trylock
+ *
+ * Intenta adquirir el mutex, pero si ya está bloqueado, no se encola ni se bloquea.
+ * Si mutex es NULL, retorna -1. Si el mutex está libre, lo marca como bloqueado,
+ * asigna propietario = hilo_actual y devuelve 0. Si ya está ocupado, retorna -1
+ * sin encolarse ni cambiar el estado a BLOCKED.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex que se va a intentar bloquear.
+ *
+ * Retorna:
+ *  - 0 si lo adquirió, -1 si mutex era NULL o ya estaba bloqueado.
+ */
+int my_mutex_trylock(my_mutex *mutex) {
+    if (mutex == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (mutex->bloqueado == 0) {
+        tomar_mutex(mutex, hilo_actual);
+        runtime_unlock();
+        return 0;
+    }
+    runtime_unlock();
+    return -1;
+}
+
+/**
+ * my_mutex_unlock
+ *
+ * Libera el mutex que posee el hilo actual. Si mutex es NULL, no estaba bloqueado o
+ * propietario != hilo_actual, retorna -1. Si hay hilos en espera, desencola el
+ * siguiente, lo marca como READY, lo encola en su scheduler y le asigna el mutex como
+ * nuevo propietario. Si no hay ningún hilo en la cola, simplemente libera el mutex.
+ *
+ * Entradas:
+ *  - mutex: puntero al mutex que se va a liberar.
+ *
+ * Retorna:
+ *  - 0 si la operación tuvo éxito, -1 si hubo error.
+ */
+int my_mutex_unlock(my_mutex *mutex) {
+    if (mutex == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (mutex->bloqueado == 0 || mutex->propietario != hilo_actual) {
+        runtime_unlock();
+        return -1;
+    }
+    entregar_mutex(mutex);
+    runtime_unlock();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------
+   Variables de condición
+------------------------------------------------------------- */
+
+/**
+ * my_cond_init
+ *
+ * Inicializa una variable de condición sin hilos en espera.
+ *
+ * Entradas:
+ *  - cond: puntero a la condición.
+ *
+ * Retorna:
+ *  - 0 si la inicialización fue correcta, -1 si cond es NULL.
+ */
+int my_cond_init(my_cond *cond) {
+    if (cond == NULL) {
+        return -1;
+    }
+    cola_espera_init(&cond->espera);
+    return 0;
+}
+
+/**
+ * my_cond_destroy
+ *
+ * Destruye una variable de condición. Falla si todavía hay hilos esperando.
+ *
+ * Entradas:
+ *  - cond: puntero a la condición.
+ *
+ * Retorna:
+ *  - 0 si se destruyó, -1 si cond es NULL o tiene hilos en espera.
+ */
+int my_cond_destroy(my_cond *cond) {
+    if (cond == NULL || cond->espera.head != NULL) {
+        return -1;
+    }
+    cola_espera_init(&cond->espera);
+    return 0;
+}
+
+/**
+ * my_cond_timedwait
+ *
+ * Suelta el mutex y bloquea el hilo actual en la condición de forma atómica
+ * (nadie puede señalar entre ambos pasos). Al despertar, por señal o porque
+ * venció el límite, vuelve a adquirir el mutex antes de retornar. El hilo no
+ * consume quantum mientras espera.
+ *
+ * Entradas:
+ *  - cond      : condición a esperar.
+ *  - mutex     : mutex que posee el hilo actual.
+ *  - limite_ms : instante (reloj_ms) límite de la espera, o -1 sin límite.
+ *
+ * Retorna:
+ *  - 0 si fue señalado, ETIMEDOUT si venció el límite, -1 si hubo error.
+ */
+int my_cond_timedwait(my_cond *cond, my_mutex *mutex, long long limite_ms) {
+    if (cond == NULL || mutex == NULL || hilo_actual == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    TCB *actual = hilo_actual;
+    if (mutex->bloqueado == 0 || mutex->propietario != actual) {
+        runtime_unlock();
+        return -1;
+    }
+    cola_espera_bloquear(&cond->espera, actual, limite_ms);
+    entregar_mutex(mutex);
+    schedule();
+
+    int vencida = actual->espera_vencida;
+    my_mutex_lock(mutex);
+    return vencida ? ETIMEDOUT : 0;
+}
+
+/**
+ * my_cond_wait
+ *
+ * Igual que my_cond_timedwait pero sin límite de tiempo.
+ *
+ * Entradas:
+ *  - cond : condición a esperar.
+ *  - mutex: mutex que posee el hilo actual.
+ *
+ * Retorna:
+ *  - 0 al ser señalado, -1 si hubo error.
+ */
+int my_cond_wait(my_cond *cond, my_mutex *mutex) {
+    return my_cond_timedwait(cond, mutex, -1);
+}
+
+/**
+ * my_cond_signal
+ *
+ * Despierta al primer hilo que espera en la condición, si hay alguno. Si en
+ * EDF el despertado debe desalojar al actual, el cambio ocurre al terminar.
+ *
+ * Entradas:
+ *  - cond: condición a señalar.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si cond es NULL.
+ */
+int my_cond_signal(my_cond *cond) {
+    if (cond == NULL) {
+        return -1;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    cola_espera_despertar(&cond->espera);
+    runtime_unlock();
+    desalojo_reanudar();
+    return 0;
+}
+
+/**
+ * my_cond_broadcast
+ *
+ * Despierta a todos los hilos que esperan en la condición. El desalojo en EDF
+ * se aplaza hasta despertarlos a todos.
+ *
+ * Entradas:
+ *  - cond: condición a señalar.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si cond es NULL.
+ */
+int my_cond_broadcast(my_cond *cond) {
+    if (cond == NULL) {
+        return -1;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    cola_espera_despertar_todos(&cond->espera);
+    runtime_unlock();
+    desalojo_reanudar();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------
+   Semáforos contadores
+------------------------------------------------------------- */
+
+/**
+ * my_sem_init
+ *
+ * Inicializa un semáforo con el valor indicado.
+ *
+ * Entradas:
+ *  - sem  : puntero al semáforo.
+ *  - valor: cantidad inicial de unidades disponibles (≥ 0).
+ *
+ * Retorna:
+ *  - 0 si la inicialización fue correcta, -1 si sem es NULL o valor < 0.
+ */
+int my_sem_init(my_sem *sem, int valor) {
+    if (sem == NULL || valor < 0) {
+        return -1;
+    }
+    sem->valor = valor;
+    cola_espera_init(&sem->espera);
+    return 0;
+}
+
+/**
+ * my_sem_destroy
+ *
+ * Destruye un semáforo. Falla si todavía hay hilos esperando.
+ *
+ * Entradas:
+ *  - sem: puntero al semáforo.
+ *
+ * Retorna:
+ *  - 0 si se destruyó, -1 si sem es NULL o tiene hilos en espera.
+ */
+int my_sem_destroy(my_sem *sem) {
+    if (sem == NULL || sem->espera.head != NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * my_sem_wait
+ *
+ * Toma una unidad del semáforo. Si no hay, el hilo actual se bloquea hasta
+ * que un my_sem_post se la entregue directamente.
+ *
+ * Entradas:
+ *  - sem: puntero al semáforo.
+ *
+ * Retorna:
+ *  - 0 al obtener la unidad, -1 si hubo error.
+ */
+int my_sem_wait(my_sem *sem) {
+    if (sem == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (sem->valor > 0) {
+        sem->valor--;
+        runtime_unlock();
+        return 0;
+    }
+    if (hilo_actual == NULL) {
+        runtime_unlock();
+        return -1;
+    }
+    cola_espera_bloquear(&sem->espera, hilo_actual, -1);
+    schedule();
+    return 0;
+}
+
+/**
+ * my_sem_trywait
+ *
+ * Toma una unidad del semáforo si hay alguna, sin bloquearse.
+ *
+ * Entradas:
+ *  - sem: puntero al semáforo.
+ *
+ * Retorna:
+ *  - 0 si la obtuvo, -1 si sem es NULL o no había unidades.
+ */
+int my_sem_trywait(my_sem *sem) {
+    if (sem == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    int ok = sem->valor > 0;
+    if (ok) {
+        sem->valor--;
+    }
+    runtime_unlock();
+    return ok ? 0 : -1;
+}
+
+/**
+ * my_sem_post
+ *
+ * Devuelve una unidad al semáforo. Si hay hilos esperando, la unidad pasa
+ * directamente al primero, que vuelve a READY en su scheduler.
+ *
+ * Entradas:
+ *  - sem: puntero al semáforo.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si sem es NULL.
+ */
+int my_sem_post(my_sem *sem) {
+    if (sem == NULL) {
+        return -1;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    if (cola_espera_despertar(&sem->espera) == NULL) {
+        sem->valor++;
+    }
+    runtime_unlock();
+    desalojo_reanudar();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------
+   Barreras
+------------------------------------------------------------- */
+
+/**
+ * my_barrier_init
+ *
+ * Inicializa una barrera para el número de hilos indicado.
+ *
+ * Entradas:
+ *  - barrera: puntero a la barrera.
+ *  - total  : cantidad de hilos que deben llegar para liberarla (> 0).
+ *
+ * Retorna:
+ *  - 0 si la inicialización fue correcta, -1 si barrera es NULL o total ≤ 0.
+ */
+int my_barrier_init(my_barrier *barrera, int total) {
+    if (barrera == NULL || total <= 0) {
+        return -1;
+    }
+    barrera->total    = total;
+    barrera->llegados = 0;
+    cola_espera_init(&barrera->espera);
+    return 0;
+}
+
+/**
+ * my_barrier_destroy
+ *
+ * Destruye una barrera. Falla si todavía hay hilos esperando.
+ *
+ * Entradas:
+ *  - barrera: puntero a la barrera.
+ *
+ * Retorna:
+ *  - 0 si se destruyó, -1 si barrera es NULL o tiene hilos en espera.
+ */
+int my_barrier_destroy(my_barrier *barrera) {
+    if (barrera == NULL || barrera->espera.head != NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * my_barrier_wait
+ *
+ * Bloquea el hilo actual hasta que total hilos hayan llegado a la barrera. El
+ * último en llegar despierta a los demás y la barrera queda lista para la
+ * siguiente ronda.
+ *
+ * Entradas:
+ *  - barrera: puntero a la barrera.
+ *
+ * Retorna:
+ *  - 1 para el último hilo en llegar, 0 para los demás, -1 si hubo error.
+ */
+int my_barrier_wait(my_barrier *barrera) {
+    if (barrera == NULL || hilo_actual == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (++barrera->llegados == barrera->total) {
+        barrera->llegados = 0;
+        desalojo_suspender();
+        cola_espera_despertar_todos(&barrera->espera);
+        runtime_unlock();
+        desalojo_reanudar();
+        return 1;
+    }
+    cola_espera_bloquear(&barrera->espera, hilo_actual, -1);
+    schedule();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------
+   Lock de lectores/escritor
+------------------------------------------------------------- */
+
+/**
+ * my_rwlock_init
+ *
+ * Inicializa un lock de lectores/escritor libre.
+ *
+ * Entradas:
+ *  - rw: puntero al lock.
+ *
+ * Retorna:
+ *  - 0 si la inicialización fue correcta, -1 si rw es NULL.
+ */
+int my_rwlock_init(my_rwlock *rw) {
+    if (rw == NULL) {
+        return -1;
+    }
+    rw->lectores = 0;
+    rw->escritor = NULL;
+    cola_espera_init(&rw->lectores_espera);
+    cola_espera_init(&rw->escritores_espera);
+    return 0;
+}
+
+/**
+ * my_rwlock_destroy
+ *
+ * Destruye un lock de lectores/escritor que no esté tomado ni tenga hilos en
+ * espera.
+ *
+ * Entradas:
+ *  - rw: puntero al lock.
+ *
+ * Retorna:
+ *  - 0 si se destruyó, -1 si rw es NULL, está tomado o tiene hilos en espera.
+ */
+int my_rwlock_destroy(my_rwlock *rw) {
+    if (rw == NULL || rw->lectores || rw->escritor ||
+        rw->lectores_espera.head || rw->escritores_espera.head) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * my_rwlock_rdlock
+ *
+ * Toma el lock en modo compartido. Varios lectores pueden tenerlo a la vez;
+ * el hilo se bloquea si hay un escritor activo o alguno esperando (se
+ * prefiere a los escritores para que no se queden sin turno).
+ *
+ * Entradas:
+ *  - rw: puntero al lock.
+ *
+ * Retorna:
+ *  - 0 al obtener el lock, -1 si hubo error.
+ */
+int my_rwlock_rdlock(my_rwlock *rw) {
+    if (rw == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (rw->escritor == NULL && rw->escritores_espera.head == NULL) {
+        rw->lectores++;
+        runtime_unlock();
+        return 0;
+    }
+    if (hilo_actual == NULL) {
+        runtime_unlock();
+        return -1;
+    }
+    // Quien lo despierte ya lo cuenta como lector
+    cola_espera_bloquear(&rw->lectores_espera, hilo_actual, -1);
+    schedule();
+    return 0;
+}
+
+/**
+ * my_rwlock_wrlock
+ *
+ * Toma el lock en modo exclusivo. Si hay lectores o un escritor activos, el
+ * hilo se bloquea hasta que se lo entreguen.
+ *
+ * Entradas:
+ *  - rw: puntero al lock.
+ *
+ * Retorna:
+ *  - 0 al obtener el lock, -1 si hubo error o el hilo ya es el escritor.
+ */
+int my_rwlock_wrlock(my_rwlock *rw) {
+    if (rw == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    TCB *actual = hilo_actual;
+    if (rw->escritor == NULL && rw->lectores == 0) {
+        rw->escritor = actual;
+        runtime_unlock();
+        return 0;
+    }
+    if (actual == NULL || rw->escritor == actual) {
+        runtime_unlock();
+        return -1;
+    }
+    // Quien lo despierte ya lo deja como escritor
+    cola_espera_bloquear(&rw->escritores_espera, actual, -1);
+    schedule();
+    return 0;
+}
+
+/**
+ * my_rwlock_unlock
+ *
+ * Suelta el lock (el modo se deduce de quién lo llama). Cuando queda libre se
+ * entrega primero al siguiente escritor en espera; si no hay, a todos los
+ * lectores en espera a la vez.
+ *
+ * Entradas:
+ *  - rw: puntero al lock.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si rw es NULL o el lock no estaba tomado.
+ */
+int my_rwlock_unlock(my_rwlock *rw) {
+    if (rw == NULL) {
+        return -1;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    int resultado = 0;
+    if (rw->escritor != NULL && rw->escritor == hilo_actual) {
+        rw->escritor = NULL;
+    } else if (rw->lectores > 0) {
+        rw->lectores--;
+    } else {
+        resultado = -1;
+    }
+
+    if (resultado == 0 && rw->lectores == 0 && rw->escritor == NULL) {
+        TCB *escritor = cola_espera_despertar(&rw->escritores_espera);
+        if (escritor != NULL) {
+            rw->escritor = escritor;
+        } else {
+            rw->lectores += cola_espera_despertar_todos(&rw->lectores_espera);
+        }
+    }
+    runtime_unlock();
+    desalojo_reanudar();
+    return resultado;
+}
+
+
+/* -------------------------------------------------------------
+   Canales acotados
+------------------------------------------------------------- */
+
+/**
+ * canal_avisar_selects
+ *
+ * Despierta a los hilos bloqueados en my_channel_select sobre este canal para
+ * que vuelvan a revisar sus casos. Un hilo que espera en varios canales se
+ * despierta una sola vez. El llamador debe tener runtime_lock.
+ *
+ * Entradas:
+ *  - canal: canal cuyo estado cambió.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void canal_avisar_selects(my_channel *canal) {
+    for (SelectEspera *it = canal->selects; it; it = it->siguiente) {
+        if (*it->despertado == 0) {
+            *it->despertado = 1;
+            cambiar_estado(it->hilo, READY);
+            encolar_hilo(it->hilo->scheduler, it->hilo);
+        }
+    }
+}
+
+/**
+ * canal_poner
+ *
+ * Agrega un mensaje al final del buffer circular (que no debe estar lleno) y
+ * despierta a un receptor en espera y a los select del canal. El llamador
+ * debe tener runtime_lock y el desalojo suspendido.
+ *
+ * Entradas:
+ *  - canal: canal destino.
+ *  - msg  : mensaje a agregar.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void canal_poner(my_channel *canal, void *msg) {
+    canal->datos[(canal->inicio + canal->cantidad) % canal->capacidad] = msg;
+    canal->cantidad++;
+    cola_espera_despertar(&canal->receptores);
+    canal_avisar_selects(canal);
+}
+
+/**
+ * canal_sacar
+ *
+ * Saca el mensaje más antiguo del buffer circular (que no debe estar vacío) y
+ * despierta a un emisor en espera y a los select del canal. El llamador debe
+ * tener runtime_lock y el desalojo suspendido.
+ *
+ * Entradas:
+ *  - canal: canal origen.
+ *
+ * Retorna:
+ *  - void*: el mensaje sacado.
+ */
+static void *canal_sacar(my_channel *canal) {
+    void *msg = canal->datos[canal->inicio];
+    canal->inicio = (canal->inicio + 1) % canal->capacidad;
+    canal->cantidad--;
+    cola_espera_despertar(&canal->emisores);
+    canal_avisar_selects(canal);
+    return msg;
+}
+
+/**
+ * my_channel_init
+ *
+ * Inicializa un canal acotado con espacio para capacidad mensajes (punteros).
+ *
+ * Entradas:
+ *  - canal    : puntero al canal.
+ *  - capacidad: cantidad máxima de mensajes en el buffer (> 0).
+ *
+ * Retorna:
+ *  - 0 si la inicialización fue correcta, -1 si los parámetros no son
+ *    válidos o no hubo memoria para el buffer.
+ */
+int my_channel_init(my_channel *canal, int capacidad) {
+    if (canal == NULL || capacidad <= 0) {
+        return -1;
+    }
+    canal->datos = malloc(sizeof(void*) * (size_t)capacidad);
+    if (canal->datos == NULL) {
+        return -1;
+    }
+    canal->capacidad = capacidad;
+    canal->inicio    = 0;
+    canal->cantidad  = 0;
+    canal->cerrado   = 0;
+    cola_espera_init(&canal->emisores);
+    cola_espera_init(&canal->receptores);
+    canal->selects   = NULL;
+    return 0;
+}
+
+/**
+ * my_channel_destroy
+ *
+ * Libera el buffer de un canal que no tenga hilos esperando. Los mensajes
+ * que queden sin recibir se descartan.
+ *
+ * Entradas:
+ *  - canal: puntero al canal.
+ *
+ * Retorna:
+ *  - 0 si se destruyó, -1 si canal es NULL o tiene hilos en espera.
+ */
+int my_channel_destroy(my_channel *canal) {
+    if (canal == NULL || canal->emisores.head || canal->receptores.head ||
+        canal->selects) {
+        return -1;
+    }
+    free(canal->datos);
+    canal->datos = NULL;
+    return 0;
+}
+
+/**
+ * my_channel_close
+ *
+ * Cierra el canal: los envíos posteriores fallan y las recepciones vacían lo
+ * que quede en el buffer y luego fallan. Despierta a todos los hilos que
+ * esperaban en el canal.
+ *
+ * Entradas:
+ *  - canal: puntero al canal.
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si canal es NULL o ya estaba cerrado.
+ */
+int my_channel_close(my_channel *canal) {
+    if (canal == NULL) {
+        return -1;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    int resultado = canal->cerrado ? -1 : 0;
+    canal->cerrado = 1;
+    cola_espera_despertar_todos(&canal->emisores);
+    cola_espera_despertar_todos(&canal->receptores);
+    canal_avisar_selects(canal);
+    runtime_unlock();
+    desalojo_reanudar();
+    return resultado;
+}
+
+/**
+ * my_channel_send
+ *
+ * Envía un mensaje por el canal. Si el buffer está lleno, el hilo queda
+ * BLOCKED en la cola de emisores hasta que un receptor libere espacio.
+ *
+ * Entradas:
+ *  - canal: puntero al canal.
+ *  - msg  : mensaje (puntero) a enviar.
+ *
+ * Retorna:
+ *  - 0 si se envió, -1 si el canal es NULL o está cerrado.
+ */
+int my_channel_send(my_channel *canal, void *msg) {
+    if (canal == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    while (!canal->cerrado && canal->cantidad == canal->capacidad) {
+        if (hilo_actual == NULL) {
+            runtime_unlock();
+            return -1;
+        }
+        cola_espera_bloquear(&canal->emisores, hilo_actual, -1);
+        schedule();
+        runtime_lock();   // otro hilo pudo llenar el espacio antes: se revisa de nuevo
+    }
+    if (canal->cerrado) {
+        runtime_unlock();
+        return -1;
+    }
+    desalojo_suspender();
+    canal_poner(canal, msg);
+    runtime_unlock();
+    desalojo_reanudar();
+    return 0;
+}
+
+/**
+ * my_channel_recv
+ *
+ * Recibe el mensaje más antiguo del canal. Si el buffer está vacío, el hilo
+ * queda BLOCKED en la cola de receptores hasta que llegue un mensaje o se
+ * cierre el canal.
+ *
+ * Entradas:
+ *  - canal: puntero al canal.
+ *  - msg  : dónde guardar el mensaje recibido (puede ser NULL).
+ *
+ * Retorna:
+ *  - 0 si se recibió, -1 si el canal es NULL o está cerrado y vacío.
+ */
+int my_channel_recv(my_channel *canal, void **msg) {
+    if (canal == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    while (!canal->cerrado && canal->cantidad == 0) {
+        if (hilo_actual == NULL) {
+            runtime_unlock();
+            return -1;
+        }
+        cola_espera_bloquear(&canal->receptores, hilo_actual, -1);
+        schedule();
+        runtime_lock();
+    }
+    if (canal->cantidad == 0) {
+        runtime_unlock();
+        return -1;
+    }
+    desalojo_suspender();
+    void *recibido = canal_sacar(canal);
+    runtime_unlock();
+    desalojo_reanudar();
+    if (msg) {
+        *msg = recibido;
+    }
+    return 0;
+}
+
+/**
+ * my_channel_trysend
+ *
+ * Envía un mensaje solo si hay espacio en el buffer, sin bloquearse.
+ *
+ * Entradas:
+ *  - canal: puntero al canal.
+ *  - msg  : mensaje (puntero) a enviar.
+ *
+ * Retorna:
+ *  - 0 si se envió, -1 si el canal es NULL, está lleno o está cerrado.
+ */
+int my_channel_trysend(my_channel *canal, void *msg) {
+    if (canal == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (canal->cerrado || canal->cantidad == canal->capacidad) {
+        runtime_unlock();
+        return -1;
+    }
+    desalojo_suspender();
+    canal_poner(canal, msg);
+    runtime_unlock();
+    desalojo_reanudar();
+    return 0;
+}
+
+/**
+ * my_channel_tryrecv
+ *
+ * Recibe un mensaje solo si hay alguno en el buffer, sin bloquearse.
+ *
+ * Entradas:
+ *  - canal: puntero al canal.
+ *  - msg  : dónde guardar el mensaje recibido (puede ser NULL).
+ *
+ * Retorna:
+ *  - 0 si se recibió, -1 si el canal es NULL o está vacío.
+ */
+int my_channel_tryrecv(my_channel *canal, void **msg) {
+    if (canal == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (canal->cantidad == 0) {
+        runtime_unlock();
+        return -1;
+    }
+    desalojo_suspender();
+    void *recibido = canal_sacar(canal);
+    runtime_unlock();
+    desalojo_reanudar();
+    if (msg) {
+        *msg = recibido;
+    }
+    return 0;
+}
+
+/**
+ * my_channel_select
+ *
+ * Espera hasta que alguno de los casos pueda completarse y lo completa: un
+ * caso de envío (enviar = 1) manda casos[i].msg, uno de recepción guarda el
+ * mensaje en casos[i].msg. Un caso sobre un canal cerrado también cuenta como
+ * listo, con resultado = -1. Si hay varios listos se revisan a partir de uno
+ * al azar (runtime_aleatorio, no rand()) para no favorecer siempre al
+ * primero. Mientras espera, el hilo queda anotado en la lista de select de
+ * cada canal.
+ *
+ * Entradas:
+ *  - casos: arreglo de casos (canal, enviar, msg); al retornar, el caso
+ *           elegido tiene resultado = 0 si se completó o -1 si su canal
+ *           estaba cerrado.
+ *  - n    : cantidad de casos.
+ *
+ * Retorna:
+ *  - int: índice del caso completado, o -1 si los parámetros no son válidos,
+ *         no hubo memoria o se llama fuera de un hilo sin casos listos.
+ */
+int my_channel_select(my_channel_caso *casos, int n) {
+    if (casos == NULL || n <= 0) {
+        return -1;
+    }
+    SelectEspera *nodos = NULL;
+    runtime_lock();
+    for (;;) {
+        int primero = (int)(runtime_aleatorio() % (uint64_t)n);
+        for (int k = 0; k < n; k++) {
+            int i = (primero + k) % n;
+            my_channel *canal = casos[i].canal;
+            int puede = casos[i].enviar ? canal->cantidad < canal->capacidad
+                                        : canal->cantidad > 0;
+            if (puede && !(casos[i].enviar && canal->cerrado)) {
+                desalojo_suspender();
+                if (casos[i].enviar) {
+                    canal_poner(canal, casos[i].msg);
+                } else {
+                    casos[i].msg = canal_sacar(canal);
+                }
+                casos[i].resultado = 0;
+                runtime_unlock();
+                desalojo_reanudar();
+                free(nodos);
+                return i;
+            }
+            if (canal->cerrado) {
+                casos[i].resultado = -1;
+                runtime_unlock();
+                free(nodos);
+                return i;
+            }
+        }
+
+        if (hilo_actual == NULL) {
+            runtime_unlock();
+            free(nodos);
+            return -1;
+        }
+        if (nodos == NULL) {
+            nodos = malloc(sizeof(SelectEspera) * (size_t)n);
+            if (nodos == NULL) {
+                runtime_unlock();
+                return -1;
+            }
+        }
+        int despertado = 0;
+        for (int i = 0; i < n; i++) {
+            nodos[i].hilo       = hilo_actual;
+            nodos[i].despertado = &despertado;
+            nodos[i].siguiente  = casos[i].canal->selects;
+            casos[i].canal->selects = &nodos[i];
+        }
+        cambiar_estado(hilo_actual, BLOCKED);
+        schedule();
+        runtime_lock();
+
+        for (int i = 0; i < n; i++) {
+            SelectEspera **it = &casos[i].canal->selects;
+            while (*it != &nodos[i]) {
+                it = &(*it)->siguiente;
+            }
+            *it = nodos[i].siguiente;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------
+   Executor de tareas y futuros
+------------------------------------------------------------- */
+
+/**
+ * executor_encolar
+ *
+ * Agrega una tarea (su futuro) al final de la cola del executor y despierta
+ * a un hilo trabajador ocioso si hay alguno. El llamador debe tener
+ * runtime_lock y el desalojo suspendido.
+ *
+ * Entradas:
+ *  - ex    : executor destino.
+ *  - futuro: futuro de la tarea a ejecutar.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void executor_encolar(my_executor *ex, my_future *futuro) {
+    futuro->siguiente = NULL;
+    if (ex->cola) {
+        ex->cola->siguiente = futuro;
+    } else {
+        ex->cabeza = futuro;
+    }
+    ex->cola = futuro;
+    cola_espera_despertar(&ex->ociosos);
+}
+
+/**
+ * futuro_nuevo
+ *
+ * Reserva e inicializa un futuro pendiente para la función indicada.
+ *
+ * Entradas:
+ *  - ex     : executor que ejecutará la tarea.
+ *  - funcion: función de la tarea.
+ *  - arg    : argumento de la función.
+ *
+ * Retorna:
+ *  - my_future*: el futuro, o NULL si no hubo memoria.
+ */
+static my_future *futuro_nuevo(my_executor *ex, void *(*funcion)(void*), void *arg) {
+    my_future *futuro = malloc(sizeof *futuro);
+    if (futuro == NULL) {
+        return NULL;
+    }
+    futuro->funcion        = funcion;
+    futuro->arg            = arg;
+    futuro->valor          = NULL;
+    futuro->listo          = 0;
+    cola_espera_init(&futuro->esperando);
+    futuro->ejecutor       = ex;
+    futuro->siguiente      = NULL;
+    futuro->continuaciones = NULL;
+    return futuro;
+}
+
+/**
+ * futuro_completar
+ *
+ * Guarda el valor de una tarea terminada, despierta a los hilos que la
+ * esperaban y encola sus continuaciones (then) con ese valor como argumento.
+ * El llamador debe tener runtime_lock y el desalojo suspendido.
+ *
+ * Entradas:
+ *  - futuro: futuro de la tarea terminada.
+ *  - valor : valor retornado por la tarea.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void futuro_completar(my_future *futuro, void *valor) {
+    futuro->valor = valor;
+    futuro->listo = 1;
+    cola_espera_despertar_todos(&futuro->esperando);
+    my_future *cont = futuro->continuaciones;
+    futuro->continuaciones = NULL;
+    while (cont) {
+        my_future *siguiente = cont->siguiente;
+        cont->arg = valor;
+        executor_encolar(cont->ejecutor, cont);
+        cont = siguiente;
+    }
+}
+
+/**
+ * executor_trabajador
+ *
+ * Lazo de cada hilo trabajador: toma la primera tarea de la cola, la ejecuta
+ * fuera del lock y completa su futuro. Sin tareas queda BLOCKED en la cola de
+ * ociosos; termina cuando el executor se está cerrando y la cola quedó vacía.
+ *
+ * Entradas:
+ *  - arg: puntero al my_executor.
+ *
+ * Retorna:
+ *  - Ninguna
+ */
+static void executor_trabajador(void *arg) {
+    my_executor *ex = arg;
+    runtime_lock();
+    for (;;) {
+        while (ex->cabeza == NULL && !ex->cerrando) {
+            cola_espera_bloquear(&ex->ociosos, hilo_actual, -1);
+            schedule();
+            runtime_lock();
+        }
+        my_future *futuro = ex->cabeza;
+        if (futuro == NULL) {
+            break;
+        }
+        ex->cabeza = futuro->siguiente;
+        if (ex->cabeza == NULL) {
+            ex->cola = NULL;
+        }
+        runtime_unlock();
+
+        void *valor = futuro->funcion(futuro->arg);
+
+        desalojo_suspender();
+        runtime_lock();
+        futuro_completar(futuro, valor);
+        runtime_unlock();
+        desalojo_reanudar();
+        runtime_lock();
+    }
+    runtime_unlock();
+}
+
+/**
+ * my_executor_init
+ *
+ * Crea un executor con n_hilos hilos trabajadores que toman tareas de una
+ * cola compartida. Los trabajadores se crean en el scheduler indicado con los
+ * tickets y deadline dados, igual que con my_thread_create.
+ *
+ * Entradas:
+ *  - ex      : puntero al executor.
+ *  - n_hilos : cantidad de hilos trabajadores (> 0).
+ *  - sched   : scheduler de los trabajadores.
+ *  - tickets : tickets de cada trabajador (Lottery).
+ *  - deadline: deadline de cada trabajador (EDF).
+ *
+ * Retorna:
+ *  - 0 si se crearon todos los trabajadores, -1 si hubo error (los que se
+ *    alcanzaron a crear terminan solos).
+ */
+int my_executor_init(my_executor *ex, int n_hilos, Scheduler *sched,
+                     int tickets, long deadline) {
+    if (ex == NULL || n_hilos <= 0 || sched == NULL) {
+        return -1;
+    }
+    ex->tids = malloc(sizeof(int) * (size_t)n_hilos);
+    if (ex->tids == NULL) {
+        return -1;
+    }
+    ex->n_hilos  = 0;
+    ex->cabeza   = NULL;
+    ex->cola     = NULL;
+    ex->cerrando = 0;
+    cola_espera_init(&ex->ociosos);
+    for (int i = 0; i < n_hilos; i++) {
+        int tid = my_thread_create(executor_trabajador, ex, sched, tickets, 0, deadline);
+        if (tid == -1) {
+            // Los trabajadores ya creados ven cerrando, salen y se reciclan solos
+            desalojo_suspender();
+            runtime_lock();
+            ex->cerrando = 1;
+            cola_espera_despertar_todos(&ex->ociosos);
+            runtime_unlock();
+            desalojo_reanudar();
+            for (int j = 0; j < ex->n_hilos; j++) {
+                my_thread_detach(ex->tids[j]);
+            }
+            free(ex->tids);
+            ex->tids = NULL;
+            return -1;
+        }
+        ex->tids[ex->n_hilos++] = tid;
+    }
+    return 0;
+}
+
+/**
+ * my_executor_shutdown
+ *
+ * Cierra el executor: ya no acepta tareas nuevas, los trabajadores terminan
+ * las que quedan en la cola y salen, y se espera con join a cada uno. Debe
+ * llamarse desde un hilo del runtime que no sea trabajador del executor.
+ *
+ * Entradas:
+ *  - ex: puntero al executor.
+ *
+ * Retorna:
+ *  - 0 si todos los trabajadores terminaron, -1 si hubo error.
+ */
+int my_executor_shutdown(my_executor *ex) {
+    if (ex == NULL || ex->tids == NULL) {
+        return -1;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    ex->cerrando = 1;
+    cola_espera_despertar_todos(&ex->ociosos);
+    runtime_unlock();
+    desalojo_reanudar();
+
+    int resultado = 0;
+    for (int i = 0; i < ex->n_hilos; i++) {
+        if (my_thread_join(ex->tids[i], NULL) != 0) {
+            resultado = -1;
+        }
+    }
+    free(ex->tids);
+    ex->tids = NULL;
+    return resultado;
+}
+
+/**
+ * my_executor_submit
+ *
+ * Envía una tarea al executor. No crea ningún hilo: la tarea queda en la cola
+ * hasta que un trabajador la tome, y su resultado se obtiene con el futuro.
+ *
+ * Entradas:
+ *  - ex     : puntero al executor.
+ *  - funcion: función a ejecutar; su valor de retorno completa el futuro.
+ *  - arg    : argumento de la función.
+ *
+ * Retorna:
+ *  - my_future*: futuro de la tarea (se libera con my_future_destroy), o NULL
+ *                si el executor se está cerrando o no hubo memoria.
+ */
+my_future *my_executor_submit(my_executor *ex, void *(*funcion)(void*), void *arg) {
+    if (ex == NULL || funcion == NULL) {
+        return NULL;
+    }
+    my_future *futuro = futuro_nuevo(ex, funcion, arg);
+    if (futuro == NULL) {
+        return NULL;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    if (ex->cerrando) {
+        runtime_unlock();
+        desalojo_reanudar();
+        free(futuro);
+        return NULL;
+    }
+    executor_encolar(ex, futuro);
+    runtime_unlock();
+    desalojo_reanudar();
+    return futuro;
+}
+
+/**
+ * my_future_then
+ *
+ * Encadena una tarea que recibe como argumento el valor del futuro indicado.
+ * Se encola en el mismo executor cuando ese futuro se completa (o de una vez
+ * si ya estaba listo). Como my_executor_submit, no acepta tareas si el
+ * executor se está cerrando: sus trabajadores podrían haber salido ya y la
+ * continuación nunca se ejecutaría.
+ *
+ * Entradas:
+ *  - futuro : futuro del que depende la nueva tarea.
+ *  - funcion: función a ejecutar con el valor de futuro.
+ *
+ * Retorna:
+ *  - my_future*: futuro de la nueva tarea, o NULL si el executor se está
+ *                cerrando o no hubo memoria.
+ */
+my_future *my_future_then(my_future *futuro, void *(*funcion)(void*)) {
+    if (futuro == NULL || funcion == NULL) {
+        return NULL;
+    }
+    my_future *cont = futuro_nuevo(futuro->ejecutor, funcion, NULL);
+    if (cont == NULL) {
+        return NULL;
+    }
+    desalojo_suspender();
+    runtime_lock();
+    if (cont->ejecutor->cerrando) {
+        runtime_unlock();
+        desalojo_reanudar();
+        free(cont);
+        return NULL;
+    }
+    if (futuro->listo) {
+        cont->arg = futuro->valor;
+        executor_encolar(cont->ejecutor, cont);
+    } else {
+        cont->siguiente = futuro->continuaciones;
+        futuro->continuaciones = cont;
+    }
+    runtime_unlock();
+    desalojo_reanudar();
+    return cont;
+}
+
+/**
+ * my_future_wait
+ *
+ * Bloquea el hilo actual hasta que la tarea del futuro termine.
+ *
+ * Entradas:
+ *  - futuro: futuro a esperar.
+ *
+ * Retorna:
+ *  - 0 cuando el futuro está listo, -1 si futuro es NULL o se llama fuera de
+ *    un hilo del runtime con el futuro pendiente.
+ */
+int my_future_wait(my_future *futuro) {
+    if (futuro == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (!futuro->listo) {
+        if (hilo_actual == NULL) {
+            runtime_unlock();
+            return -1;
+        }
+        cola_espera_bloquear(&futuro->esperando, hilo_actual, -1);
+        schedule();
+        return 0;
+    }
+    runtime_unlock();
+    return 0;
+}
+
+/**
+ * my_future_get
+ *
+ * Espera a que la tarea del futuro termine y obtiene su valor de retorno.
+ *
+ * Entradas:
+ *  - futuro: futuro a consultar.
+ *  - valor : dónde guardar el valor (puede ser NULL).
+ *
+ * Retorna:
+ *  - 0 en éxito, -1 si my_future_wait falló.
+ */
+int my_future_get(my_future *futuro, void **valor) {
+    if (my_future_wait(futuro) != 0) {
+        return -1;
+    }
+    if (valor) {
+        *valor = futuro->valor;
+    }
+    return 0;
+}
+
+/**
+ * my_future_destroy
+ *
+ * Libera un futuro ya completado y sin hilos esperándolo. Los futuros creados
+ * con my_future_then sobre él son independientes y se liberan aparte.
+ *
+ * Entradas:
+ *  - futuro: futuro a liberar.
+ *
+ * Retorna:
+ *  - 0 si se liberó, -1 si es NULL, está pendiente o tiene hilos en espera.
+ */
+int my_future_destroy(my_future *futuro) {
+    if (futuro == NULL) {
+        return -1;
+    }
+    runtime_lock();
+    if (!futuro->listo || futuro->esperando.head) {
+        runtime_unlock();
+        return -1;
+    }
+    runtime_unlock();
+    free(futuro);
+    return 0;
+}
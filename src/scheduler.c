@@ -1,34 +1,184 @@
 #define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include "../include/scheduler.h"
 #include <stdlib.h>     // malloc, free, realloc
 #include <signal.h>     // sigaction
 #include <stdio.h>
 #include <time.h>
-#include <sys/time.h>   // setitimer, struct itimerval
+#include <sys/mman.h>   // mmap, mprotect, munmap
+#include <unistd.h>     // sysconf
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>    // workers del modo M:N
+#include <sys/epoll.h>  // espera de E/S de los hilos
+#include <sys/eventfd.h> // aviso al worker que espera en epoll
+#include <sched.h>      // sched_yield
+#include <errno.h>
 
 
-#define STACK_SIZE  (1024 * 64)  // Tamaño de pila: 64 KB
 #define QUANTUM_MS   100         // Quantum de 100 milisegundos
+#define REINTENTO_DESALOJO_US 100  // alarma aplazada: se vuelve a intentar tras 100 µs
+#define SPIN_VUELTAS 64            // vueltas de un spinlock ocupado antes de ceder el CPU al kernel
+#define TCB_POOL_MAX 1024        // Máximo de TCB con pila de 64 KB guardados para reciclar
+#define PILA_CLASES  11          // clases de tamaño de pila: 8 KB, 16 KB, ..., 8 MB
+#define PILA_AUTO_MARGEN (4 * 1024)  // margen sobre el pico: un marco de señal del desalojo (~3 KB con AVX-512)
+#define PERFILES_MAX 64          // funciones de entrada distintas en el perfil de pila
+#define RUEDA_NIVELES 4          // Niveles de la rueda de tiempo
+#define RUEDA_BITS    6
+#define RUEDA_SLOTS   (1 << RUEDA_BITS)   // 64 slots por nivel, 1 tick = 1 ms
+#define RUEDA_MASK    (RUEDA_SLOTS - 1)
+#define MAX_SCHEDULERS 8          // schedulers inicializados que schedule() puede consultar
 #define MAX_SNAPSHOTS 10000
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid   // glibc < 2.35 no lo define
+#endif
 static char *rr_snapshots[MAX_SNAPSHOTS];
 static int   rr_snapshot_count = 0;
 int scheduler_activo = 0;
 
-ThreadPool   global_thread_pool = { 0, NULL, 0, 0 };
-TCB         *hilo_actual        = NULL;
-int          next_tid           = 0;
+ThreadPool   global_thread_pool = { 0, NULL, 0, 0, NULL, 0, 0, -1 };
+_Thread_local TCB *hilo_actual  = NULL;
 ucontext_t   scheduler_ctx;
+int          modo_mn            = 0;
 
+static TCB   *tcb_libres[PILA_CLASES];         // por clase de pila: TCB listos para reutilizar
+static size_t tcb_libres_count[PILA_CLASES];
+static PilaPerfilModo pila_modo = PILA_PERFIL_APAGADO;
+static PerfilPila perfiles[PERFILES_MAX];        // uso de pila por función de entrada
+static int        perfiles_count = 0;
+static TCB   *hilos_zombie     = NULL;   // TCB terminados pendientes de reciclar
+static _Atomic long hilos_por_estado[TERMINATED + 1];  // hilos registrados en cada estado
 
+static atomic_flag runtime_spin = ATOMIC_FLAG_INIT;  // lock global del runtime en modo M:N
+static _Thread_local int runtime_lock_tomado = 0;    // este kernel thread tiene runtime_spin
+
+static TCB      *rueda[RUEDA_NIVELES][RUEDA_SLOTS];  // rueda de tiempo jerárquica
+static long long rueda_tick = 0;                      // próximo tick (ms) por procesar
+static _Atomic int hilos_durmiendo = 0;
+static _Atomic long long rueda_proximo_ms = -1;      // próximo despertar (M:N: se consulta sin runtime_lock)
+static volatile sig_atomic_t esperando_temporizador = 0;
+static EstadisticasSueno estadisticas_rueda;
+static int       es_epoll_fd = -1;                    // epoll de los hilos que esperan E/S
+static TCB     **es_esperas = NULL;                   // por fd: lista de hilos esperando
+static unsigned *es_registrado = NULL;                // por fd: eventos registrados en epoll
+static int       es_capacidad = 0;
+static _Atomic int hilos_esperando_es = 0;
+static _Atomic long long es_sondeo_ms = 0;            // último sondeo de epoll de un worker ocupado (M:N)
+static int       es_aviso_fd = -1;                    // eventfd para despertar al worker que espera en epoll (M:N)
+
+static Scheduler *schedulers[MAX_SCHEDULERS];         // schedulers inicializados
+static int        schedulers_count = 0;
+
+static _Thread_local int desalojo_suspendido = 0;   // >0: sección crítica, no se cambia de hilo
+static _Thread_local volatile sig_atomic_t desalojo_pendiente = 0;  // hubo un desalojo aplazado
+static _Atomic long desalojos_aplazados_total = 0;   // alarmas que cayeron en una sección crítica
+static _Thread_local int  encolando_ajena = 0;       // M:N: se encola en la cola de otro worker
+static _Thread_local TCB *ajena_actual    = NULL;    // hilo que ejecuta ese worker
+static _Thread_local int  ajena_desaloja  = 0;       // la política pidió desalojarlo
+
+static timer_t   quantum_timer;                      // alarma del quantum (timer_create, una sola vez)
+static int       quantum_timer_listo = 0;
+static volatile sig_atomic_t quantum_armado = 0;
+static long long quantum_vence_ns = 0;               // instante programado de la próxima alarma
+static long long quantum_fin_ns   = 0;               // fin del quantum del hilo actual (0: sin límite)
+static long long evento_ns        = 0;               // próximo despertar que puede desalojar al actual (0: ninguno)
+static long long despertando_ns   = 0;               // instante pedido del hilo que la rueda está despertando
+static EstadisticasQuantum estadisticas_q;
+static EstadisticasDesalojo estadisticas_d;
+
+extern const char __executable_start[];   // inicio y fin del código del programa (los define el enlazador)
+extern const char etext[];
+
+static void mn_encolar(TCB *hilo);
+static void mn_nueva_espera(long long despertar_ms);
+static void mn_enviar_avisos(void);
+static void mn_schedule(void);
+static void mn_alarma(siginfo_t *info, void *contexto);
+static int  mn_sacar(TCB *hilo);
+static void mn_devolver(int id, TCB *hilo);
+static void mn_actualizar(TCB *hilo);
+static long long temporizador_proximo(void);
+static void evento_adelantar(TCB *hilo);
+
+#ifdef MY_PTHREAD_ASM_SWITCH
+#ifndef __x86_64__
+#error "MY_PTHREAD_ASM_SWITCH solo está implementado para x86-64"
+#endif
+static _Thread_local volatile sig_atomic_t alarma_bloqueada = 0;  // se cambió de hilo dentro de alarm_handler
+#endif
+
+
+
+
+/**
+ * contador_sumar
+ *
+ * Suma delta al contador del estado indicado. En modo M:N varios kernel
+ * threads cambian estados a la vez y se usa una suma atómica; con un solo
+ * kernel thread basta una lectura y escritura simples.
+ *
+ * Entradas:
+ *   ThreadState estado – contador a modificar.
+ *   long delta – cantidad a sumar (puede ser negativa).
+ *
+ * Retorna:
+ *   void
+ */
+static void contador_sumar(ThreadState estado, long delta) {
+    if (modo_mn) {
+        atomic_fetch_add_explicit(&hilos_por_estado[estado], delta, memory_order_relaxed);
+    } else {
+        long valor = atomic_load_explicit(&hilos_por_estado[estado], memory_order_relaxed);
+        atomic_store_explicit(&hilos_por_estado[estado], valor + delta, memory_order_relaxed);
+    }
+}
+
+
+/**
+ * cambiar_estado
+ *
+ * Cambia el estado de un hilo y actualiza los contadores por estado. Todas
+ * las transiciones de estado del runtime pasan por aquí, así los contadores
+ * siempre reflejan los hilos registrados en global_thread_pool.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que cambia de estado.
+ *   ThreadState estado – nuevo estado.
+ *
+ * Retorna:
+ *   void
+ */
+void cambiar_estado(TCB *hilo, ThreadState estado) {
+    contador_sumar(hilo->state, -1);
+    contador_sumar(estado, 1);
+    hilo->state = estado;
+}
+
+
+/**
+ * hilos_en_estado
+ *
+ * Consulta cuántos hilos registrados se encuentran en el estado indicado. Los
+ * hilos TERMINATED se cuentan hasta que su TCB se recicla.
+ *
+ * Entradas:
+ *   ThreadState estado – estado a consultar.
+ *
+ * Retorna:
+ *   int – número de hilos en ese estado.
+ */
+int hilos_en_estado(ThreadState estado) {
+    return (int)atomic_load_explicit(&hilos_por_estado[estado], memory_order_relaxed);
+}
 
 
 /**
  * threadpool_alive_count
  *
- * Recorre el conjunto global de hilos (global_thread_pool) y cuenta
- * cuántos de ellos aún no han alcanzado el estado TERMINATED.
+ * Cuenta cuántos hilos del pool global aún no han alcanzado el estado
+ * TERMINATED, a partir de los contadores por estado (O(1)).
  *
  * Entradas:
  *   ninguna
@@ -37,14 +187,7 @@ ucontext_t   scheduler_ctx;
  *   int – número de hilos en el pool cuyo estado es distinto de TERMINATED.
  */
 int threadpool_alive_count(void) {
-    int cnt = 0;
-    for (size_t i = 0; i < global_thread_pool.count; ++i) {
-        TCB *t = global_thread_pool.threads[i];
-        if (t && t->state != TERMINATED) {
-            ++cnt;
-        }
-    }
-    return cnt;
+    return hilos_en_estado(READY) + hilos_en_estado(RUNNING) + hilos_en_estado(BLOCKED);
 }
 
 
@@ -71,21 +214,65 @@ static void ensure_capacity(ThreadPool *pool) {
 }
 
 
+/**
+ * tomar_slot
+ *
+ * Obtiene un slot libre de la tabla, reutilizando primero los slots de hilos
+ * ya reciclados y, si no hay, agregando uno nuevo al final (duplicando la
+ * capacidad de la tabla cuando hace falta).
+ *
+ * Entradas:
+ *   ThreadPool *pool – puntero al pool de hilos.
+ *
+ * Retorna:
+ *   int – índice del slot, o -1 si se agotó el espacio de tids.
+ */
+static int tomar_slot(ThreadPool *pool) {
+    if (pool->slot_libre != -1) {
+        int idx = pool->slot_libre;
+        pool->slot_libre = pool->slots[idx].siguiente_libre;
+        return idx;
+    }
+    if (pool->slot_count > TID_MASK_SLOT) {
+        return -1;
+    }
+    if (pool->slot_count + 1 > pool->slot_capacity) {
+        size_t new_cap = (pool->slot_capacity == 0 ? 4 : pool->slot_capacity * 2);
+        pool->slots = realloc(pool->slots, new_cap * sizeof(HiloSlot));
+        pool->slot_capacity = new_cap;
+    }
+    pool->slots[pool->slot_count].generacion = 0;
+    return (int)pool->slot_count++;
+}
+
+
 /**
  * registrar_hilo
  *
- * Agrega un nuevo hilo al pool, asegurando capacidad y actualizando el conteo.
+ * Agrega un nuevo hilo al pool: le asigna un slot de la tabla, forma su tid
+ * con la generación e índice del slot, y lo agrega al arreglo de hilos.
  *
  * Entradas:
  *   ThreadPool *pool – puntero al pool de hilos.
  *   TCB *hilo – puntero al bloque de control del hilo a registrar.
  *
  * Retorna:
- *   int – el tid del hilo registrado.
+ *   int – el tid del hilo registrado, o -1 si no quedan slots.
  */
 int registrar_hilo(ThreadPool *pool, TCB *hilo) {
+    int idx = tomar_slot(pool);
+    if (idx == -1) {
+        return -1;
+    }
+    HiloSlot *slot = &pool->slots[idx];
+    slot->hilo = hilo;
+    hilo->tid = (int)((slot->generacion << TID_BITS_SLOT) | (unsigned)idx);
+
     ensure_capacity(pool);
+    hilo->pool_idx = pool->count;
     pool->threads[pool->count++] = hilo;
+    pool->created_threads_counter++;
+    contador_sumar(hilo->state, 1);
     return hilo->tid;
 }
 
@@ -93,7 +280,9 @@ int registrar_hilo(ThreadPool *pool, TCB *hilo) {
 /**
  * buscar_hilo_id
  *
- * Busca en el pool un hilo cuyo tid coincida con el proporcionado.
+ * Busca el hilo con el tid proporcionado directamente en su slot. Si el slot
+ * ya fue reciclado (la generación no coincide) el tid es viejo y no se
+ * encuentra.
  *
  * Entradas:
  *   ThreadPool *pool – puntero al pool de hilos.
@@ -103,591 +292,5088 @@ int registrar_hilo(ThreadPool *pool, TCB *hilo) {
  *   TCB* – puntero al TCB del hilo encontrado o NULL si no existe.
  */
 TCB *buscar_hilo_id(ThreadPool *pool, int tid) {
-    for (size_t i = 0; i < pool->count; i++) {
-        if (pool->threads[i]->tid == tid) {
-            return pool->threads[i];
-        }
+    if (tid < 0) {
+        return NULL;
     }
-    return NULL;
+    size_t idx = (size_t)(tid & TID_MASK_SLOT);
+    unsigned generacion = (unsigned)tid >> TID_BITS_SLOT;
+    if (idx >= pool->slot_count) {
+        return NULL;
+    }
+    HiloSlot *slot = &pool->slots[idx];
+    if (slot->hilo == NULL || slot->generacion != generacion) {
+        return NULL;
+    }
+    return slot->hilo;
 }
 
 /**
- * encolar_hilo
+ * desregistrar_hilo
  *
- * Llama a la función específica del scheduler para encolar un hilo en la estructura interna.
+ * Saca un hilo del pool global: libera su slot (incrementando la generación
+ * para invalidar su tid) y lo quita del arreglo moviendo el último elemento
+ * a su posición, por lo que no hay que recorrer nada.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler que provee la función encolar_hilo.
- *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *   ThreadPool *pool – puntero al pool de hilos.
+ *   TCB *hilo – puntero al TCB que se va a sacar.
  *
  * Retorna:
- *   void – no retorna valor, da la operación al metodo interno del scheduler.
+ *   void
  */
-void encolar_hilo(Scheduler *sched, TCB *hilo) {
-    sched->encolar_hilo(sched, hilo);
+static void desregistrar_hilo(ThreadPool *pool, TCB *hilo) {
+    size_t idx = hilo->pool_idx;
+    if (idx >= pool->count || pool->threads[idx] != hilo) {
+        return;
+    }
+    TCB *ultimo = pool->threads[--pool->count];
+    pool->threads[idx] = ultimo;
+    ultimo->pool_idx = idx;
+    contador_sumar(hilo->state, -1);
+
+    int s_idx = hilo->tid & TID_MASK_SLOT;
+    HiloSlot *slot = &pool->slots[s_idx];
+    slot->hilo = NULL;
+    slot->generacion = (slot->generacion + 1) & TID_MASK_GEN;
+    slot->siguiente_libre = pool->slot_libre;
+    pool->slot_libre = s_idx;
 }
 
 
+//--------------------------------------------------------------
+//Pool de TCB y pilas
+//--------------------------------------------------------------
+
+
 /**
- * my_thread_chsched
+ * tamano_pagina
  *
- * Cambia el scheduler asignado a un hilo, removiéndolo del scheduler actual
- * y encolándolo en el nuevo scheduler. Además, actualiza el estado del hilo a READY.
+ * Retorna el tamaño de página del sistema, consultándolo una sola vez.
  *
  * Entradas:
- *   TCB *hilo – puntero al TCB del hilo cuyo scheduler se cambia.
- *   Scheduler *new_sch – puntero al nuevo scheduler donde se debe encolar el hilo.
+ *   ninguna
  *
  * Retorna:
- *   int – 0 si la operación se realizó correctamente.
+ *   size_t – tamaño de página en bytes.
  */
-int my_thread_chsched(TCB *hilo, Scheduler *new_sch) {
-
-    Scheduler *old_sch = hilo->scheduler;
-    if (old_sch)
-        old_sch->remover_hilo(old_sch, hilo);
-    hilo->scheduler = new_sch;
-    hilo->state     = READY;
-    hilo->next      = NULL;
-    new_sch->encolar_hilo(new_sch, hilo);
-
-    return 0;
+static size_t tamano_pagina(void) {
+    static size_t pagina = 0;
+    if (pagina == 0) {
+        pagina = (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return pagina;
 }
 
 
-
 /**
- * schedule
+ * reservar_pila
  *
- * Si existe un hilo actual, solicita al scheduler asociado el siguiente hilo listo
- * para ejecutarse, en caso de que haya uno, intercambia el contexto entre el hilo
- * actual y el siguiente, permitiendo la ejecución del nuevo hilo.
+ * Reserva con mmap una pila de size bytes más una página de guarda al inicio
+ * (la pila crece hacia abajo) protegida con PROT_NONE, de modo que un
+ * desbordamiento produce SIGSEGV en lugar de corromper memoria vecina.
  *
  * Entradas:
- *   ninguna
+ *   size_t size – tamaño utilizable de la pila (múltiplo de página).
  *
  * Retorna:
- *   void – no retorna valor, cambia el hilo en ejecución mediante swapcontext.
+ *   void* – inicio de la zona utilizable de la pila, o NULL si falla.
  */
-void schedule(void) {
-    if (hilo_actual == NULL) {
-        return;
+static void *reservar_pila(size_t size) {
+    size_t pagina = tamano_pagina();
+    char *base = mmap(NULL, size + pagina, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
     }
-    TCB *prev      = hilo_actual;
-    Scheduler *sch = prev->scheduler;
-    TCB *next      = sch->siguiente_hilo(sch);
-
-    if (next == NULL) {
-
-        return;
+    if (mprotect(base, pagina, PROT_NONE) == -1) {
+        munmap(base, size + pagina);
+        return NULL;
     }
-    hilo_actual = next;
-    swapcontext(&prev->context, &next->context);
-
+    return base + pagina;
 }
 
+
 /**
- * alarm_handler
+ * liberar_pila
  *
- * Captura la señal de alarma (SIGALRM) y fuerza la llamada a schedule()
- * para cambiar al siguiente hilo listo para ejecutar.
+ * Devuelve al sistema una pila reservada con reservar_pila(), incluyendo
+ * su página de guarda.
  *
  * Entradas:
- *   int sig – número de señal recibida (por lo general SIGALRM).
+ *   void *stack – inicio de la zona utilizable de la pila.
+ *   size_t size – tamaño utilizable de la pila.
  *
  * Retorna:
- *   void – no retorna valor, invoca schedule() internamente.
+ *   void
  */
-static void alarm_handler(int sig) {
-    (void)sig;
-    schedule();
+static void liberar_pila(void *stack, size_t size) {
+    size_t pagina = tamano_pagina();
+    munmap((char *)stack - pagina, size + pagina);
 }
 
 
 /**
- * start_preemption
+ * pila_perfil_modo
  *
- * Configura un manejador de señales para SIGALRM y programa un temporizador
- * que genere señales periódicas cada quantum_ms milisegundos, forzando la
- * invocación de schedule() para preempción de hilos.
+ * Activa o desactiva el perfil de uso de pila. Solo afecta a los hilos que
+ * se creen después.
  *
  * Entradas:
- *   int quantum_ms – duración del quantum en milisegundos.
+ *   PilaPerfilModo modo – APAGADO, MEDIR o AUTO.
  *
  * Retorna:
- *   void – no retorna valor, inicializa el temporizador de preempción.
+ *   void
  */
-static void start_preemption(int quantum_ms) {
-    struct sigaction sa;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_handler = alarm_handler;
-    sa.sa_flags   = 0;
-    sigaction(SIGALRM, &sa, NULL);
-
-
-    struct itimerval timer = {
-        .it_interval = { .tv_sec = quantum_ms/1000,
-                         .tv_usec = (quantum_ms%1000)*1000 },
-        .it_value    = { .tv_sec = quantum_ms/1000,
-                         .tv_usec = (quantum_ms%1000)*1000 }
-    };
-    setitimer(ITIMER_REAL, &timer, NULL);
+void pila_perfil_modo(PilaPerfilModo modo) {
+    runtime_lock();
+    pila_modo = modo;
+    runtime_unlock();
 }
 
 
-
 /**
- * rr_encolar_hilo
+ * perfil_buscar
  *
- * Encola un hilo en la cola del scheduler Round Robin, actualizando los punteros
- * head y tail y estableciendo el estado READY.
+ * Busca la entrada del perfil de una función de entrada y, si no existe y
+ * crear es 1, la agrega. El llamador debe tener runtime_lock.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler RR donde se encola el hilo.
- *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *   void (*funcion)(void*) – función de entrada.
+ *   int crear – 1 para agregar la entrada si no está.
  *
  * Retorna:
- *   void – no retorna valor, modifica las estructuras internas del scheduler.
+ *   PerfilPila* – la entrada, o NULL si no está (o la tabla está llena).
  */
-static void rr_encolar_hilo(Scheduler *sched, TCB *hilo) {
+static PerfilPila *perfil_buscar(void (*funcion)(void*), int crear) {
+    for (int i = 0; i < perfiles_count; i++) {
+        if (perfiles[i].funcion == funcion) {
+            return &perfiles[i];
+        }
+    }
+    if (!crear || perfiles_count == PERFILES_MAX) {
+        return NULL;
+    }
+    PerfilPila *perfil = &perfiles[perfiles_count++];
+    memset(perfil, 0, sizeof *perfil);
+    perfil->funcion = funcion;
+    return perfil;
+}
 
-    RR_Scheduler *rr = (RR_Scheduler*)sched;
 
-    hilo->scheduler     = sched;
-    hilo->state         = READY;
-    hilo->next          = NULL;
-    if (rr->tail == NULL) {
-        rr->head = hilo;
+/**
+ * pila_tamano_para
+ *
+ * Decide el tamaño de pila de un hilo nuevo: el pedido, si se pidió uno; en
+ * modo AUTO, si ya se midieron hilos de la misma función, el pico observado
+ * más un cuarto y PILA_AUTO_MARGEN; si no, 0 (el tamaño por defecto). El
+ * llamador debe tener runtime_lock.
+ *
+ * Entradas:
+ *   void (*funcion)(void*) – función de entrada del hilo.
+ *   size_t pedido – tamaño pedido en los atributos (0 si no se pidió).
+ *
+ * Retorna:
+ *   size_t – tamaño a pedir a tcb_pool_obtener.
+ */
+size_t pila_tamano_para(void (*funcion)(void*), size_t pedido) {
+    if (pedido != 0 || pila_modo != PILA_PERFIL_AUTO) {
+        return pedido;
     }
-    else {
-        rr->tail->next = hilo;
+    PerfilPila *perfil = perfil_buscar(funcion, 0);
+    if (perfil == NULL || perfil->hilos == 0) {
+        return 0;
     }
-    rr->tail = hilo;
+    return perfil->pico_max + perfil->pico_max / 4 + PILA_AUTO_MARGEN;
+}
 
 
+/**
+ * pila_pintar
+ *
+ * Si el perfil está activo, deja la pila de un hilo nuevo en ceros para
+ * medir después hasta dónde la usó. No se escribe la pila: madvise
+ * (MADV_DONTNEED) descarta sus páginas y el kernel las vuelve a entregar en
+ * ceros, así que pintar no ocupa memoria (y una pila reciclada la devuelve).
+ * Debe llamarse antes de preparar el contexto del hilo sobre la pila; el
+ * llamador marca pila_pintada cuando el hilo queda creado.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo recién sacado del pool.
+ *
+ * Retorna:
+ *   int – 1 si la pila quedó pintada, 0 si el perfil está apagado o falló.
+ */
+int pila_pintar(TCB *hilo) {
+    if (pila_modo == PILA_PERFIL_APAGADO) {
+        return 0;
+    }
+    return madvise(hilo->stack, hilo->stack_size, MADV_DONTNEED) == 0;
 }
 
+
 /**
- * rr_siguiente_hilo
+ * pila_pico
  *
- * Obtiene el siguiente hilo listo para ejecutar en el scheduler Round Robin.
- * - Elimina de la cola los hilos cuyo estado es TERMINATED.
- * - Si la cola está vacía, retorna NULL.
- * - Extrae el hilo en la cabeza de la cola.
- * - Si su estado es READY, lo reencola al final para futura ejecución.
+ * Mide cuánto usó un hilo de su pila pintada. La pila crece hacia abajo, así
+ * que el pico es la distancia entre el final de la pila y la palabra distinta
+ * de cero más baja. mincore indica qué páginas llegaron a tocarse, de modo
+ * que solo se recorre desde la más baja de ellas y sin tocar las demás.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler RR.
+ *   TCB *hilo – hilo terminado cuya pila ya nadie usa.
  *
  * Retorna:
- *   TCB* – puntero al TCB del hilo seleccionado o NULL si no hay hilos listos.
+ *   size_t – bytes usados de la pila.
  */
-static TCB *rr_siguiente_hilo(Scheduler *sched) {
-    RR_Scheduler *rr = (RR_Scheduler*)sched;
+static size_t pila_pico(TCB *hilo) {
+    size_t pagina  = tamano_pagina();
+    size_t paginas = hilo->stack_size / pagina;
+    char  *inicio  = hilo->stack;
+    char  *fin     = inicio + hilo->stack_size;
+    size_t primera = paginas;
+    unsigned char residentes[64];
 
-    while (rr->head && rr->head->state == TERMINATED) {
-        TCB *dead = rr->head;
-        rr->head = dead->next;
-        if (dead == rr->tail) {
-            rr->tail = NULL;
+    for (size_t p = 0; p < paginas && primera == paginas; p += sizeof residentes) {
+        size_t n = paginas - p < sizeof residentes ? paginas - p : sizeof residentes;
+        if (mincore(inicio + p * pagina, n * pagina, residentes) != 0) {
+            return 0;
+        }
+        for (size_t k = 0; k < n; k++) {
+            if (residentes[k] & 1) {
+                primera = p + k;
+                break;
+            }
         }
-        dead->next = NULL;
-    }
-
-    if (!rr->head) {
-        return NULL;
-    }
-
-    TCB *chosen = rr->head;
-    rr->head    = chosen->next;
-    if (!rr->head) {
-        rr->tail = NULL;
     }
-    chosen->next = NULL;
-
-    if (chosen->state == READY) {
-        if (rr->tail) {
-            rr->tail->next = chosen;
-        } else {
-            rr->head = chosen;
+    for (long *palabra = (long *)(inicio + primera * pagina); (char *)palabra < fin; palabra++) {
+        if (*palabra != 0) {
+            return (size_t)(fin - (char *)palabra);
         }
-        rr->tail = chosen;
     }
-
-    return chosen;
+    return 0;
 }
 
+
 /**
- * rr_remover_hilo
+ * pila_medir
  *
- * Elimina un hilo específico de la cola del scheduler Round Robin, ajustando
- * los punteros head y tail según corresponda.
+ * Si la pila del hilo se pintó al crearlo, mide su pico de uso y lo suma al
+ * perfil de su función de entrada. El llamador debe tener runtime_lock.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler RR del cual se debe remover el hilo.
- *   TCB *hilo – puntero al TCB del hilo que se desea eliminar.
+ *   TCB *hilo – hilo terminado que vuelve al pool.
  *
  * Retorna:
- *   void – no retorna valor, modifica la estructura interna del scheduler eliminando el hilo.
+ *   void
  */
-
-static void rr_remover_hilo(Scheduler *sched, TCB *hilo) {
-    RR_Scheduler *rr = (RR_Scheduler*)sched;
-    TCB *prev = NULL;
-    TCB *it = rr->head;
-
-    while (it && it != hilo) {
-        prev = it;
-        it   = it->next;
-    }
-    if (!it) {
+static void pila_medir(TCB *hilo) {
+    if (!hilo->pila_pintada) {
         return;
     }
-
-    if (prev) {
-        prev->next = it->next;
-    }
-    else {
-        rr->head = it->next;
+    hilo->pila_pintada = 0;
+    PerfilPila *perfil = perfil_buscar(hilo->funcion, 1);
+    if (perfil == NULL) {
+        return;
     }
-    if (rr->tail == it) {
-        rr->tail = prev;
+    size_t pico = pila_pico(hilo);
+    perfil->hilos++;
+    perfil->pico_total += pico;
+    perfil->pila_tam    = hilo->stack_size;
+    if (pico > perfil->pico_max) {
+        perfil->pico_max = pico;
     }
-    it->next = NULL;
 }
 
 
 /**
- * rr_scheduler_init
+ * pila_perfiles
  *
- * Inicializa el scheduler Round Robin, asignando los punteros a las
- * funciones de encolado, selección y remover de hilos; establece el
- * quantum de tiempo, limpia la cabeza y cola, activa el scheduler y
- * arranca el temporizador de preempción.
+ * Copia el perfil de uso de pila: una entrada por función de entrada de los
+ * hilos medidos.
  *
  * Entradas:
- *   RR_Scheduler *rr – puntero al struct RR_Scheduler a inicializar.
- *   int quantum_ms – duración del quantum en milisegundos.
+ *   PerfilPila *out – arreglo donde se copian las entradas.
+ *   int max – capacidad de out.
  *
  * Retorna:
- *   void – no retorna valor, configura la estructura y arranca la preempción.
+ *   int – cantidad de entradas copiadas.
  */
-void rr_scheduler_init(RR_Scheduler *rr, int quantum_ms) {
-    rr->base.encolar_hilo   = rr_encolar_hilo;
-    rr->base.siguiente_hilo = rr_siguiente_hilo;
-    rr->base.remover_hilo    = rr_remover_hilo;
-    rr->quantum             = quantum_ms;
-    rr->head = rr->tail     = NULL;
-    scheduler_activo = 1;
-    start_preemption(quantum_ms);
-
-
+int pila_perfiles(PerfilPila *out, int max) {
+    runtime_lock();
+    int n = perfiles_count < max ? perfiles_count : max;
+    memcpy(out, perfiles, (size_t)n * sizeof *out);
+    runtime_unlock();
+    return n;
 }
 
 
-
-
-//--------------------------------------------------------------
-//Lottery Scheduler
-//--------------------------------------------------------------
-
-
 /**
- * lottery_encolar_hilo
+ * pila_clase
  *
- * Encola un hilo en la lista del scheduler Lottery, asignándole su scheduler,
- * marcándolo como READY y agregándolo al final de la lista enlazada.
+ * Ubica un tamaño de pila en su clase del pool: la menor potencia de dos
+ * (desde PILA_TAMANO_MINIMO) que lo contiene. Un tamaño 0 pide la pila por
+ * defecto. Las pilas más grandes que la última clase no se reciclan y solo
+ * se redondean a páginas.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler de tipo Lottery.
- *   TCB *hilo – puntero al bloque de control del hilo a encolar.
+ *   size_t *tam – tamaño pedido; al volver queda el tamaño que se reserva.
  *
  * Retorna:
- *   void – no retorna valor, modifica la estructura interna del scheduler.
+ *   int – índice de la clase, o -1 si la pila no se recicla.
  */
-static void lottery_encolar_hilo(Scheduler *sched, TCB *hilo) {
-    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
-    hilo->scheduler = sched;
-    hilo->state     = READY;
-    hilo->next      = NULL;
-
-    if (ls->head == NULL) {
-        ls->head = hilo;
-    } else {
-        TCB *it = ls->head;
-        while (it->next) {
-            it = it->next;
+static int pila_clase(size_t *tam) {
+    if (*tam == 0) {
+        *tam = PILA_TAMANO_DEFECTO;
+    }
+    size_t clase_tam = PILA_TAMANO_MINIMO;
+    for (int clase = 0; clase < PILA_CLASES; clase++, clase_tam *= 2) {
+        if (*tam <= clase_tam) {
+            *tam = clase_tam;
+            return clase;
         }
-        it->next = hilo;
     }
+    size_t pagina = tamano_pagina();
+    *tam = (*tam + pagina - 1) / pagina * pagina;
+    return -1;
 }
 
+
 /**
- * lottery_siguiente_hilo
+ * pila_clase_max
  *
- * Selecciona el siguiente hilo a ejecutar en el scheduler Lottery:
- * - Si existe un hilo actualmente en RUNNING, lo cambia a READY y lo reencola.
- * - Calcula el total de boletos de todos los hilos en READY.
- * - Genera un número aleatorio entre 1 y total, y encuentra el hilo ganador
- *   acumulando boletos hasta alcanzar el valor aleatorio.
- * - Remueve al hilo ganador de la lista y lo marca como RUNNING.
+ * Cuántos TCB libres puede guardar una clase: TCB_POOL_MAX pilas de 64 KB,
+ * o la cantidad de pilas de la clase que ocupan lo mismo (al menos una), de
+ * modo que las clases grandes no retengan mucha memoria.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler de tipo Lottery.
+ *   int clase – índice de la clase.
  *
  * Retorna:
- *   TCB* – puntero al TCB del hilo ganador (estado RUNNING), o NULL si no hay
- *          hilos listos o si la suma de boletos es menor igual a 0.
+ *   size_t – máximo de TCB libres de esa clase.
  */
-static TCB *lottery_siguiente_hilo(Scheduler *sched) {
-    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
-    TCB *prev = hilo_actual;
+static size_t pila_clase_max(int clase) {
+    size_t max = (size_t)TCB_POOL_MAX * PILA_TAMANO_DEFECTO / ((size_t)PILA_TAMANO_MINIMO << clase);
+    return max > 0 ? max : 1;
+}
 
-    if (prev && prev->state == RUNNING) {
-        prev->state = READY;
-        prev->next  = NULL;
 
-        if (!ls->head) {
-            ls->head = prev;
-        } else {
-            TCB *it = ls->head;
-            while (it->next) it = it->next;
-            it->next = prev;
-        }
+/**
+ * tcb_pool_nuevo
+ *
+ * Reserva un TCB nuevo con una pila del tamaño indicado.
+ *
+ * Entradas:
+ *   size_t tam_pila – tamaño ya ajustado por pila_clase.
+ *
+ * Retorna:
+ *   TCB* – TCB con stack y stack_size válidos, o NULL si no hay memoria.
+ */
+static TCB *tcb_pool_nuevo(size_t tam_pila) {
+    TCB *hilo = malloc(sizeof *hilo);
+    if (hilo == NULL) {
+        return NULL;
+    }
+    hilo->stack = reservar_pila(tam_pila);
+    if (hilo->stack == NULL) {
+        free(hilo);
+        return NULL;
     }
+    hilo->stack_size = tam_pila;
+    hilo->next = NULL;
+    hilo->pila_pintada = 0;
+    return hilo;
+}
+
 
-    int total = 0;
-    for (TCB *it = ls->head; it; it = it->next) {
-        if (it->state == READY)
-            total += it->tickets;
+/**
+ * tcb_pool_obtener
+ *
+ * Entrega un TCB con una pila de al menos tam_pila bytes. El pool tiene una
+ * lista de libres por clase de tamaño: si la de la clase pedida tiene algún
+ * TCB reciclado se reutiliza (sin llamar al asignador), si no, se reserva uno
+ * nuevo. Así los hilos con pilas chicas no ocupan pilas grandes de otros.
+ *
+ * Entradas:
+ *   size_t tam_pila – tamaño de pila pedido (0 para PILA_TAMANO_DEFECTO).
+ *
+ * Retorna:
+ *   TCB* – TCB con stack y stack_size válidos, o NULL si no hay memoria.
+ */
+TCB *tcb_pool_obtener(size_t tam_pila) {
+    int clase = pila_clase(&tam_pila);
+    if (clase >= 0 && tcb_libres[clase] != NULL) {
+        TCB *hilo = tcb_libres[clase];
+        tcb_libres[clase] = hilo->next;
+        tcb_libres_count[clase]--;
+        hilo->next = NULL;
+        return hilo;
     }
-    if (total <= 0)
-        return NULL;
+    return tcb_pool_nuevo(tam_pila);
+}
+
 
-    int winner = (rand() % total) + 1;
-    int acc    = 0;
+/**
+ * tcb_pool_devolver
+ *
+ * Regresa un TCB (y su pila) a la lista de libres de su clase para ser
+ * reutilizado, midiendo antes el uso de la pila si estaba pintada. Si esa lista ya está llena (pila_clase_max) o la pila no es de
+ * ninguna clase, la pila y el TCB se liberan.
+ *
+ * Entradas:
+ *   TCB *hilo – TCB que ya no está en ninguna cola.
+ *
+ * Retorna:
+ *   void
+ */
+void tcb_pool_devolver(TCB *hilo) {
+    pila_medir(hilo);
+    size_t tam   = hilo->stack_size;
+    int    clase = pila_clase(&tam);
+    if (clase < 0 || tcb_libres_count[clase] >= pila_clase_max(clase)) {
+        liberar_pila(hilo->stack, hilo->stack_size);
+        free(hilo);
+        return;
+    }
+    hilo->next = tcb_libres[clase];
+    tcb_libres[clase] = hilo;
+    tcb_libres_count[clase]++;
+}
 
-    TCB *mejor = NULL;
-    TCB *prev_mejor = NULL;
-    TCB *it = ls->head;
-    TCB *prev_it = NULL;
 
-    for (; it; prev_it = it, it = it->next) {
-        if (it->state != READY)
-            continue;
-        acc += it->tickets;
-        if (acc >= winner) {
-            mejor       = it;
-            prev_mejor  = prev_it;
-            break;
+/**
+ * tcb_pool_precalentar
+ *
+ * Reserva por adelantado n TCB con pilas de tamaño por defecto y los deja en
+ * la lista de libres, para que la creación de los primeros hilos no pase por
+ * mmap/malloc.
+ *
+ * Entradas:
+ *   size_t n – cantidad de TCB a reservar.
+ *
+ * Retorna:
+ *   int – 0 si se reservaron todos, -1 si falló alguna reserva.
+ */
+int tcb_pool_precalentar(size_t n) {
+    size_t tam   = PILA_TAMANO_DEFECTO;
+    int    clase = pila_clase(&tam);
+    while (tcb_libres_count[clase] < n && tcb_libres_count[clase] < pila_clase_max(clase)) {
+        TCB *hilo = tcb_pool_nuevo(tam);
+        if (hilo == NULL) {
+            return -1;
         }
+        tcb_pool_devolver(hilo);
     }
+    return 0;
+}
 
-    if (!mejor)
-        return NULL;
-
-    if (prev_mejor)
-        prev_mejor->next = mejor->next;
-    else
-        ls->head = mejor->next;
 
-    mejor->next = NULL;
-    mejor->state = RUNNING;
-    return mejor;
+/**
+ * hilo_reciclable
+ *
+ * Indica si un hilo TERMINATED puede reciclarse en cuanto deje la CPU: está
+ * detached y no quedan joiners por recoger su retval. Si no, su TCB queda
+ * retenido hasta que lo recoja un join (o lo libere un detach posterior).
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que acaba de terminar.
+ *
+ * Retorna:
+ *   int – 1 si se recicla al salir, 0 si queda retenido.
+ */
+static int hilo_reciclable(TCB *hilo) {
+    return hilo->detached && hilo->joins_pendientes == 0;
 }
 
+
 /**
- * lottery_remover_hilo
+ * hilo_terminado
  *
- * Elimina un hilo específico de la lista del scheduler Lottery, ajustando
- * punteros para removerlo de la lista enlazada.
+ * Si un hilo TERMINATED es reciclable, lo deja en la lista de zombies. No
+ * está en la cola de su scheduler (solo termina el hilo en ejecución, y las
+ * colas solo tienen hilos READY). No se puede reciclar de inmediato porque el
+ * hilo todavía se está ejecutando sobre su propia pila; lo recicla
+ * liberar_hilos_terminados() en el siguiente schedule(). En modo M:N lo
+ * recicla el worker al volver a su contexto, así que aquí no se hace nada.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler de tipo Lottery del cual se remueve el hilo.
- *   TCB *hilo – puntero al bloque de control del hilo que se desea eliminar.
+ *   TCB *hilo – TCB del hilo que acaba de terminar.
  *
  * Retorna:
- *   void – no retorna valor, modifica la estructura interna del scheduler eliminando el hilo.
+ *   void
  */
-
-static void lottery_remover_hilo(Scheduler *sched, TCB *hilo) {
-    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
-    TCB *prev = NULL;
-    TCB *it = ls->head;
-    while (it && it != hilo) {
-        prev = it;
-        it   = it->next;
-    }
-    if (!it) {
+void hilo_terminado(TCB *hilo) {
+    if (modo_mn) {
         return;
     }
-    if (prev) {
-        prev->next = it->next;
-    }
-    else {
-        ls->head  = it->next;
+    if (hilo_reciclable(hilo)) {
+        hilo->next = hilos_zombie;
+        hilos_zombie = hilo;
     }
-    it->next = NULL;
 }
 
 
 /**
- * lottery_scheduler_init
+ * hilo_reciclar
  *
- * Inicializa el scheduler Lottery, asignando las funciones de encolado, selección y remover de hilos;
- * establece la cabeza de la lista en NULL, configura el quantum de tiempo, activa el scheduler,
- * arranca el temporizador de preempción y siembra el generador de números aleatorios.
+ * Devuelve al pool el TCB de un hilo TERMINATED que quedó retenido, cuando el
+ * último joiner recoge su retval o cuando se hace detach después de terminar.
+ * El hilo ya no está en la CPU, así que su pila se puede reutilizar de una
+ * vez. El llamador debe tener runtime_lock.
  *
  * Entradas:
- *   Lottery_Scheduler *ls – puntero al struct Lottery_Scheduler a inicializar.
- *   int quantum_ms – duración del quantum en milisegundos.
+ *   TCB *hilo – hilo terminado a reciclar.
  *
  * Retorna:
- *   void – no retorna valor, configura la estructura interna y arranca la preempción.
+ *   void
  */
-void lottery_scheduler_init(Lottery_Scheduler *ls, int quantum_ms) {
-    ls->base.encolar_hilo   = lottery_encolar_hilo;
-    ls->base.siguiente_hilo = lottery_siguiente_hilo;
-    ls->base.remover_hilo    = lottery_remover_hilo;
-    ls->head                = NULL;
-    ls->quantum             = quantum_ms;
-    scheduler_activo = 2;
-    start_preemption(quantum_ms);
-    srand((unsigned)time(NULL));
+void hilo_reciclar(TCB *hilo) {
+    desregistrar_hilo(&global_thread_pool, hilo);
+    tcb_pool_devolver(hilo);
 }
 
 
+/**
+ * liberar_hilos_terminados
+ *
+ * Recorre la lista de zombies y devuelve al pool cada TCB cuya pila ya no está
+ * en uso (todos menos el hilo actual), sacándolo también del pool global.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void liberar_hilos_terminados(void) {
+    TCB **it = &hilos_zombie;
+    while (*it) {
+        TCB *hilo = *it;
+        if (hilo == hilo_actual) {
+            it = &hilo->next;
+            continue;
+        }
+        *it = hilo->next;
+        desregistrar_hilo(&global_thread_pool, hilo);
+        tcb_pool_devolver(hilo);
+    }
+}
 
 //--------------------------------------------------------------
-//Real Time Scheduler con EDF
+//Rueda de tiempo para hilos dormidos
 //--------------------------------------------------------------
 
 
 /**
- * edf_siguiente_hilo
+ * reloj_ns
  *
- * Recorre la lista de hilos del scheduler EDF y selecciona el hilo READY con
- * el deadline más cercano. Marca ese hilo como RUNNING antes de retornarlo.
+ * Retorna el tiempo de CLOCK_MONOTONIC en nanosegundos. Se puede llamar
+ * desde alarm_handler.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler de tipo EDF.
+ *   ninguna
  *
  * Retorna:
- *   TCB* – puntero al TCB del hilo seleccionado (con el menor deadline) marcado como RUNNING,
- *          o NULL si no hay hilos en READY.
+ *   long long – nanosegundos desde un origen arbitrario.
  */
-static TCB *edf_siguiente_hilo(Scheduler *sched) {
-    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
-    TCB *mejor = NULL;
-    for (TCB *it = edf_scheduler->head; it; it = it->next) {
+static long long reloj_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-        if (it->state != READY)
-            continue;
 
-        if (!mejor || it->deadline < mejor->deadline)
-            mejor = it;
-    }
-    if (!mejor)
-        return NULL;
-    mejor->state = RUNNING;
-    return mejor;
+/**
+ * reloj_us
+ *
+ * Retorna el tiempo de CLOCK_MONOTONIC en microsegundos.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   long long – microsegundos desde un origen arbitrario.
+ */
+static long long reloj_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
 }
 
 
 /**
- * edf_encolar_hilo
+ * reloj_ms
  *
- * Agrega un hilo a la lista del scheduler EDF, marcándolo como READY.
- * Si el nuevo hilo tiene un deadline menor al del hilo actualmente en ejecución,
- * se fuerza un cambio de contexto para ejecutar de inmediato el hilo con deadline más cercano.
+ * Retorna el tiempo de CLOCK_MONOTONIC en milisegundos; es la base de tiempo
+ * de la rueda y de my_thread_sleep_until.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler de tipo EDF.
- *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *   ninguna
  *
  * Retorna:
- *   void – no retorna valor, modifica la estructura interna del scheduler y
- *          puede invocar swapcontext si el nuevo hilo tiene
- *          deadline más cercano que el hilo actual.
+ *   long long – milisegundos desde un origen arbitrario.
  */
-static void edf_encolar_hilo(Scheduler *sched, TCB *hilo) {
+long long reloj_ms(void) {
+    return reloj_us() / 1000;
+}
 
-    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
-    hilo->scheduler = sched;
-    hilo->state     = READY;
-    hilo->next      = NULL;
-    if (!edf_scheduler->head) {
-        edf_scheduler->head = hilo;
+
+/**
+ * rueda_insertar
+ *
+ * Coloca un hilo en el slot de la rueda que le corresponde según cuánto falta
+ * para su despertar: el nivel 0 cubre los próximos 64 ms uno por uno y cada
+ * nivel superior cubre 64 veces más tiempo con slots 64 veces más anchos. Lo
+ * que no cabe en el último nivel se deja en el slot más lejano y se vuelve a
+ * ubicar cuando llegue.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo con despertar_ms asignado.
+ *
+ * Retorna:
+ *   void
+ */
+static void rueda_insertar(TCB *hilo) {
+    long long expira = hilo->despertar_ms;
+    long long delta  = expira - rueda_tick;
+    int nivel = 0;
+
+    if (delta < 0) {
+        expira = rueda_tick;
     } else {
-        TCB *it = edf_scheduler->head;
-        while (it->next)
-            it = it->next;
-        it->next = hilo;
-    }
-    if (hilo_actual && (hilo->deadline < hilo_actual->deadline)) {
-        TCB *prev = hilo_actual;
-        prev->state = READY;
-        TCB *next = edf_siguiente_hilo(sched);
-        if (next && next != prev) {
-            next->state = RUNNING;
-            hilo_actual = next;
-            swapcontext(&prev->context, &next->context);
+        while (nivel < RUEDA_NIVELES - 1 &&
+               delta >= (1LL << (RUEDA_BITS * (nivel + 1)))) {
+            nivel++;
+        }
+        long long max = (1LL << (RUEDA_BITS * RUEDA_NIVELES)) - 1;
+        if (delta > max) {
+            expira = rueda_tick + max;
         }
     }
+    int idx = (int)((expira >> (RUEDA_BITS * nivel)) & RUEDA_MASK);
 
+    hilo->timer_prev = NULL;
+    hilo->timer_next = rueda[nivel][idx];
+    if (hilo->timer_next) {
+        hilo->timer_next->timer_prev = hilo;
+    }
+    rueda[nivel][idx] = hilo;
+    hilo->timer_slot  = &rueda[nivel][idx];
 }
 
 
 /**
- * edf_remover_hilo
+ * rueda_cascada
  *
- * Elimina un hilo específico de la lista del scheduler EDF, ajustando punteros
- * para removerlo de la lista enlazada.
+ * Vacía un slot de un nivel superior y reinserta sus hilos, que ahora caen en
+ * niveles más finos. Se llama cuando el nivel inferior completa una vuelta.
  *
  * Entradas:
- *   Scheduler *sched – puntero al scheduler de tipo EDF del cual se remueve el hilo.
- *   TCB *hilo – puntero al bloque de control del hilo que se desea eliminar.
+ *   int nivel – nivel del slot a vaciar (1 o más).
+ *   int idx – índice del slot.
  *
  * Retorna:
- *   void – no retorna valor, modifica la estructura interna del scheduler eliminando el hilo.
+ *   int – el índice vaciado (si es 0 hay que seguir en cascada al nivel siguiente).
  */
-static void edf_remover_hilo(Scheduler *sched, TCB *hilo) {
-    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
-    TCB *prev = NULL;
-    TCB *it = edf_scheduler->head;
-    while (it && it != hilo) {
-        prev = it;
-        it   = it->next;
+static int rueda_cascada(int nivel, int idx) {
+    TCB *it = rueda[nivel][idx];
+    rueda[nivel][idx] = NULL;
+    while (it) {
+        TCB *sig = it->timer_next;
+        rueda_insertar(it);
+        it = sig;
     }
-    if (!it) {
+    return idx;
+}
+
+
+/**
+ * temporizador_agregar
+ *
+ * Duerme un hilo hasta hilo->despertar_ms: lo agrega a la rueda de tiempo. El
+ * llamador debe haberlo marcado BLOCKED (y en modo M:N tener runtime_lock).
+ * En modo M:N adelanta rueda_proximo_ms y avisa a los workers ociosos si el
+ * despertar adelanta su espera; en modo 1:1 adelanta la alarma si el
+ * despertar puede desalojar al hilo en ejecución.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a dormir.
+ *
+ * Retorna:
+ *   void
+ */
+void temporizador_agregar(TCB *hilo) {
+    if (atomic_load_explicit(&hilos_durmiendo, memory_order_relaxed) == 0) {
+        rueda_tick = reloj_ms();
+    }
+    rueda_insertar(hilo);
+    hilo->en_rueda = 1;
+    atomic_fetch_add_explicit(&hilos_durmiendo, 1, memory_order_relaxed);
+    if (modo_mn) {
+        long long proximo = atomic_load_explicit(&rueda_proximo_ms, memory_order_relaxed);
+        if (proximo < 0 || hilo->despertar_ms < proximo) {
+            atomic_store_explicit(&rueda_proximo_ms, hilo->despertar_ms, memory_order_relaxed);
+        }
+        mn_nueva_espera(hilo->despertar_ms);
+    } else {
+        evento_adelantar(hilo);
+    }
+}
+
+
+/**
+ * temporizador_quitar
+ *
+ * Saca un hilo de la rueda de tiempo antes de que venza (por ejemplo, una
+ * espera con límite que fue señalada a tiempo) en O(1): si es la cabeza de su
+ * slot lo ubica por timer_slot. Si el hilo no está en la rueda no hace nada.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a sacar.
+ *
+ * Retorna:
+ *   void
+ */
+void temporizador_quitar(TCB *hilo) {
+    if (!hilo->en_rueda) {
         return;
     }
-    if (prev) {
-        prev->next = it->next;
+    if (hilo->timer_prev) {
+        hilo->timer_prev->timer_next = hilo->timer_next;
+    } else {
+        *hilo->timer_slot = hilo->timer_next;    // es la cabeza de su slot
     }
-    else {
-        edf_scheduler->head  = it->next;
+    if (hilo->timer_next) {
+        hilo->timer_next->timer_prev = hilo->timer_prev;
     }
-    it->next = NULL;
+    hilo->timer_next = hilo->timer_prev = NULL;
+    hilo->timer_slot = NULL;
+    hilo->en_rueda   = 0;
+    atomic_fetch_sub_explicit(&hilos_durmiendo, 1, memory_order_relaxed);
 }
 
 
 /**
- * edf_scheduler_init
+ * temporizador_avanzar
  *
- * Inicializa el scheduler EDF, asignando las funciones de encolado, selección y remover de hilos;
- * establece la cabeza de la lista en NULL y desactiva la preempción específica de EDF.
+ * Procesa los ticks de la rueda hasta el instante actual: en cada tick hace
+ * la cascada de los niveles superiores cuando corresponde y despierta (READY y
+ * encolado en su scheduler) a los hilos del slot del nivel 0. Registra el
+ * retraso de cada despertar en las estadísticas. En modo M:N deja en
+ * rueda_proximo_ms el próximo despertar, para que los workers sepan sin
+ * tomar runtime_lock cuándo vuelve a hacer falta avanzarla.
  *
  * Entradas:
- *   EDF_Scheduler *edf_scheduler – puntero al struct EDF_Scheduler a inicializar.
+ *   ninguna
  *
  * Retorna:
- *   void – no retorna valor; configura la estructura interna del scheduler.
+ *   void
  */
-void edf_scheduler_init(EDF_Scheduler *edf_scheduler) {
-    edf_scheduler->base.encolar_hilo   = edf_encolar_hilo;
-    edf_scheduler->base.siguiente_hilo = edf_siguiente_hilo;
-    edf_scheduler->base.remover_hilo    = edf_remover_hilo;
-    edf_scheduler->head                = NULL;
-    scheduler_activo = 0;
+static void temporizador_avanzar(void) {
+    if (atomic_load_explicit(&hilos_durmiendo, memory_order_relaxed) == 0) {
+        return;
+    }
+    long long ahora_us = reloj_us();
+    long long ahora    = ahora_us / 1000;
+
+    while (rueda_tick <= ahora && hilos_durmiendo > 0) {
+        int idx = (int)(rueda_tick & RUEDA_MASK);
+        for (int nivel = 1; idx == 0 && nivel < RUEDA_NIVELES; nivel++) {
+            idx = rueda_cascada(nivel, (int)((rueda_tick >> (RUEDA_BITS * nivel)) & RUEDA_MASK));
+        }
+
+        TCB *it = rueda[0][rueda_tick & RUEDA_MASK];
+        rueda[0][rueda_tick & RUEDA_MASK] = NULL;
+        while (it) {
+            TCB *sig = it->timer_next;
+            it->timer_next = it->timer_prev = NULL;
+            it->timer_slot = NULL;
+            if (it->despertar_ms > rueda_tick) {
+                rueda_insertar(it);      // venía recortado del último nivel
+            } else {
+                long long retraso = ahora_us - it->despertar_ms * 1000;
+                if (retraso < 0) {
+                    retraso = 0;
+                }
+                estadisticas_rueda.despertados++;
+                estadisticas_rueda.retraso_total_us += retraso;
+                if (retraso > estadisticas_rueda.retraso_max_us) {
+                    estadisticas_rueda.retraso_max_us = retraso;
+                }
+                atomic_fetch_sub_explicit(&hilos_durmiendo, 1, memory_order_relaxed);
+                it->en_rueda = 0;
+                if (it->en_cola) {
+                    // Venció una espera con límite: sale de la cola de espera
+                    cola_espera_quitar(it->en_cola, it);
+                    it->espera_vencida = 1;
+                }
+                cambiar_estado(it, READY);
+                despertando_ns = modo_mn ? 0 : it->despertar_ms * 1000000LL;
+                encolar_hilo(it->scheduler, it);
+                despertando_ns = 0;
+            }
+            it = sig;
+        }
+        rueda_tick++;
+    }
+    if (hilos_durmiendo == 0) {
+        rueda_tick = ahora + 1;
+    }
+    if (modo_mn) {
+        atomic_store_explicit(&rueda_proximo_ms, temporizador_proximo(), memory_order_relaxed);
+    }
+}
+
+
+/**
+ * temporizador_proximo
+ *
+ * Calcula el instante del próximo despertar pendiente. En cada nivel basta con
+ * revisar el primer slot ocupado a partir de la posición actual (en los niveles
+ * superiores el slot actual ya pasó, así que se revisa de último); el
+ * resultado es el menor entre niveles.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   long long – instante (reloj_ms) del próximo despertar, o -1 si no hay hilos dormidos.
+ */
+static long long temporizador_proximo(void) {
+    long long proximo = -1;
+    for (int nivel = 0; nivel < RUEDA_NIVELES; nivel++) {
+        int actual = (int)((rueda_tick >> (RUEDA_BITS * nivel)) & RUEDA_MASK);
+        int inicio = (nivel == 0) ? 0 : 1;
+        for (int k = inicio; k < inicio + RUEDA_SLOTS; k++) {
+            TCB *it = rueda[nivel][(actual + k) & RUEDA_MASK];
+            if (it == NULL) {
+                continue;
+            }
+            for (; it; it = it->timer_next) {
+                if (proximo == -1 || it->despertar_ms < proximo) {
+                    proximo = it->despertar_ms;
+                }
+            }
+            break;
+        }
+    }
+    return proximo;
+}
+
+
+//--------------------------------------------------------------
+//Colas de espera (mutex, condiciones, semáforos, barreras)
+//--------------------------------------------------------------
+
+
+/**
+ * cola_espera_init
+ *
+ * Deja una cola de espera vacía.
+ *
+ * Entradas:
+ *   ColaEspera *cola – cola a inicializar.
+ *
+ * Retorna:
+ *   void
+ */
+void cola_espera_init(ColaEspera *cola) {
+    cola->head = NULL;
+    cola->tail = NULL;
+}
+
+
+/**
+ * cola_espera_quitar
+ *
+ * Saca un hilo específico de una cola de espera (usado cuando vence el
+ * límite de tiempo de su espera).
+ *
+ * Entradas:
+ *   ColaEspera *cola – cola donde está el hilo.
+ *   TCB *hilo – hilo a sacar.
+ *
+ * Retorna:
+ *   int – 1 si estaba en la cola, 0 si no.
+ */
+int cola_espera_quitar(ColaEspera *cola, TCB *hilo) {
+    TCB *anterior = NULL;
+    for (TCB *it = cola->head; it; anterior = it, it = it->next) {
+        if (it != hilo) {
+            continue;
+        }
+        if (anterior) {
+            anterior->next = it->next;
+        } else {
+            cola->head = it->next;
+        }
+        if (cola->tail == it) {
+            cola->tail = anterior;
+        }
+        it->next    = NULL;
+        it->en_cola = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * cola_espera_bloquear
+ *
+ * Agrega un hilo al final de una cola de espera y lo marca BLOCKED. Si se da
+ * un límite, el hilo también entra en la rueda de tiempo y, si vence antes de
+ * ser despertado, sale de la cola con espera_vencida = 1. El llamador debe
+ * tener runtime_lock y llamar a schedule() después.
+ *
+ * Entradas:
+ *   ColaEspera *cola – cola donde esperará el hilo.
+ *   TCB *hilo – hilo que espera (normalmente hilo_actual).
+ *   long long limite_ms – instante (reloj_ms) límite de la espera, o -1 sin límite.
+ *
+ * Retorna:
+ *   void
+ */
+void cola_espera_bloquear(ColaEspera *cola, TCB *hilo, long long limite_ms) {
+    hilo->next           = NULL;
+    hilo->en_cola        = cola;
+    hilo->espera_vencida = 0;
+    if (cola->tail) {
+        cola->tail->next = hilo;
+    } else {
+        cola->head = hilo;
+    }
+    cola->tail = hilo;
+    cambiar_estado(hilo, BLOCKED);
+    if (limite_ms >= 0) {
+        hilo->despertar_ms = limite_ms;
+        temporizador_agregar(hilo);
+    }
+}
+
+
+/**
+ * cola_espera_despertar
+ *
+ * Saca el primer hilo de una cola de espera (y de la rueda de tiempo si
+ * esperaba con límite), lo marca READY y lo encola en su propio scheduler,
+ * sea RR, Lottery o EDF. El llamador debe tener runtime_lock.
+ *
+ * Entradas:
+ *   ColaEspera *cola – cola de la que se despierta.
+ *
+ * Retorna:
+ *   TCB* – hilo despertado, o NULL si la cola estaba vacía.
+ */
+TCB *cola_espera_despertar(ColaEspera *cola) {
+    TCB *hilo = cola->head;
+    if (hilo == NULL) {
+        return NULL;
+    }
+    cola->head = hilo->next;
+    if (cola->head == NULL) {
+        cola->tail = NULL;
+    }
+    hilo->next    = NULL;
+    hilo->en_cola = NULL;
+    temporizador_quitar(hilo);
+    cambiar_estado(hilo, READY);
+    encolar_hilo(hilo->scheduler, hilo);
+    return hilo;
+}
+
+
+/**
+ * cola_espera_despertar_todos
+ *
+ * Despierta de una vez a todos los hilos de una cola de espera: separa la
+ * lista completa de la cola y luego marca READY y encola cada hilo en su
+ * scheduler. El llamador debe tener runtime_lock (y normalmente el desalojo
+ * suspendido, para que EDF no cambie de hilo a mitad del recorrido).
+ *
+ * Entradas:
+ *   ColaEspera *cola – cola que se vacía.
+ *
+ * Retorna:
+ *   int – cantidad de hilos despertados.
+ */
+int cola_espera_despertar_todos(ColaEspera *cola) {
+    TCB *hilo = cola->head;
+    cola->head = NULL;
+    cola->tail = NULL;
+    int despertados = 0;
+    while (hilo) {
+        TCB *siguiente = hilo->next;
+        hilo->next    = NULL;
+        hilo->en_cola = NULL;
+        temporizador_quitar(hilo);
+        cambiar_estado(hilo, READY);
+        encolar_hilo(hilo->scheduler, hilo);
+        despertados++;
+        hilo = siguiente;
+    }
+    return despertados;
+}
+
+
+//--------------------------------------------------------------
+//Espera de E/S (epoll)
+//--------------------------------------------------------------
+
+
+/**
+ * es_eventos_fd
+ *
+ * Calcula la unión de los eventos que esperan los hilos de la lista de un fd.
+ *
+ * Entradas:
+ *   int fd – descriptor a revisar.
+ *
+ * Retorna:
+ *   unsigned – máscara EPOLLIN/EPOLLOUT pedida por los hilos, 0 si no hay.
+ */
+static unsigned es_eventos_fd(int fd) {
+    unsigned eventos = 0;
+    for (TCB *it = es_esperas[fd]; it; it = it->es_next) {
+        eventos |= it->espera_eventos;
+    }
+    return eventos;
+}
+
+
+/**
+ * es_actualizar_fd
+ *
+ * Deja el registro del fd en epoll acorde con los hilos que lo esperan:
+ * lo agrega, lo modifica o lo quita si ya nadie lo espera.
+ *
+ * Entradas:
+ *   int fd – descriptor a actualizar.
+ *
+ * Retorna:
+ *   int – 0 en éxito, -1 si epoll_ctl falla (errno queda asignado).
+ */
+static int es_actualizar_fd(int fd) {
+    unsigned eventos = es_eventos_fd(fd);
+    if (eventos == es_registrado[fd]) {
+        return 0;
+    }
+    struct epoll_event ev = { .events = eventos, .data.fd = fd };
+    int op = (es_registrado[fd] == 0) ? EPOLL_CTL_ADD
+           : (eventos == 0)           ? EPOLL_CTL_DEL
+           :                            EPOLL_CTL_MOD;
+    if (epoll_ctl(es_epoll_fd, op, fd, &ev) != 0) {
+        return -1;
+    }
+    es_registrado[fd] = eventos;
+    return 0;
+}
+
+
+/**
+ * es_iniciar
+ *
+ * Crea el epoll de las esperas de E/S la primera vez que se necesita. En
+ * modo M:N también crea el eventfd con que se despierta al worker ocioso que
+ * espera en ese epoll, y lo registra en él.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 0 si el epoll está listo, -1 si no se pudo crear (errno queda asignado).
+ */
+static int es_iniciar(void) {
+    if (es_epoll_fd < 0) {
+        es_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (es_epoll_fd < 0) {
+            return -1;
+        }
+    }
+    if (modo_mn && es_aviso_fd < 0) {
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+        if (epoll_ctl(es_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            return -1;
+        }
+        es_aviso_fd = fd;
+    }
+    return 0;
+}
+
+
+/**
+ * es_vaciar_aviso
+ *
+ * Consume los avisos pendientes del eventfd de los workers ociosos, para que
+ * el próximo epoll_wait vuelva a bloquear.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void es_vaciar_aviso(void) {
+    uint64_t avisos;
+    ssize_t leidos = read(es_aviso_fd, &avisos, sizeof avisos);   // EAGAIN si no había
+    (void)leidos;
+}
+
+
+/**
+ * es_esperar
+ *
+ * Estaciona un hilo hasta que el fd esté listo para los eventos pedidos: lo
+ * marca BLOCKED y lo agrega a la tabla de esperas respaldada por epoll. El
+ * llamador debe tener runtime_lock y llamar a schedule() después.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que espera (normalmente hilo_actual).
+ *   int fd – descriptor a esperar.
+ *   unsigned eventos – EPOLLIN y/o EPOLLOUT.
+ *
+ * Retorna:
+ *   int – 0 si el hilo quedó estacionado, -1 si no se pudo registrar el fd.
+ */
+int es_esperar(TCB *hilo, int fd, unsigned eventos) {
+    if (fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    if (es_iniciar() != 0) {
+        return -1;
+    }
+    if (fd >= es_capacidad) {
+        int nueva = es_capacidad ? es_capacidad : 64;
+        while (nueva <= fd) {
+            nueva *= 2;
+        }
+        TCB **esperas = realloc(es_esperas, nueva * sizeof *esperas);
+        if (!esperas) {
+            return -1;
+        }
+        es_esperas = esperas;
+        unsigned *registrado = realloc(es_registrado, nueva * sizeof *registrado);
+        if (!registrado) {
+            return -1;
+        }
+        es_registrado = registrado;
+        memset(es_esperas + es_capacidad, 0, (nueva - es_capacidad) * sizeof *es_esperas);
+        memset(es_registrado + es_capacidad, 0, (nueva - es_capacidad) * sizeof *es_registrado);
+        es_capacidad = nueva;
+    }
+
+    hilo->espera_fd      = fd;
+    hilo->espera_eventos = eventos;
+    hilo->es_next        = es_esperas[fd];
+    es_esperas[fd]       = hilo;
+    if (es_actualizar_fd(fd) != 0) {
+        es_esperas[fd] = hilo->es_next;
+        hilo->es_next  = NULL;
+        return -1;
+    }
+    cambiar_estado(hilo, BLOCKED);
+    atomic_fetch_add_explicit(&hilos_esperando_es, 1, memory_order_relaxed);
+    if (modo_mn) {
+        mn_nueva_espera(-1);
+    }
+    return 0;
+}
+
+
+/**
+ * es_sondear
+ *
+ * Consulta epoll y despierta (READY en su scheduler) a los hilos cuyo fd ya
+ * está listo para lo que esperaban; un error o cierre del fd despierta a todos
+ * para que la operación reintente y vea el error. Luego ajusta el registro del
+ * fd a los hilos que siguen esperando.
+ *
+ * Entradas:
+ *   int timeout_ms – espera máxima de epoll_wait (0 para solo consultar, -1 sin límite).
+ *
+ * Retorna:
+ *   int – cantidad de hilos despertados.
+ */
+static int es_sondear(int timeout_ms) {
+    if (atomic_load_explicit(&hilos_esperando_es, memory_order_relaxed) == 0) {
+        return 0;
+    }
+    struct epoll_event eventos[64];
+    int n = epoll_wait(es_epoll_fd, eventos, 64, timeout_ms);
+    int despertados = 0;
+
+    for (int i = 0; i < n; i++) {
+        int fd       = eventos[i].data.fd;
+        unsigned ev  = eventos[i].events;
+        if (fd == es_aviso_fd) {
+            continue;           // el aviso lo consume el worker que espera en epoll
+        }
+        if (ev & (EPOLLERR | EPOLLHUP)) {
+            ev |= EPOLLIN | EPOLLOUT;
+        }
+        TCB **ptr = &es_esperas[fd];
+        while (*ptr) {
+            TCB *it = *ptr;
+            if (it->espera_eventos & ev) {
+                *ptr        = it->es_next;
+                it->es_next = NULL;
+                it->espera_fd = -1;
+                atomic_fetch_sub_explicit(&hilos_esperando_es, 1, memory_order_relaxed);
+                cambiar_estado(it, READY);
+                encolar_hilo(it->scheduler, it);
+                despertados++;
+            } else {
+                ptr = &it->es_next;
+            }
+        }
+        es_actualizar_fd(fd);
+    }
+    return despertados;
+}
+
+
+/**
+ * esperar_eventos
+ *
+ * Se usa cuando no hay ningún hilo listo: si hay hilos dormidos o esperando
+ * E/S, suspende el proceso hasta el próximo despertar de la rueda o hasta
+ * que un fd esté listo (epoll_wait o clock_nanosleep), y luego despierta lo
+ * que corresponda. Mientras espera, alarm_handler no reprograma.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 1 si esperó (puede haber hilos nuevos en READY), 0 si no hay nada que esperar.
+ */
+static int esperar_eventos(void) {
+    long long proximo = temporizador_proximo();
+    int hay_es = atomic_load_explicit(&hilos_esperando_es, memory_order_relaxed) > 0;
+    if (proximo < 0 && !hay_es) {
+        return 0;
+    }
+    esperando_temporizador = 1;
+    if (hay_es) {
+        int timeout = -1;
+        if (proximo >= 0) {
+            long long falta = proximo - reloj_ms();
+            timeout = falta > 0 ? (int)falta : 0;
+        }
+        es_sondear(timeout);
+    } else {
+        struct timespec ts = { .tv_sec  = proximo / 1000,
+                               .tv_nsec = (proximo % 1000) * 1000000L };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    esperando_temporizador = 0;
+    temporizador_avanzar();
+    return 1;
+}
+
+
+/**
+ * estadisticas_sueno
+ *
+ * Copia las estadísticas de precisión de los despertares de la rueda.
+ *
+ * Entradas:
+ *   EstadisticasSueno *out – estructura donde se copian.
+ *
+ * Retorna:
+ *   void
+ */
+void estadisticas_sueno(EstadisticasSueno *out) {
+    runtime_lock();
+    *out = estadisticas_rueda;
+    runtime_unlock();
+}
+
+
+/**
+ * quantum_de
+ *
+ * Quantum que le corresponde a un hilo: el propio si lo tiene, si no el de
+ * su scheduler.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a consultar.
+ *
+ * Retorna:
+ *   long – quantum en microsegundos, 0 si el hilo no se desaloja por tiempo.
+ */
+static long quantum_de(TCB *hilo) {
+    if (hilo->quantum_us > 0) {
+        return hilo->quantum_us;
+    }
+    return hilo->scheduler ? hilo->scheduler->quantum_us : 0;
+}
+
+
+/**
+ * quantum_programar
+ *
+ * Arma la alarma del quantum para que llegue una sola vez en el instante
+ * vence_ns (tiempo absoluto de CLOCK_MONOTONIC, para poder medir el retraso
+ * con que llega). Se puede llamar desde alarm_handler.
+ *
+ * Entradas:
+ *   long long vence_ns – instante de la alarma en nanosegundos.
+ *
+ * Retorna:
+ *   void
+ */
+static void quantum_programar(long long vence_ns) {
+    struct itimerspec its = {
+        .it_interval = { 0, 0 },
+        .it_value    = { .tv_sec  = vence_ns / 1000000000LL,
+                         .tv_nsec = vence_ns % 1000000000LL }
+    };
+    quantum_vence_ns = vence_ns;
+    quantum_armado   = 1;
+    timer_settime(quantum_timer, TIMER_ABSTIME, &its, NULL);
+}
+
+
+/**
+ * evento_proximo
+ *
+ * Próximo instante en que la rueda despierta a un hilo, si eso puede desalojar
+ * al hilo indicado (su scheduler desaloja al despertar, como EDF). No se mira
+ * si el que despierta tendrá más prioridad: eso lo decide el scheduler al
+ * encolarlo, en el schedule() que provoca la alarma.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que va a ejecutarse.
+ *
+ * Retorna:
+ *   long long – instante en nanosegundos (base de reloj_ns), o 0 si no hay.
+ */
+static long long evento_proximo(TCB *hilo) {
+    if (hilo->scheduler == NULL || !hilo->scheduler->desaloja_al_despertar ||
+        atomic_load_explicit(&hilos_durmiendo, memory_order_relaxed) == 0) {
+        return 0;
+    }
+    long long proximo = temporizador_proximo();
+    return proximo < 0 ? 0 : proximo * 1000000LL;
+}
+
+
+/**
+ * desalojo_limite
+ *
+ * Instante en que hay que volver a pasar por schedule(): el fin del quantum o
+ * el próximo despertar que puede desalojar al hilo actual, el que llegue antes.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   long long – instante en nanosegundos, o 0 si el hilo actual no tiene límite.
+ */
+static long long desalojo_limite(void) {
+    if (quantum_fin_ns == 0 || (evento_ns != 0 && evento_ns < quantum_fin_ns)) {
+        return evento_ns;
+    }
+    return quantum_fin_ns;
+}
+
+
+/**
+ * evento_adelantar
+ *
+ * Se durmió a un hilo que no es el que ejecuta (por ejemplo, una tarea
+ * periódica creada con desfase): si su despertar puede desalojar al hilo en
+ * ejecución y llega antes que la alarma armada, la adelanta. Si todavía no
+ * ejecuta ningún hilo (main crea las tareas antes de arrancar el primero, que
+ * puede tomar la CPU sin pasar por schedule()) se decide con el scheduler del
+ * hilo dormido.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que se acaba de agregar a la rueda.
+ *
+ * Retorna:
+ *   void
+ */
+static void evento_adelantar(TCB *hilo) {
+    TCB *actual = hilo_actual;
+    if (actual != NULL && actual->state != RUNNING) {
+        return;                 // se durmió él mismo: schedule() arma la alarma
+    }
+    Scheduler *sched = actual ? actual->scheduler : hilo->scheduler;
+    if (!quantum_timer_listo || sched == NULL || !sched->desaloja_al_despertar) {
+        return;
+    }
+    long long instante = hilo->despertar_ms * 1000000LL;
+    if (evento_ns != 0 && evento_ns <= instante) {
+        return;
+    }
+    evento_ns = instante;
+    if (!quantum_armado || quantum_vence_ns > instante) {
+        quantum_programar(instante);
+    }
+}
+
+
+/**
+ * quantum_despachar
+ *
+ * Se llama cada vez que un hilo toma la CPU y le da su propio quantum: anota
+ * cuándo vence y solo reprograma la alarma si no estaba armada o si llegaría
+ * tarde. Una alarma que llegue antes de tiempo la extiende alarm_handler, así
+ * que en el caso común (cambios más frecuentes que el quantum) no cuesta
+ * ninguna llamada al sistema. Si no hay otro hilo listo para desalojarlo (o
+ * el hilo no tiene quantum) no hay límite: la alarma pendiente, si la hay,
+ * llega una vez y no se rearma.
+ *
+ * Si el scheduler del hilo desaloja al despertar (EDF), la alarma también se
+ * arma para el próximo despertar de la rueda, de modo que una tarea liberada
+ * con deadline más cercano no espera a que el hilo actual ceda la CPU.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que va a ejecutarse.
+ *
+ * Retorna:
+ *   void
+ */
+static void quantum_despachar(TCB *hilo) {
+    if (!quantum_timer_listo) {
+        return;
+    }
+    evento_ns    = evento_proximo(hilo);
+    long quantum = quantum_de(hilo);
+    if (quantum <= 0 || hilos_en_estado(READY) == 0) {
+        if (quantum > 0) {
+            estadisticas_q.desarmados++;
+        }
+        quantum_fin_ns = 0;
+    } else {
+        quantum_fin_ns = reloj_ns() + quantum * 1000LL;
+    }
+    long long limite = desalojo_limite();
+    if (limite != 0 && (!quantum_armado || quantum_vence_ns > limite)) {
+        quantum_programar(limite);
+    }
+}
+
+
+/**
+ * estadisticas_quantum
+ *
+ * Copia las estadísticas de precisión de la alarma del quantum.
+ *
+ * Entradas:
+ *   EstadisticasQuantum *out – estructura donde se copian.
+ *
+ * Retorna:
+ *   void
+ */
+void estadisticas_quantum(EstadisticasQuantum *out) {
+    runtime_lock();
+    *out = estadisticas_q;
+    runtime_unlock();
+}
+
+
+/**
+ * desalojo_marcar
+ *
+ * Lo llama un scheduler al encolar un hilo: si el hilo va a desalojar al que
+ * ejecuta, anota desde cuándo espera la CPU (el instante pedido, si lo está
+ * despertando la rueda) para medir la latencia de desalojo; si no, la borra.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo que se encola.
+ *   int desaloja – 1 si tiene más prioridad que el hilo en ejecución.
+ *
+ * Retorna:
+ *   void
+ */
+static void desalojo_marcar(TCB *hilo, int desaloja) {
+    if (!desaloja) {
+        hilo->desaloja_desde_ns = 0;
+    } else if (hilo->desaloja_desde_ns == 0) {
+        hilo->desaloja_desde_ns = despertando_ns ? despertando_ns : reloj_ns();
+    }
+}
+
+
+/**
+ * desalojo_contra
+ *
+ * Hilo contra el que un scheduler compara al que encola para decidir si lo
+ * desaloja: el que ejecuta este kernel thread o, si en modo M:N se encola en
+ * la cola de otro worker (worker_politica), el que ejecuta ese worker.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   TCB* – hilo en ejecución en el worker de la cola, o NULL si no hay.
+ */
+static TCB *desalojo_contra(void) {
+    return encolando_ajena ? ajena_actual : hilo_actual;
+}
+
+
+/**
+ * desalojo_pedir
+ *
+ * Lo llama un scheduler que acaba de encolar un hilo que desaloja al de
+ * desalojo_contra(): cambia de hilo ya mismo o, si el desalojo está
+ * suspendido, en desalojo_reanudar. Si la cola es de otro worker solo lo
+ * anota, y worker_politica avisa a ese worker.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void desalojo_pedir(void) {
+    if (encolando_ajena) {
+        ajena_desaloja = 1;
+    } else if (desalojo_suspendido > 0) {
+        desalojo_pendiente = 1;     // se cambia en desalojo_reanudar
+    } else {
+        schedule();                 // reencola al actual y elige al nuevo
+    }
+}
+
+
+/**
+ * desalojo_registrar
+ *
+ * Lo llama un scheduler al elegir un hilo: si había quedado listo para
+ * desalojar al anterior, suma cuánto tardó en tomar la CPU.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo elegido.
+ *
+ * Retorna:
+ *   void
+ */
+static void desalojo_registrar(TCB *hilo) {
+    if (hilo->desaloja_desde_ns == 0) {
+        return;
+    }
+    long long latencia = reloj_ns() - hilo->desaloja_desde_ns;
+    if (latencia < 0) {
+        latencia = 0;
+    }
+    hilo->desaloja_desde_ns = 0;
+    estadisticas_d.desalojos++;
+    estadisticas_d.latencia_total_ns += latencia;
+    if (latencia > estadisticas_d.latencia_max_ns) {
+        estadisticas_d.latencia_max_ns = latencia;
+    }
+}
+
+
+/**
+ * estadisticas_desalojo
+ *
+ * Copia las estadísticas de latencia de desalojo.
+ *
+ * Entradas:
+ *   EstadisticasDesalojo *out – estructura donde se copian.
+ *
+ * Retorna:
+ *   void
+ */
+void estadisticas_desalojo(EstadisticasDesalojo *out) {
+    runtime_lock();
+    *out = estadisticas_d;
+    runtime_unlock();
+}
+
+
+/**
+ * desalojo_suspender
+ *
+ * Abre una sección crítica del runtime: mientras dure, ni encolar un hilo
+ * (por ejemplo, despertar a uno con deadline más cercano en EDF) ni la alarma
+ * del quantum cambian de contexto; el cambio queda pendiente. Se puede anidar
+ * y no hace llamadas al sistema, así que cuesta lo mismo que un contador.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+void desalojo_suspender(void) {
+    desalojo_suspendido++;
+    atomic_signal_fence(memory_order_seq_cst);   // antes de tocar las estructuras
+}
+
+
+/**
+ * desalojo_reanudar
+ *
+ * Deshace un desalojo_suspender. Al salir del último nivel, si algún hilo
+ * despertado debía desalojar al actual o venció el quantum dentro de la
+ * sección, hace ese cambio ahora con schedule(): es el punto seguro.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+void desalojo_reanudar(void) {
+    atomic_signal_fence(memory_order_seq_cst);   // después de tocar las estructuras
+    if (--desalojo_suspendido > 0 || !desalojo_pendiente) {
+        return;
+    }
+    desalojo_pendiente = 0;
+    if (hilo_actual && hilo_actual->state == RUNNING) {
+        schedule();
+    }
+}
+
+
+/**
+ * desalojos_aplazados
+ *
+ * Cuenta las alarmas del quantum que llegaron dentro de una sección crítica
+ * del runtime (o de una función de biblioteca) y se convirtieron en un
+ * cambio de hilo pendiente en lugar de cambiar ahí mismo.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   long – número de desalojos aplazados desde que arrancó el programa.
+ */
+long desalojos_aplazados(void) {
+    return desalojos_aplazados_total;
+}
+
+
+/**
+ * hilo_comenzar
+ *
+ * Lo primero que ejecuta un hilo nuevo. El hilo arranca dentro del schedule()
+ * que lo eligió (en modo M:N, desde el lazo de su worker), con el desalojo
+ * todavía suspendido y sin un marco propio de schedule() que lo restaure: lo
+ * deja en cero y, si la alarma llegó durante el cambio, cede la CPU ahora.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+void hilo_comenzar(void) {
+    desalojo_suspendido = 1;
+    desalojo_reanudar();
+}
+
+
+/**
+ * encolar_hilo
+ *
+ * Llama a la función específica del scheduler para encolar un hilo en la estructura interna.
+ * En modo M:N el hilo va a la cola local del worker, que es una réplica de su
+ * scheduler: la política decide también ahí cuál se ejecuta primero.
+ * Si la alarma del quantum estaba desarmada porque el hilo actual era el único
+ * listo, la vuelve a armar: ahora hay con quién compartir la CPU.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler que provee la función encolar_hilo.
+ *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *
+ * Retorna:
+ *   void – no retorna valor, da la operación al metodo interno del scheduler.
+ */
+void encolar_hilo(Scheduler *sched, TCB *hilo) {
+    if (modo_mn) {
+        hilo->scheduler = sched;
+        mn_encolar(hilo);
+        return;
+    }
+    sched->encolar_hilo(sched, hilo);
+    TCB *actual = hilo_actual;
+    if (quantum_timer_listo && quantum_fin_ns == 0 && actual && actual != hilo &&
+        actual->state == RUNNING && quantum_de(actual) > 0) {
+        quantum_despachar(actual);   // ya hay con quién compartir la CPU
+    }
+}
+
+
+/**
+ * hilo_pesos_cambiados
+ *
+ * Avisa al scheduler de un hilo que cambiaron sus tickets o su deadline, para
+ * que lo reubique si lo tiene encolado (en modo M:N, en la cola local del
+ * worker donde esté). El llamador debe tener runtime_lock.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo cuyos tickets o deadline cambiaron.
+ *
+ * Retorna:
+ *   void
+ */
+void hilo_pesos_cambiados(TCB *hilo) {
+    Scheduler *sched = hilo->scheduler;
+    if (hilo->state != READY || sched == NULL || sched->actualizar_hilo == NULL) {
+        return;
+    }
+    if (modo_mn) {
+        mn_actualizar(hilo);
+        return;
+    }
+    sched->actualizar_hilo(sched, hilo);
+}
+
+
+/**
+ * tarea_admitir
+ *
+ * Control de admisión de una tarea periódica: suma su densidad
+ * (hilo->densidad_ppm) a la carga del scheduler si no supera el tope. Para
+ * EDF el tope es una CPU completa: si la suma de wcet / min(plazo, período)
+ * no pasa de 1, todos los trabajos cumplen su deadline. El llamador debe
+ * tener runtime_lock.
+ *
+ * Entradas:
+ *   Scheduler *sched – scheduler en que se va a ejecutar la tarea.
+ *   TCB *hilo – tarea con densidad_ppm ya calculada.
+ *
+ * Retorna:
+ *   int – 0 si se admitió, -1 si con ella el conjunto no sería planificable.
+ */
+int tarea_admitir(Scheduler *sched, TCB *hilo) {
+    if (sched->utilizacion_max_ppm > 0 &&
+        sched->utilizacion_ppm + hilo->densidad_ppm > sched->utilizacion_max_ppm) {
+        return -1;
+    }
+    sched->utilizacion_ppm += hilo->densidad_ppm;
+    hilo->admitido_en = sched;
+    return 0;
+}
+
+
+/**
+ * tarea_retirar
+ *
+ * Devuelve la carga de una tarea periódica al scheduler que la admitió (al
+ * terminar el hilo). Si no fue admitida en ninguno no hace nada. El llamador
+ * debe tener runtime_lock.
+ *
+ * Entradas:
+ *   TCB *hilo – tarea que deja de ejecutarse.
+ *
+ * Retorna:
+ *   void
+ */
+void tarea_retirar(TCB *hilo) {
+    if (hilo->admitido_en == NULL) {
+        return;
+    }
+    hilo->admitido_en->utilizacion_ppm -= hilo->densidad_ppm;
+    hilo->admitido_en = NULL;
+}
+
+
+/**
+ * my_thread_chsched
+ *
+ * Cambia el scheduler asignado a un hilo. Si el hilo está READY se remueve de
+ * la cola del scheduler actual y se encola en el nuevo (en modo M:N, dentro
+ * del mismo worker); si está RUNNING o BLOCKED solo se actualiza el puntero, y
+ * el hilo entrará a la cola del nuevo scheduler la próxima vez que quede listo.
+ *
+ * Entradas:
+ *   TCB *hilo – puntero al TCB del hilo cuyo scheduler se cambia.
+ *   Scheduler *new_sch – puntero al nuevo scheduler donde se debe encolar el hilo.
+ *
+ * Retorna:
+ *   int – 0 si la operación se realizó correctamente.
+ */
+int my_thread_chsched(TCB *hilo, Scheduler *new_sch) {
+
+    Scheduler *old_sch = hilo->scheduler;
+    desalojo_suspender();
+    if (hilo->state != READY) {
+        hilo->scheduler = new_sch;
+        desalojo_reanudar();
+        return 0;
+    }
+    if (modo_mn) {
+        int id = mn_sacar(hilo);
+        hilo->scheduler = new_sch;
+        if (id >= 0) {
+            mn_devolver(id, hilo);
+        }
+        desalojo_reanudar();
+        return 0;
+    }
+    if (old_sch)
+        old_sch->remover_hilo(old_sch, hilo);
+    hilo->scheduler = new_sch;
+    hilo->next      = NULL;
+    new_sch->encolar_hilo(new_sch, hilo);
+    desalojo_reanudar();
+
+    return 0;
+}
+
+
+
+#ifdef MY_PTHREAD_ASM_SWITCH
+
+/*
+ * cambio_contexto_asm(void **guardar_sp, void *cargar_sp)
+ *
+ * Guarda los registros callee-saved de la ABI System V (rbp, rbx, r12-r15),
+ * MXCSR y la palabra de control de la x87 en la pila actual, deja el stack
+ * pointer en *guardar_sp, carga cargar_sp y restaura lo mismo desde la otra
+ * pila. A diferencia de swapcontext no toca la máscara de señales.
+ */
+void cambio_contexto_asm(void **guardar_sp, void *cargar_sp);
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    ".type cambio_contexto_asm, @function\n"
+    "cambio_contexto_asm:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq  $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw  4(%rsp)\n"
+    "    movq  %rsp, (%rdi)\n"
+    "    movq  %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw   4(%rsp)\n"
+    "    addq  $8, %rsp\n"
+    "    popq  %r15\n"
+    "    popq  %r14\n"
+    "    popq  %r13\n"
+    "    popq  %r12\n"
+    "    popq  %rbx\n"
+    "    popq  %rbp\n"
+    "    ret\n"
+    ".size cambio_contexto_asm, .-cambio_contexto_asm\n"
+);
+
+
+/**
+ * arrancar_hilo
+ *
+ * Primera función que ejecuta un hilo nuevo cuando se llega a él con el cambio
+ * en ensamblador: salta al contexto armado por makecontext (pasar_funcion).
+ * Es la única vez en la vida del hilo que se paga la llamada a sigprocmask
+ * de setcontext.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void – no retorna.
+ */
+static void arrancar_hilo(void) {
+    alarma_bloqueada = 0;
+    setcontext(&hilo_actual->context);
+}
+
+#endif
+
+
+/**
+ * preparar_contexto
+ *
+ * Con MY_PTHREAD_ASM_SWITCH arma en la pila del hilo, justo debajo de lo que
+ * dejó makecontext (argumentos y retorno hacia uc_link), el marco que
+ * espera cambio_contexto_asm (registros en cero, MXCSR y x87 por defecto y
+ * arrancar_hilo como dirección de retorno). Sin esa opción no hace nada: el
+ * contexto de makecontext es suficiente para swapcontext.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo recién creado, con context ya preparado por makecontext.
+ *
+ * Retorna:
+ *   void
+ */
+void preparar_contexto(TCB *hilo) {
+#ifdef MY_PTHREAD_ASM_SWITCH
+    uintptr_t tope = ((uintptr_t)hilo->context.uc_mcontext.gregs[REG_RSP] - 128) & ~(uintptr_t)15;
+    uint64_t *marco = (uint64_t *)tope;
+    *--marco = 0;                            // retorno falso de arrancar_hilo
+    *--marco = (uint64_t)arrancar_hilo;      // dirección a la que salta el ret
+    for (int i = 0; i < 6; i++) {
+        *--marco = 0;                        // rbp, rbx, r12-r15
+    }
+    *--marco = 0x037FULL << 32 | 0x1F80ULL;  // x87 CW y MXCSR por defecto
+    hilo->sp = marco;
+#else
+    hilo->sp = NULL;
+#endif
+}
+
+
+/**
+ * cambiar_contexto
+ *
+ * Guarda el contexto de prev y continúa la ejecución en next. Con
+ * MY_PTHREAD_ASM_SWITCH usa cambio_contexto_asm (sin llamadas al sistema);
+ * si el cambio ocurrió dentro de alarm_handler, SIGALRM quedó bloqueada en
+ * el kernel y se desbloquea aquí al retomar. Sin esa opción usa swapcontext.
+ *
+ * Entradas:
+ *   TCB *prev – hilo que deja la CPU.
+ *   TCB *next – hilo que se va a ejecutar.
+ *
+ * Retorna:
+ *   void – retorna cuando prev vuelve a ser elegido.
+ */
+static void cambiar_contexto(TCB *prev, TCB *next) {
+#ifdef MY_PTHREAD_ASM_SWITCH
+    cambio_contexto_asm(&prev->sp, next->sp);
+    if (alarma_bloqueada) {
+        sigset_t set;
+        alarma_bloqueada = 0;
+        sigemptyset(&set);
+        sigaddset(&set, SIGALRM);
+        sigprocmask(SIG_UNBLOCK, &set, NULL);
+    }
+#else
+    swapcontext(&prev->context, &next->context);
+#endif
+}
+
+
+/**
+ * scheduler_indice
+ *
+ * Busca un scheduler entre los registrados.
+ *
+ * Entradas:
+ *   Scheduler *sch – scheduler a buscar.
+ *
+ * Retorna:
+ *   int – su índice en schedulers[], o -1 si no está registrado.
+ */
+static int scheduler_indice(Scheduler *sch) {
+    for (int i = 0; i < schedulers_count; i++) {
+        if (schedulers[i] == sch) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * registrar_scheduler
+ *
+ * Anota un scheduler inicializado para que schedule() pueda buscar en él
+ * hilos listos aunque no sea el del hilo que cede la CPU. Registrar dos
+ * veces el mismo scheduler no tiene efecto.
+ *
+ * Entradas:
+ *   Scheduler *sch – scheduler a registrar.
+ *
+ * Retorna:
+ *   void
+ */
+static void registrar_scheduler(Scheduler *sch) {
+    if (scheduler_indice(sch) >= 0) {
+        return;
+    }
+    if (schedulers_count < MAX_SCHEDULERS) {
+        schedulers[schedulers_count++] = sch;
+    }
+}
+
+
+/**
+ * siguiente_listo
+ *
+ * Elige el siguiente hilo a ejecutar: primero en el scheduler preferido (el
+ * del hilo que cede la CPU) y, si ahí no hay ninguno pero quedan hilos READY
+ * (por ejemplo tras un my_thread_chsched), en los demás schedulers
+ * registrados.
+ *
+ * Entradas:
+ *   Scheduler *preferido – scheduler que se consulta primero.
+ *
+ * Retorna:
+ *   TCB* – hilo elegido (ya fuera de su cola) o NULL si no hay ninguno listo.
+ */
+static TCB *siguiente_listo(Scheduler *preferido) {
+    TCB *next = preferido->siguiente_hilo(preferido);
+    if (next != NULL || hilos_en_estado(READY) == 0) {
+        return next;
+    }
+    for (int i = 0; i < schedulers_count && next == NULL; i++) {
+        if (schedulers[i] != preferido) {
+            next = schedulers[i]->siguiente_hilo(schedulers[i]);
+        }
+    }
+    return next;
+}
+
+
+/**
+ * schedule
+ *
+ * Si existe un hilo actual, recicla los hilos terminados, despierta los hilos
+ * dormidos cuyo tiempo venció y los que esperaban un fd que ya está listo y,
+ * si el hilo actual sigue en RUNNING (fue desalojado), lo devuelve a la cola
+ * de su scheduler. Si no hay ningún hilo listo pero sí hilos dormidos o
+ * esperando E/S, el proceso duerme (sin consumir CPU) hasta el próximo evento.
+ * Luego solicita al scheduler asociado el siguiente hilo listo para ejecutarse
+ * (o, si en él no hay, a los demás schedulers inicializados), en caso de que
+ * haya uno, lo marca RUNNING e intercambia el contexto entre el hilo actual y
+ * el siguiente, permitiendo la ejecución del nuevo hilo. Si no hay ninguno y
+ * el hilo actual terminó, retorna (y my_thread_exit vuelve a main con
+ * hilo_salir); si estaba bloqueado y nada puede despertarlo, salta al
+ * contexto de main.
+ *
+ * Las colas de los schedulers solo contienen hilos READY: el hilo elegido sale
+ * de la cola y vuelve a entrar cuando cede la CPU o es desalojado.
+ *
+ * Todo eso, incluido el cambio de contexto, ocurre con el desalojo suspendido:
+ * el nivel de suspensión del hilo se guarda en su marco de schedule() y se
+ * restaura cuando vuelve a ser elegido. Si el hilo llamó con runtime_lock()
+ * tomado (para bloquearse o terminar), ese nivel se suelta aquí. Una alarma
+ * que llegue mientras tanto queda pendiente y, si el hilo retoma fuera de
+ * toda sección crítica, se atiende antes de retornar.
+ *
+ * En modo M:N regresa al contexto de su worker (mn_schedule), que reencola
+ * al hilo en su cola local si sigue listo y elige el siguiente con la
+ * política de cada scheduler.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void – no retorna valor, cambia el hilo en ejecución mediante cambiar_contexto.
+ */
+void schedule(void) {
+    if (hilo_actual == NULL) {
+        return;
+    }
+    if (modo_mn) {
+        mn_schedule();
+        return;
+    }
+    int nivel = desalojo_suspendido;
+    desalojo_suspendido++;
+    atomic_signal_fence(memory_order_seq_cst);
+    if (runtime_lock_tomado) {
+        runtime_lock_tomado = 0;     // el lock se libera al ceder la CPU
+        nivel--;
+    }
+    do {
+        desalojo_pendiente = 0;
+        TCB *prev      = hilo_actual;
+        liberar_hilos_terminados();
+        temporizador_avanzar();
+        es_sondear(0);
+        if (prev->state == RUNNING) {
+            encolar_hilo(prev->scheduler, prev);
+        }
+        Scheduler *sch = prev->scheduler;
+        TCB *next      = siguiente_listo(sch);
+
+        // Nadie listo pero hay hilos dormidos o esperando E/S: esperar un evento
+        while (next == NULL && esperar_eventos()) {
+            next = siguiente_listo(sch);
+        }
+        if (next == NULL) {
+            if (prev->state == BLOCKED) {
+                // Nada podrá despertarlo: retomarlo lo haría seguir como si no
+                // estuviera bloqueado, así que se vuelve al contexto de main.
+                fprintf(stderr, "schedule: todos los hilos están bloqueados y no hay "
+                                "eventos que esperar\n");
+                hilo_actual         = NULL;
+                quantum_fin_ns      = 0;
+                evento_ns           = 0;
+                desalojo_suspendido = 0;
+                setcontext(&scheduler_ctx);
+            }
+            break;      // el hilo terminó: my_thread_exit sigue en hilo_salir
+        }
+        cambiar_estado(next, RUNNING);
+        quantum_despachar(next);
+        if (next != prev) {
+            hilo_actual = next;
+            cambiar_contexto(prev, next);
+        }
+    } while (nivel == 0 && desalojo_pendiente && hilo_actual->state == RUNNING);
+    atomic_signal_fence(memory_order_seq_cst);
+    desalojo_suspendido = nivel;
+}
+
+
+/**
+ * hilo_salir
+ *
+ * Lo llama un hilo terminado cuando schedule() le devolvió la CPU porque no
+ * quedaba ningún otro hilo listo. No retorna: salta al contexto de main (en
+ * modo M:N vuelve al de su worker, que ya no lo retoma), de modo que la
+ * función del hilo nunca sigue ejecutándose después de my_thread_exit.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   no retorna.
+ */
+_Noreturn void hilo_salir(void) {
+    if (modo_mn) {
+        mn_schedule();
+    } else {
+        hilo_actual         = NULL;
+        quantum_fin_ns      = 0;
+        evento_ns           = 0;
+        desalojo_suspendido = 0;
+        desalojo_pendiente  = 0;
+        setcontext(&scheduler_ctx);
+    }
+    fprintf(stderr, "hilo_salir: no se pudo volver al contexto del planificador\n");
+    abort();
+}
+
+
+/**
+ * interrumpio_biblioteca
+ *
+ * Indica si la alarma interrumpió código que no es del programa (libc u otra
+ * biblioteca compartida): malloc, printf o el propio swapcontext no son
+ * reentrantes, así que ahí tampoco es seguro cambiar de hilo. Solo se puede
+ * saber en x86-64; en otras arquitecturas (o si se enlaza estático) se
+ * asume que no.
+ *
+ * Entradas:
+ *   void *contexto – ucontext_t con los registros del código interrumpido.
+ *
+ * Retorna:
+ *   int – 1 si el contador de programa estaba fuera del código del programa.
+ */
+static int interrumpio_biblioteca(void *contexto) {
+#ifdef __x86_64__
+    uintptr_t pc = (uintptr_t)((ucontext_t *)contexto)->uc_mcontext.gregs[REG_RIP];
+    return pc < (uintptr_t)__executable_start || pc >= (uintptr_t)etext;
+#else
+    (void)contexto;
+    return 0;
+#endif
+}
+
+
+/**
+ * alarm_handler
+ *
+ * Captura la señal de alarma (SIGALRM) y fuerza la llamada a schedule()
+ * para cambiar al siguiente hilo listo para ejecutar. Si la señal interrumpe
+ * una sección crítica del runtime (una cola a medio editar, el propio
+ * schedule()) o una función de biblioteca, no cambia de hilo: marca el
+ * desalojo como pendiente y el cambio lo hace desalojo_reanudar al salir de
+ * la sección; si el hilo no vuelve a entrar al runtime, la alarma se
+ * reintenta en REINTENTO_DESALOJO_US.
+ *
+ * Una alarma del temporizador del quantum que llega antes del límite del
+ * hilo actual (fin de su quantum o próximo despertar que puede desalojarlo;
+ * la alarma se armó para un hilo anterior) solo se reprograma, y una que
+ * llega sin límite (no hay otro hilo listo ni despertares pendientes) se
+ * ignora sin rearmar. Las que vencen un quantum se cuentan y se mide cuánto
+ * llegaron después del instante programado; las de un despertar llevan a
+ * schedule(), que despierta al hilo y deja que su scheduler decida. En modo
+ * M:N la alarma es la del worker que la recibe y la atiende mn_alarma.
+ *
+ * Entradas:
+ *   int sig – número de señal recibida (por lo general SIGALRM).
+ *   siginfo_t *info – origen de la señal (SI_TIMER si es la del quantum).
+ *   void *contexto – registros del código interrumpido.
+ *
+ * Retorna:
+ *   void – no retorna valor, invoca schedule() internamente.
+ */
+static void alarm_handler(int sig, siginfo_t *info, void *contexto) {
+    (void)sig;
+    if (modo_mn) {
+        mn_alarma(info, contexto);   // cada worker tiene su propia alarma
+        return;
+    }
+    int del_quantum = info->si_code == SI_TIMER && quantum_timer_listo;
+    if (del_quantum) {
+        quantum_armado = 0;
+    }
+    if (esperando_temporizador) {
+        return;    // en espera no hay a quién ceder
+    }
+    if (del_quantum) {
+        long long ahora  = reloj_ns();
+        long long limite = desalojo_limite();
+        if (limite == 0) {
+            return;                          // nadie con quién compartir la CPU
+        }
+        if (ahora < limite) {
+            quantum_programar(limite);
+            return;
+        }
+        if (quantum_fin_ns != 0 && ahora >= quantum_fin_ns) {
+            long long retraso = ahora - quantum_vence_ns;
+            estadisticas_q.alarmas++;
+            estadisticas_q.retraso_total_ns += retraso;
+            if (retraso > estadisticas_q.retraso_max_ns) {
+                estadisticas_q.retraso_max_ns = retraso;
+            }
+        }
+    }
+    if (desalojo_suspendido > 0 || interrumpio_biblioteca(contexto)) {
+        desalojo_pendiente = 1;
+        desalojos_aplazados_total++;
+        if (del_quantum) {
+            quantum_programar(reloj_ns() + REINTENTO_DESALOJO_US * 1000LL);
+        }
+        return;
+    }
+#ifdef MY_PTHREAD_ASM_SWITCH
+    alarma_bloqueada = 1;
+#endif
+    schedule();
+#ifdef MY_PTHREAD_ASM_SWITCH
+    alarma_bloqueada = 0;
+#endif
+}
+
+
+/**
+ * preemption_instalar
+ *
+ * La primera vez instala el manejador de SIGALRM y crea el temporizador del
+ * quantum (timer_create sobre CLOCK_MONOTONIC), sin armarlo.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 0 si el temporizador está listo, -1 si no se pudo crear.
+ */
+static int preemption_instalar(void) {
+    if (quantum_timer_listo) {
+        return 0;
+    }
+    struct sigaction sa;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_sigaction = alarm_handler;
+    sa.sa_flags     = SA_SIGINFO;
+    sigaction(SIGALRM, &sa, NULL);
+
+    struct sigevent sev = { .sigev_notify = SIGEV_SIGNAL, .sigev_signo = SIGALRM };
+    if (timer_create(CLOCK_MONOTONIC, &sev, &quantum_timer) == -1) {
+        perror("timer_create");
+        return -1;
+    }
+    quantum_timer_listo = 1;
+    return 0;
+}
+
+
+/**
+ * start_preemption
+ *
+ * Instala el temporizador del quantum (preemption_instalar). No es periódico:
+ * en cada cambio de hilo schedule() le da al hilo que entra su propio quantum
+ * (quantum_despachar) y, si no hay otro hilo listo, no lo rearma. Aquí solo
+ * se arma el primer disparo, para desalojar al primer hilo aunque nunca
+ * llame a schedule().
+ *
+ * Entradas:
+ *   int quantum_ms – duración del primer quantum en milisegundos.
+ *
+ * Retorna:
+ *   void – no retorna valor, inicializa el temporizador de preempción.
+ */
+static void start_preemption(int quantum_ms) {
+    if (preemption_instalar() == -1) {
+        return;
+    }
+    if (!quantum_armado) {
+        quantum_fin_ns = reloj_ns() + quantum_ms * 1000000LL;
+        quantum_programar(quantum_fin_ns);
+    }
+}
+
+
+
+/**
+ * rr_encolar_hilo
+ *
+ * Encola un hilo en la cola del scheduler Round Robin, actualizando los punteros
+ * head y tail y estableciendo el estado READY.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler RR donde se encola el hilo.
+ *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica las estructuras internas del scheduler.
+ */
+static void rr_encolar_hilo(Scheduler *sched, TCB *hilo) {
+
+    RR_Scheduler *rr = (RR_Scheduler*)sched;
+
+    hilo->scheduler     = sched->origen;
+    cambiar_estado(hilo, READY);
+    hilo->next          = NULL;
+    if (rr->tail == NULL) {
+        rr->head = hilo;
+    }
+    else {
+        rr->tail->next = hilo;
+    }
+    rr->tail = hilo;
+
+
+}
+
+/**
+ * rr_siguiente_hilo
+ *
+ * Obtiene el siguiente hilo listo para ejecutar en el scheduler Round Robin.
+ * - Elimina de la cola los hilos cuyo estado no es READY.
+ * - Si la cola está vacía, retorna NULL.
+ * - Extrae el hilo en la cabeza de la cola; schedule() lo vuelve a encolar al
+ *   final cuando se le acaba el quantum.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler RR.
+ *
+ * Retorna:
+ *   TCB* – puntero al TCB del hilo seleccionado o NULL si no hay hilos listos.
+ */
+static TCB *rr_siguiente_hilo(Scheduler *sched) {
+    RR_Scheduler *rr = (RR_Scheduler*)sched;
+
+    while (rr->head && rr->head->state != READY) {
+        TCB *dead = rr->head;
+        rr->head = dead->next;
+        if (dead == rr->tail) {
+            rr->tail = NULL;
+        }
+        dead->next = NULL;
+    }
+
+    if (!rr->head) {
+        return NULL;
+    }
+
+    TCB *chosen = rr->head;
+    rr->head    = chosen->next;
+    if (!rr->head) {
+        rr->tail = NULL;
+    }
+    chosen->next = NULL;
+
+    return chosen;
+}
+
+/**
+ * rr_remover_hilo
+ *
+ * Elimina un hilo específico de la cola del scheduler Round Robin, ajustando
+ * los punteros head y tail según corresponda.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler RR del cual se debe remover el hilo.
+ *   TCB *hilo – puntero al TCB del hilo que se desea eliminar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler eliminando el hilo.
+ */
+
+static void rr_remover_hilo(Scheduler *sched, TCB *hilo) {
+    RR_Scheduler *rr = (RR_Scheduler*)sched;
+    TCB *prev = NULL;
+    TCB *it = rr->head;
+
+    while (it && it != hilo) {
+        prev = it;
+        it   = it->next;
+    }
+    if (!it) {
+        return;
+    }
+
+    if (prev) {
+        prev->next = it->next;
+    }
+    else {
+        rr->head = it->next;
+    }
+    if (rr->tail == it) {
+        rr->tail = prev;
+    }
+    it->next = NULL;
+}
+
+
+/**
+ * rr_replicar
+ *
+ * Crea un Round Robin vacío con el mismo quantum, para la cola local de un
+ * worker M:N.
+ *
+ * Entradas:
+ *   Scheduler *sched – scheduler RR original.
+ *
+ * Retorna:
+ *   Scheduler* – la réplica, o NULL si no hay memoria.
+ */
+static Scheduler *rr_replicar(Scheduler *sched) {
+    RR_Scheduler *copia = malloc(sizeof *copia);
+    if (copia == NULL) {
+        return NULL;
+    }
+    *copia = *(RR_Scheduler*)sched;
+    copia->base.origen = sched;
+    copia->head = copia->tail = NULL;
+    return &copia->base;
+}
+
+
+/**
+ * rr_scheduler_init
+ *
+ * Inicializa el scheduler Round Robin, asignando los punteros a las
+ * funciones de encolado, selección y remover de hilos; establece el
+ * quantum de tiempo, limpia la cabeza y cola, activa el scheduler y
+ * arranca el temporizador de preempción.
+ *
+ * Entradas:
+ *   RR_Scheduler *rr – puntero al struct RR_Scheduler a inicializar.
+ *   int quantum_ms – duración del quantum en milisegundos.
+ *
+ * Retorna:
+ *   void – no retorna valor, configura la estructura y arranca la preempción.
+ */
+void rr_scheduler_init(RR_Scheduler *rr, int quantum_ms) {
+    rr->base.encolar_hilo   = rr_encolar_hilo;
+    rr->base.siguiente_hilo = rr_siguiente_hilo;
+    rr->base.remover_hilo    = rr_remover_hilo;
+    rr->base.actualizar_hilo = NULL;
+    rr->base.replicar        = rr_replicar;
+    rr->base.origen          = &rr->base;
+    rr->base.quantum_us     = (long)quantum_ms * 1000;
+    rr->base.utilizacion_ppm     = 0;
+    rr->base.utilizacion_max_ppm = 0;
+    rr->base.desaloja_al_despertar = 0;   // quien despierta espera su turno
+    rr->quantum             = quantum_ms;
+    rr->head = rr->tail     = NULL;
+    scheduler_activo = 1;
+    registrar_scheduler(&rr->base);
+    start_preemption(quantum_ms);
+
+
+}
+
+
+
+
+//--------------------------------------------------------------
+//Generador pseudoaleatorio (xoshiro256**)
+//--------------------------------------------------------------
+
+static _Thread_local uint64_t aleatorio_estado[4];   // por kernel thread (worker en M:N)
+
+
+/**
+ * xoshiro_rotar
+ *
+ * Rotación a la izquierda de 64 bits usada por xoshiro256**.
+ *
+ * Entradas:
+ *   uint64_t x – valor a rotar.
+ *   int k – cantidad de bits (1..63).
+ *
+ * Retorna:
+ *   uint64_t – x rotado k bits a la izquierda.
+ */
+static inline uint64_t xoshiro_rotar(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * xoshiro_siguiente
+ *
+ * Avanza un estado de xoshiro256** y devuelve el siguiente número.
+ *
+ * Entradas:
+ *   uint64_t s[4] – estado del generador (no todo en cero).
+ *
+ * Retorna:
+ *   uint64_t – número pseudoaleatorio de 64 bits.
+ */
+static uint64_t xoshiro_siguiente(uint64_t s[4]) {
+    uint64_t resultado = xoshiro_rotar(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = xoshiro_rotar(s[3], 45);
+    return resultado;
+}
+
+/**
+ * xoshiro_sembrar
+ *
+ * Deriva el estado de xoshiro256** de una semilla con splitmix64 (nunca queda
+ * todo en cero).
+ *
+ * Entradas:
+ *   uint64_t s[4] – estado a sembrar.
+ *   uint64_t semilla – semilla de la secuencia.
+ *
+ * Retorna:
+ *   void
+ */
+static void xoshiro_sembrar(uint64_t s[4], uint64_t semilla) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (semilla += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        s[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * runtime_aleatorio
+ *
+ * Número pseudoaleatorio para decisiones internas del runtime (por ejemplo,
+ * qué caso revisar primero en my_channel_select). Cada kernel thread tiene su
+ * propio estado, sembrado la primera vez con el reloj y su dirección, así que
+ * no hace falta lock en modo M:N y no altera la secuencia de rand() de la
+ * aplicación.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   uint64_t – número pseudoaleatorio de 64 bits.
+ */
+uint64_t runtime_aleatorio(void) {
+    uint64_t *s = aleatorio_estado;
+    if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+        xoshiro_sembrar(s, (uint64_t)reloj_ns() ^ (uint64_t)(uintptr_t)s);
+    }
+    return xoshiro_siguiente(s);
+}
+
+
+
+//--------------------------------------------------------------
+//Lottery Scheduler
+//--------------------------------------------------------------
+
+#define LOTTERY_CAPACIDAD_INICIAL 64
+
+
+/**
+ * sorteo_aleatorio
+ *
+ * Avanza el generador del scheduler y devuelve el siguiente número. Cada
+ * scheduler tiene su propio estado, así que con la misma semilla la secuencia
+ * de sorteos se repite aunque haya otros schedulers o código que use rand().
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – scheduler dueño del estado.
+ *
+ * Retorna:
+ *   uint64_t – número pseudoaleatorio de 64 bits.
+ */
+static uint64_t sorteo_aleatorio(Lottery_Scheduler *ls) {
+    return xoshiro_siguiente(ls->rng);
+}
+
+/**
+ * lottery_scheduler_semilla
+ *
+ * Siembra el generador del scheduler Lottery, de modo que dos ejecuciones con
+ * la misma semilla y los mismos hilos sortean igual.
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – scheduler a sembrar.
+ *   uint64_t semilla – semilla de la secuencia.
+ *
+ * Retorna:
+ *   void
+ */
+void lottery_scheduler_semilla(Lottery_Scheduler *ls, uint64_t semilla) {
+    xoshiro_sembrar(ls->rng, semilla);
+}
+
+/**
+ * sorteo_sumar
+ *
+ * Suma delta a los boletos de la posición pos en el árbol de Fenwick
+ * (O(log n)).
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – scheduler dueño del árbol.
+ *   int pos – posición (1..capacidad).
+ *   long delta – boletos a sumar (puede ser negativo).
+ *
+ * Retorna:
+ *   void
+ */
+static void sorteo_sumar(Lottery_Scheduler *ls, int pos, long delta) {
+    for (; pos <= ls->capacidad; pos += pos & -pos) {
+        ls->arbol[pos] += delta;
+    }
+    ls->total += delta;
+}
+
+/**
+ * sorteo_crecer
+ *
+ * Duplica la capacidad del arreglo de hilos y del árbol. Como la capacidad es
+ * potencia de dos, las posiciones nuevas cubren rangos vacíos salvo la última,
+ * que cubre todo el árbol: basta con ponerle el total actual.
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – scheduler a agrandar.
+ *
+ * Retorna:
+ *   int – 0 si se agrandó, -1 si no hay memoria.
+ */
+static int sorteo_crecer(Lottery_Scheduler *ls) {
+    int nueva = ls->capacidad ? ls->capacidad * 2 : LOTTERY_CAPACIDAD_INICIAL;
+    TCB **hilos = realloc(ls->hilos, sizeof *hilos * (size_t)(nueva + 1));
+    if (hilos == NULL) {
+        return -1;
+    }
+    ls->hilos = hilos;
+    long *arbol = realloc(ls->arbol, sizeof *arbol * (size_t)(nueva + 1));
+    if (arbol == NULL) {
+        return -1;
+    }
+    memset(arbol + ls->capacidad + 1, 0, sizeof *arbol * (size_t)(nueva - ls->capacidad));
+    arbol[0]     = 0;
+    arbol[nueva] = ls->total;
+    ls->arbol     = arbol;
+    ls->capacidad = nueva;
+    return 0;
+}
+
+/**
+ * sorteo_peso
+ *
+ * Boletos con los que participa un hilo: los suyos, o uno si no tiene, para
+ * que un hilo sin boletos no quede sin CPU para siempre.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a consultar.
+ *
+ * Retorna:
+ *   int – boletos del hilo (al menos 1).
+ */
+static int sorteo_peso(TCB *hilo) {
+    return hilo->tickets > 0 ? hilo->tickets : 1;
+}
+
+/**
+ * sorteo_quitar
+ *
+ * Saca al hilo del arreglo y del árbol. Para mantener el arreglo compacto, el
+ * último hilo pasa a ocupar la posición que queda libre.
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – scheduler del hilo.
+ *   TCB *hilo – hilo encolado en ls.
+ *
+ * Retorna:
+ *   void
+ */
+static void sorteo_quitar(Lottery_Scheduler *ls, TCB *hilo) {
+    int pos    = hilo->sorteo_pos;
+    int ultima = ls->cantidad;
+    TCB *mover = ls->hilos[ultima];
+    if (mover != hilo) {
+        sorteo_sumar(ls, pos, (long)mover->sorteo_peso - hilo->sorteo_peso);
+        sorteo_sumar(ls, ultima, -(long)mover->sorteo_peso);
+        ls->hilos[pos]   = mover;
+        mover->sorteo_pos = pos;
+    } else {
+        sorteo_sumar(ls, pos, -(long)hilo->sorteo_peso);
+    }
+    ls->hilos[ultima] = NULL;
+    ls->cantidad--;
+    hilo->sorteo_pos = 0;
+}
+
+/**
+ * lottery_encolado
+ *
+ * Indica si el hilo está encolado en este scheduler Lottery (en modo M:N los
+ * hilos listos viven en las colas de los workers, no en el árbol).
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – scheduler a consultar.
+ *   TCB *hilo – hilo a buscar.
+ *
+ * Retorna:
+ *   int – 1 si está en el árbol de ls, 0 si no.
+ */
+static int lottery_encolado(Lottery_Scheduler *ls, TCB *hilo) {
+    int pos = hilo->sorteo_pos;
+    return pos > 0 && pos <= ls->cantidad && ls->hilos[pos] == hilo;
+}
+
+
+/**
+ * lottery_encolar_hilo
+ *
+ * Encola un hilo en el scheduler Lottery, asignándole su scheduler,
+ * marcándolo como READY y agregándolo al final del arreglo con sus boletos
+ * sumados al árbol (O(log n)).
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Lottery.
+ *   TCB *hilo – puntero al bloque de control del hilo a encolar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler.
+ */
+static void lottery_encolar_hilo(Scheduler *sched, TCB *hilo) {
+    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
+    hilo->scheduler = sched->origen;
+    cambiar_estado(hilo, READY);
+    hilo->next      = NULL;
+
+    if (ls->cantidad == ls->capacidad && sorteo_crecer(ls) == -1) {
+        fprintf(stderr, "lottery: sin memoria para encolar el hilo %d\n", hilo->tid);
+        abort();
+    }
+    int pos = ++ls->cantidad;
+    ls->hilos[pos]    = hilo;
+    hilo->sorteo_pos  = pos;
+    hilo->sorteo_peso = sorteo_peso(hilo);
+    sorteo_sumar(ls, pos, hilo->sorteo_peso);
+}
+
+/**
+ * lottery_siguiente_hilo
+ *
+ * Selecciona el siguiente hilo a ejecutar en el scheduler Lottery (el hilo
+ * desalojado ya fue reencolado por schedule()):
+ * - Genera un número aleatorio entre 0 y total-1 con el generador propio.
+ * - Baja por el árbol de Fenwick restando los rangos que quedan a la
+ *   izquierda hasta dar con la posición ganadora (O(log n)).
+ * - Remueve al hilo ganador y lo marca como RUNNING.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Lottery.
+ *
+ * Retorna:
+ *   TCB* – puntero al TCB del hilo ganador (estado RUNNING), o NULL si no hay
+ *          hilos listos.
+ */
+static TCB *lottery_siguiente_hilo(Scheduler *sched) {
+    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
+    if (ls->cantidad == 0 || ls->total <= 0)
+        return NULL;
+
+    long boleto = (long)(sorteo_aleatorio(ls) % (uint64_t)ls->total);
+    int pos = 0;
+    for (int paso = ls->capacidad; paso > 0; paso >>= 1) {
+        if (ls->arbol[pos + paso] <= boleto) {
+            pos    += paso;
+            boleto -= ls->arbol[pos];
+        }
+    }
+    TCB *mejor = ls->hilos[pos + 1];
+
+    sorteo_quitar(ls, mejor);
+    cambiar_estado(mejor, RUNNING);
+    return mejor;
+}
+
+/**
+ * lottery_remover_hilo
+ *
+ * Elimina un hilo específico del scheduler Lottery, restando sus boletos del
+ * árbol (O(log n)). Si el hilo no está encolado aquí no hace nada.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Lottery del cual se remueve el hilo.
+ *   TCB *hilo – puntero al bloque de control del hilo que se desea eliminar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler eliminando el hilo.
+ */
+
+static void lottery_remover_hilo(Scheduler *sched, TCB *hilo) {
+    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
+    if (!lottery_encolado(ls, hilo)) {
+        return;
+    }
+    sorteo_quitar(ls, hilo);
+    hilo->next = NULL;
+}
+
+/**
+ * lottery_actualizar_hilo
+ *
+ * Ajusta en el árbol los boletos de un hilo encolado cuyos tickets cambiaron
+ * (por ejemplo, al heredar los de un hilo que espera un mutex suyo).
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Lottery.
+ *   TCB *hilo – hilo cuyos tickets cambiaron.
+ *
+ * Retorna:
+ *   void
+ */
+static void lottery_actualizar_hilo(Scheduler *sched, TCB *hilo) {
+    Lottery_Scheduler *ls = (Lottery_Scheduler*)sched;
+    if (!lottery_encolado(ls, hilo)) {
+        return;
+    }
+    int peso = sorteo_peso(hilo);
+    sorteo_sumar(ls, hilo->sorteo_pos, (long)peso - hilo->sorteo_peso);
+    hilo->sorteo_peso = peso;
+}
+
+
+/**
+ * lottery_replicar
+ *
+ * Crea un Lottery vacío con el mismo quantum y un generador con semilla
+ * propia, para la cola local de un worker M:N.
+ *
+ * Entradas:
+ *   Scheduler *sched – scheduler Lottery original.
+ *
+ * Retorna:
+ *   Scheduler* – la réplica, o NULL si no hay memoria.
+ */
+static Scheduler *lottery_replicar(Scheduler *sched) {
+    Lottery_Scheduler *copia = malloc(sizeof *copia);
+    if (copia == NULL) {
+        return NULL;
+    }
+    *copia = *(Lottery_Scheduler*)sched;
+    copia->base.origen = sched;
+    copia->hilos     = NULL;
+    copia->arbol     = NULL;
+    copia->cantidad  = 0;
+    copia->capacidad = 0;
+    copia->total     = 0;
+    if (sorteo_crecer(copia) == -1) {
+        free(copia);
+        return NULL;
+    }
+    lottery_scheduler_semilla(copia, runtime_aleatorio());
+    return &copia->base;
+}
+
+
+/**
+ * lottery_scheduler_init
+ *
+ * Inicializa el scheduler Lottery, asignando las funciones de encolado, selección, remover y
+ * actualizar hilos; reserva el arreglo y el árbol iniciales, configura el quantum de tiempo,
+ * activa el scheduler, arranca el temporizador de preempción y siembra su generador con la
+ * hora (lottery_scheduler_semilla permite fijar otra semilla para repetir una ejecución).
+ *
+ * Entradas:
+ *   Lottery_Scheduler *ls – puntero al struct Lottery_Scheduler a inicializar.
+ *   int quantum_ms – duración del quantum en milisegundos.
+ *
+ * Retorna:
+ *   void – no retorna valor, configura la estructura interna y arranca la preempción.
+ */
+void lottery_scheduler_init(Lottery_Scheduler *ls, int quantum_ms) {
+    ls->base.encolar_hilo   = lottery_encolar_hilo;
+    ls->base.siguiente_hilo = lottery_siguiente_hilo;
+    ls->base.remover_hilo    = lottery_remover_hilo;
+    ls->base.actualizar_hilo = lottery_actualizar_hilo;
+    ls->base.replicar        = lottery_replicar;
+    ls->base.origen          = &ls->base;
+    ls->base.quantum_us     = (long)quantum_ms * 1000;
+    ls->base.utilizacion_ppm     = 0;
+    ls->base.utilizacion_max_ppm = 0;
+    ls->base.desaloja_al_despertar = 0;
+    ls->hilos               = NULL;
+    ls->arbol               = NULL;
+    ls->cantidad            = 0;
+    ls->capacidad           = 0;
+    ls->total               = 0;
+    ls->quantum             = quantum_ms;
+    sorteo_crecer(ls);   // si falla se reintenta al encolar
+    lottery_scheduler_semilla(ls, (uint64_t)time(NULL));
+    scheduler_activo = 2;
+    registrar_scheduler(&ls->base);
+    start_preemption(quantum_ms);
+}
+
+
+//--------------------------------------------------------------
+//Montículo de hilos (lo usan los schedulers con cola por prioridad)
+//--------------------------------------------------------------
+
+#define MONTICULO_CAPACIDAD_INICIAL 64
+
+
+/**
+ * monticulo_poner
+ *
+ * Coloca un hilo en la posición pos del montículo y le anota esa posición.
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   int pos – posición (1..cantidad).
+ *   TCB *hilo – hilo a colocar.
+ *
+ * Retorna:
+ *   void
+ */
+static inline void monticulo_poner(Monticulo *m, int pos, TCB *hilo) {
+    m->nodos[pos]      = hilo;
+    hilo->monticulo_pos = pos;
+}
+
+/**
+ * monticulo_subir
+ *
+ * Sube el hilo de la posición pos mientras vaya antes que su padre.
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   int pos – posición del hilo a subir.
+ *   int (*antes)(const TCB*, const TCB*) – 1 si el primero debe salir antes.
+ *
+ * Retorna:
+ *   void
+ */
+static void monticulo_subir(Monticulo *m, int pos,
+                            int (*antes)(const TCB*, const TCB*)) {
+    TCB *hilo = m->nodos[pos];
+    while (pos > 1 && antes(hilo, m->nodos[pos / 2])) {
+        monticulo_poner(m, pos, m->nodos[pos / 2]);
+        pos /= 2;
+    }
+    monticulo_poner(m, pos, hilo);
+}
+
+/**
+ * monticulo_bajar
+ *
+ * Baja el hilo de la posición pos mientras alguno de sus hijos vaya antes.
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   int pos – posición del hilo a bajar.
+ *   int (*antes)(const TCB*, const TCB*) – 1 si el primero debe salir antes.
+ *
+ * Retorna:
+ *   void
+ */
+static void monticulo_bajar(Monticulo *m, int pos,
+                            int (*antes)(const TCB*, const TCB*)) {
+    TCB *hilo = m->nodos[pos];
+    for (;;) {
+        int hijo = pos * 2;
+        if (hijo > m->cantidad) {
+            break;
+        }
+        if (hijo < m->cantidad && antes(m->nodos[hijo + 1], m->nodos[hijo])) {
+            hijo++;
+        }
+        if (!antes(m->nodos[hijo], hilo)) {
+            break;
+        }
+        monticulo_poner(m, pos, m->nodos[hijo]);
+        pos = hijo;
+    }
+    monticulo_poner(m, pos, hilo);
+}
+
+/**
+ * monticulo_insertar
+ *
+ * Agrega un hilo al montículo en O(log n), duplicando el arreglo si está lleno.
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   TCB *hilo – hilo a agregar.
+ *   int (*antes)(const TCB*, const TCB*) – 1 si el primero debe salir antes.
+ *
+ * Retorna:
+ *   int – 0 si se agregó, -1 si no hay memoria.
+ */
+static int monticulo_insertar(Monticulo *m, TCB *hilo,
+                              int (*antes)(const TCB*, const TCB*)) {
+    if (m->cantidad == m->capacidad) {
+        int nueva = m->capacidad ? m->capacidad * 2 : MONTICULO_CAPACIDAD_INICIAL;
+        TCB **nodos = realloc(m->nodos, sizeof *nodos * (size_t)(nueva + 1));
+        if (nodos == NULL) {
+            return -1;
+        }
+        m->nodos     = nodos;
+        m->capacidad = nueva;
+    }
+    m->cantidad++;
+    monticulo_poner(m, m->cantidad, hilo);
+    monticulo_subir(m, m->cantidad, antes);
+    return 0;
+}
+
+/**
+ * monticulo_contiene
+ *
+ * Indica si el hilo está en este montículo.
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   TCB *hilo – hilo a buscar.
+ *
+ * Retorna:
+ *   int – 1 si está, 0 si no.
+ */
+static int monticulo_contiene(Monticulo *m, TCB *hilo) {
+    int pos = hilo->monticulo_pos;
+    return pos > 0 && pos <= m->cantidad && m->nodos[pos] == hilo;
+}
+
+/**
+ * monticulo_reubicar
+ *
+ * Devuelve a su lugar a un hilo del montículo cuya clave cambió (O(log n)).
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   TCB *hilo – hilo que está en m.
+ *   int (*antes)(const TCB*, const TCB*) – 1 si el primero debe salir antes.
+ *
+ * Retorna:
+ *   void
+ */
+static void monticulo_reubicar(Monticulo *m, TCB *hilo,
+                               int (*antes)(const TCB*, const TCB*)) {
+    int pos = hilo->monticulo_pos;
+    if (pos > 1 && antes(hilo, m->nodos[pos / 2])) {
+        monticulo_subir(m, pos, antes);
+    } else {
+        monticulo_bajar(m, pos, antes);
+    }
+}
+
+/**
+ * monticulo_quitar
+ *
+ * Saca un hilo cualquiera del montículo en O(log n): el último ocupa su lugar
+ * y se reubica hacia arriba o hacia abajo según corresponda.
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   TCB *hilo – hilo que está en m.
+ *   int (*antes)(const TCB*, const TCB*) – 1 si el primero debe salir antes.
+ *
+ * Retorna:
+ *   void
+ */
+static void monticulo_quitar(Monticulo *m, TCB *hilo,
+                             int (*antes)(const TCB*, const TCB*)) {
+    int pos    = hilo->monticulo_pos;
+    TCB *ultimo = m->nodos[m->cantidad];
+    m->nodos[m->cantidad] = NULL;
+    m->cantidad--;
+    hilo->monticulo_pos = 0;
+    if (ultimo == hilo) {
+        return;
+    }
+    monticulo_poner(m, pos, ultimo);
+    monticulo_reubicar(m, ultimo, antes);
+}
+
+/**
+ * monticulo_extraer
+ *
+ * Saca el hilo que debe salir primero (la raíz) en O(log n).
+ *
+ * Entradas:
+ *   Monticulo *m – montículo.
+ *   int (*antes)(const TCB*, const TCB*) – 1 si el primero debe salir antes.
+ *
+ * Retorna:
+ *   TCB* – hilo extraído, o NULL si el montículo está vacío.
+ */
+static TCB *monticulo_extraer(Monticulo *m, int (*antes)(const TCB*, const TCB*)) {
+    if (m->cantidad == 0) {
+        return NULL;
+    }
+    TCB *raiz = m->nodos[1];
+    monticulo_quitar(m, raiz, antes);
+    return raiz;
+}
+
+
+
+//--------------------------------------------------------------
+//Stride Scheduler
+//--------------------------------------------------------------
+
+#define STRIDE_UNO (1LL << 32)   // paso de un hilo con un solo ticket (> INT_MAX: ningún paso es 0)
+
+
+/**
+ * stride_paso
+ *
+ * Paso que avanza el pase de un hilo por cada quantum completo: inversamente
+ * proporcional a sus tickets, ajustados a 1..STRIDE_UNO (un hilo sin tickets
+ * cuenta como si tuviera uno). Como STRIDE_UNO supera a INT_MAX, el paso nunca
+ * es 0 (un hilo con paso 0 ganaría todos los sorteos) y con muchos tickets
+ * conserva precisión: 2^32 / 700000 = 6135. Con él un pase de 63 bits alcanza
+ * para 2^31 quanta completos de un hilo con un ticket.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a consultar.
+ *
+ * Retorna:
+ *   long long – paso del hilo.
+ */
+static long long stride_paso(const TCB *hilo) {
+    long long tickets = hilo->tickets;
+    if (tickets < 1) {
+        tickets = 1;
+    } else if (tickets > STRIDE_UNO) {
+        tickets = STRIDE_UNO;
+    }
+    return STRIDE_UNO / tickets;
+}
+
+/**
+ * stride_antes
+ *
+ * Orden del montículo Stride: menor pase primero y, si empatan, menor tid,
+ * para que el orden no dependa de cómo quedó armado el montículo.
+ *
+ * Entradas:
+ *   const TCB *a, const TCB *b – hilos a comparar.
+ *
+ * Retorna:
+ *   int – 1 si a debe ejecutarse antes que b.
+ */
+static int stride_antes(const TCB *a, const TCB *b) {
+    if (a->pase != b->pase) {
+        return a->pase < b->pase;
+    }
+    return a->tid < b->tid;
+}
+
+
+/**
+ * stride_encolar_hilo
+ *
+ * Encola un hilo en el scheduler Stride. Al elegirlo se le cobró un quantum
+ * completo; si vuelve porque lo desalojaron o cedió la CPU (es el hilo actual)
+ * se le devuelve la parte del quantum que no usó. Si viene de estar bloqueado o
+ * es nuevo, su pase sube al menos hasta el pase global.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Stride.
+ *   TCB *hilo – puntero al bloque de control del hilo a encolar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler.
+ */
+static void stride_encolar_hilo(Scheduler *sched, TCB *hilo) {
+    Stride_Scheduler *ss = (Stride_Scheduler*)sched;
+    if (hilo == hilo_actual && hilo->scheduler == sched->origen && hilo->pase_desde_ns > 0) {
+        long long quantum_ns = quantum_de(hilo) * 1000LL;
+        long long usado_ns   = reloj_ns() - hilo->pase_desde_ns;
+        if (quantum_ns > 0 && usado_ns < quantum_ns) {
+            long long paso = stride_paso(hilo);
+            hilo->pase -= paso - (long long)((__int128)paso * usado_ns / quantum_ns);
+        }
+    }
+    if (hilo->pase < ss->pase_global) {
+        hilo->pase = ss->pase_global;
+    }
+    hilo->pase_desde_ns = 0;
+    hilo->scheduler = sched->origen;
+    cambiar_estado(hilo, READY);
+    hilo->next      = NULL;
+
+    if (monticulo_insertar(&ss->cola, hilo, stride_antes) == -1) {
+        fprintf(stderr, "stride: sin memoria para encolar el hilo %d\n", hilo->tid);
+        abort();
+    }
+}
+
+/**
+ * stride_siguiente_hilo
+ *
+ * Selecciona el hilo de menor pase (O(log n)), adelanta el pase global hasta
+ * él y le cobra un quantum completo de antemano, de modo que un hilo que se
+ * bloquea antes de terminarlo no compite con ventaja al volver.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Stride.
+ *
+ * Retorna:
+ *   TCB* – puntero al TCB del hilo elegido (estado RUNNING), o NULL si no hay
+ *          hilos listos.
+ */
+static TCB *stride_siguiente_hilo(Scheduler *sched) {
+    Stride_Scheduler *ss = (Stride_Scheduler*)sched;
+    TCB *mejor = monticulo_extraer(&ss->cola, stride_antes);
+    if (mejor == NULL) {
+        return NULL;
+    }
+    ss->pase_global      = mejor->pase;
+    mejor->pase         += stride_paso(mejor);
+    mejor->pase_desde_ns = reloj_ns();
+    cambiar_estado(mejor, RUNNING);
+    return mejor;
+}
+
+/**
+ * stride_remover_hilo
+ *
+ * Elimina un hilo específico del scheduler Stride (O(log n)). Si el hilo no
+ * está encolado aquí no hace nada.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo Stride.
+ *   TCB *hilo – puntero al bloque de control del hilo que se desea eliminar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler.
+ */
+static void stride_remover_hilo(Scheduler *sched, TCB *hilo) {
+    Stride_Scheduler *ss = (Stride_Scheduler*)sched;
+    if (!monticulo_contiene(&ss->cola, hilo)) {
+        return;
+    }
+    monticulo_quitar(&ss->cola, hilo, stride_antes);
+    hilo->next = NULL;
+}
+
+
+/**
+ * stride_replicar
+ *
+ * Crea un Stride vacío con el mismo quantum, para la cola local de un worker
+ * M:N. Arranca con el pase global del original, de modo que los hilos que
+ * pasan de un worker a otro no llegan con demasiada ventaja ni desventaja.
+ *
+ * Entradas:
+ *   Scheduler *sched – scheduler Stride original.
+ *
+ * Retorna:
+ *   Scheduler* – la réplica, o NULL si no hay memoria.
+ */
+static Scheduler *stride_replicar(Scheduler *sched) {
+    Stride_Scheduler *copia = malloc(sizeof *copia);
+    if (copia == NULL) {
+        return NULL;
+    }
+    *copia = *(Stride_Scheduler*)sched;
+    copia->base.origen   = sched;
+    copia->cola.nodos     = NULL;
+    copia->cola.cantidad  = 0;
+    copia->cola.capacidad = 0;
+    return &copia->base;
+}
+
+
+/**
+ * stride_scheduler_init
+ *
+ * Inicializa el scheduler Stride, asignando las funciones de encolado, selección y remover de
+ * hilos; deja el montículo vacío y el pase global en cero, configura el quantum de tiempo,
+ * activa el scheduler y arranca el temporizador de preempción. Los tickets de cada hilo son su
+ * peso: con tickets 10 y 20 el segundo recibe el doble de CPU, con un error que no crece con el
+ * tiempo (a diferencia de Lottery, donde la proporción solo se cumple en promedio).
+ *
+ * Entradas:
+ *   Stride_Scheduler *ss – puntero al struct Stride_Scheduler a inicializar.
+ *   int quantum_ms – duración del quantum en milisegundos.
+ *
+ * Retorna:
+ *   void – no retorna valor, configura la estructura interna y arranca la preempción.
+ */
+void stride_scheduler_init(Stride_Scheduler *ss, int quantum_ms) {
+    ss->base.encolar_hilo    = stride_encolar_hilo;
+    ss->base.siguiente_hilo  = stride_siguiente_hilo;
+    ss->base.remover_hilo    = stride_remover_hilo;
+    ss->base.actualizar_hilo = NULL;   // el pase no depende de los tickets actuales
+    ss->base.replicar        = stride_replicar;
+    ss->base.origen          = &ss->base;
+    ss->base.quantum_us      = (long)quantum_ms * 1000;
+    ss->base.utilizacion_ppm     = 0;
+    ss->base.utilizacion_max_ppm = 0;
+    ss->base.desaloja_al_despertar = 0;
+    ss->cola.nodos           = NULL;
+    ss->cola.cantidad        = 0;
+    ss->cola.capacidad       = 0;
+    ss->pase_global          = 0;
+    ss->quantum              = quantum_ms;
+    scheduler_activo = 3;
+    registrar_scheduler(&ss->base);
+    start_preemption(quantum_ms);
+}
+
+
+//--------------------------------------------------------------
+//Real Time Scheduler con EDF
+//--------------------------------------------------------------
+
+
+/**
+ * edf_antes
+ *
+ * Orden del montículo EDF: deadline más cercano primero y, si empatan, el que
+ * llegó antes a la cola (como hacía la lista).
+ *
+ * Entradas:
+ *   const TCB *a, const TCB *b – hilos a comparar.
+ *
+ * Retorna:
+ *   int – 1 si a debe ejecutarse antes que b.
+ */
+static int edf_antes(const TCB *a, const TCB *b) {
+    if (a->deadline != b->deadline) {
+        return a->deadline < b->deadline;
+    }
+    return a->llegada < b->llegada;
+}
+
+
+/**
+ * edf_siguiente_hilo
+ *
+ * Saca del montículo del scheduler EDF el hilo con el deadline más cercano
+ * (O(log n)) y lo marca como RUNNING antes de retornarlo.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo EDF.
+ *
+ * Retorna:
+ *   TCB* – puntero al TCB del hilo seleccionado (con el menor deadline) marcado como RUNNING,
+ *          o NULL si no hay hilos en READY.
+ */
+static TCB *edf_siguiente_hilo(Scheduler *sched) {
+    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
+    TCB *mejor = monticulo_extraer(&edf_scheduler->cola, edf_antes);
+    if (!mejor)
+        return NULL;
+    desalojo_registrar(mejor);
+    cambiar_estado(mejor, RUNNING);
+    return mejor;
+}
+
+
+/**
+ * edf_encolar_hilo
+ *
+ * Agrega un hilo al montículo del scheduler EDF (O(log n)), marcándolo como READY.
+ * Si el nuevo hilo tiene un deadline menor al del hilo actualmente en ejecución,
+ * el hilo actual se reencola y se fuerza un cambio de contexto para ejecutar de inmediato el hilo con deadline más cercano.
+ * Si el desalojo está suspendido (desalojo_suspender), el cambio se aplaza hasta desalojo_reanudar;
+ * si la cola es la réplica de otro worker (M:N), compara con el hilo de ese worker y lo avisa.
+ * Los hilos que despierta la rueda (liberaciones de tareas periódicas, sleeps) pasan por aquí
+ * desde el schedule() que provoca la alarma armada para ese despertar.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo EDF.
+ *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler y
+ *          puede cambiar de contexto si el nuevo hilo tiene
+ *          deadline más cercano que el hilo actual.
+ */
+static void edf_encolar_hilo(Scheduler *sched, TCB *hilo) {
+
+    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
+    hilo->scheduler = sched->origen;
+    cambiar_estado(hilo, READY);
+    hilo->next      = NULL;
+    hilo->llegada   = edf_scheduler->llegadas++;
+    if (monticulo_insertar(&edf_scheduler->cola, hilo, edf_antes) == -1) {
+        fprintf(stderr, "edf: sin memoria para encolar el hilo %d\n", hilo->tid);
+        abort();
+    }
+    TCB *actual  = desalojo_contra();
+    int desaloja = actual && actual->state == RUNNING && hilo->deadline < actual->deadline;
+    desalojo_marcar(hilo, desaloja);
+    if (desaloja) {
+        desalojo_pedir();               // reencola al actual y elige al de menor deadline
+    }
+
+}
+
+
+/**
+ * edf_remover_hilo
+ *
+ * Elimina un hilo específico del montículo del scheduler EDF (O(log n)). Si el
+ * hilo no está encolado aquí no hace nada.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo EDF del cual se remueve el hilo.
+ *   TCB *hilo – puntero al bloque de control del hilo que se desea eliminar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica la estructura interna del scheduler eliminando el hilo.
+ */
+static void edf_remover_hilo(Scheduler *sched, TCB *hilo) {
+    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
+    if (!monticulo_contiene(&edf_scheduler->cola, hilo)) {
+        return;
+    }
+    monticulo_quitar(&edf_scheduler->cola, hilo, edf_antes);
+    hilo->next = NULL;
+}
+
+
+/**
+ * edf_actualizar_hilo
+ *
+ * Reubica en el montículo a un hilo encolado cuyo deadline cambió (por
+ * ejemplo, al heredar el de un hilo que espera un mutex suyo).
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo EDF.
+ *   TCB *hilo – hilo cuyo deadline cambió.
+ *
+ * Retorna:
+ *   void
+ */
+static void edf_actualizar_hilo(Scheduler *sched, TCB *hilo) {
+    EDF_Scheduler *edf_scheduler = (EDF_Scheduler*)sched;
+    if (!monticulo_contiene(&edf_scheduler->cola, hilo)) {
+        return;
+    }
+    monticulo_reubicar(&edf_scheduler->cola, hilo, edf_antes);
+}
+
+
+/**
+ * edf_replicar
+ *
+ * Crea un EDF vacío, para la cola local de un worker M:N. El control de
+ * admisión sigue en el original: los hilos anotan ese como su scheduler.
+ *
+ * Entradas:
+ *   Scheduler *sched – scheduler EDF original.
+ *
+ * Retorna:
+ *   Scheduler* – la réplica, o NULL si no hay memoria.
+ */
+static Scheduler *edf_replicar(Scheduler *sched) {
+    EDF_Scheduler *copia = malloc(sizeof *copia);
+    if (copia == NULL) {
+        return NULL;
+    }
+    *copia = *(EDF_Scheduler*)sched;
+    copia->base.origen    = sched;
+    copia->cola.nodos     = NULL;
+    copia->cola.cantidad  = 0;
+    copia->cola.capacidad = 0;
+    copia->llegadas       = 0;
+    return &copia->base;
+}
+
+
+/**
+ * edf_scheduler_init
+ *
+ * Inicializa el scheduler EDF, asignando las funciones de encolado, selección, remover y
+ * actualizar hilos; deja el montículo vacío y limita el control de admisión de tareas
+ * periódicas a una CPU (densidad total <= 1). No hay quantum: un hilo solo pierde la CPU
+ * cuando se encola uno con deadline más cercano, incluidos los que despierta la rueda, para
+ * lo cual instala el temporizador de preempción y lo arma en cada despacho para el próximo
+ * despertar (quantum_despachar).
+ *
+ * Entradas:
+ *   EDF_Scheduler *edf_scheduler – puntero al struct EDF_Scheduler a inicializar.
+ *
+ * Retorna:
+ *   void – no retorna valor; configura la estructura interna del scheduler.
+ */
+void edf_scheduler_init(EDF_Scheduler *edf_scheduler) {
+    edf_scheduler->base.encolar_hilo   = edf_encolar_hilo;
+    edf_scheduler->base.siguiente_hilo = edf_siguiente_hilo;
+    edf_scheduler->base.remover_hilo    = edf_remover_hilo;
+    edf_scheduler->base.actualizar_hilo = edf_actualizar_hilo;
+    edf_scheduler->base.replicar        = edf_replicar;
+    edf_scheduler->base.origen          = &edf_scheduler->base;
+    edf_scheduler->base.quantum_us      = 0;      // solo desaloja al llegar un deadline más cercano
+    edf_scheduler->base.utilizacion_ppm     = 0;
+    edf_scheduler->base.utilizacion_max_ppm = 1000000;   // admite tareas mientras quepan en una CPU
+    edf_scheduler->base.desaloja_al_despertar = 1;
+    edf_scheduler->cola.nodos          = NULL;
+    edf_scheduler->cola.cantidad       = 0;
+    edf_scheduler->cola.capacidad      = 0;
+    edf_scheduler->llegadas            = 0;
+    scheduler_activo = 0;
+    registrar_scheduler(&edf_scheduler->base);
+    preemption_instalar();
+}
+
+
+
+
+//--------------------------------------------------------------
+//Real Time Scheduler con prioridades fijas (RMS)
+//--------------------------------------------------------------
+
+
+/**
+ * rms_nivel
+ *
+ * Cola que le corresponde a un hilo: su prioridad, ajustada al rango
+ * 0..RMS_PRIORIDADES-1.
+ *
+ * Entradas:
+ *   const TCB *hilo – hilo a consultar.
+ *
+ * Retorna:
+ *   int – nivel de prioridad (0 es el más alto).
+ */
+static int rms_nivel(const TCB *hilo) {
+    if (hilo->priority < 0) {
+        return 0;
+    }
+    return hilo->priority < RMS_PRIORIDADES ? hilo->priority : RMS_PRIORIDADES - 1;
+}
+
+
+/**
+ * rms_encolar_hilo
+ *
+ * Agrega un hilo al final de la cola de su prioridad (O(1)) y enciende el bit
+ * de esa cola. Si es el hilo actual y hay hilos más prioritarios listos (lo
+ * están desalojando) vuelve al frente de su cola, para retomar antes que sus
+ * pares. Si el nuevo hilo es más prioritario que el que ejecuta en este
+ * scheduler, lo desaloja como en EDF: ya mismo, en desalojo_reanudar si el
+ * desalojo está suspendido, o avisando al worker dueño de la cola (M:N).
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo RMS.
+ *   TCB *hilo – puntero al TCB del hilo a encolar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica las colas del scheduler y puede cambiar
+ *          de contexto.
+ */
+static void rms_encolar_hilo(Scheduler *sched, TCB *hilo) {
+    RMS_Scheduler *rs = (RMS_Scheduler*)sched;
+    int nivel      = rms_nivel(hilo);
+    uint64_t bit   = 1ULL << nivel;
+    int al_frente  = hilo == hilo_actual && (rs->mapa_listos & (bit - 1)) != 0;
+
+    hilo->scheduler = sched->origen;
+    cambiar_estado(hilo, READY);
+    if (al_frente) {
+        hilo->next = rs->cabeza[nivel];
+        rs->cabeza[nivel] = hilo;
+        if (rs->cola[nivel] == NULL) {
+            rs->cola[nivel] = hilo;
+        }
+    } else {
+        hilo->next = NULL;
+        if (rs->cola[nivel] == NULL) {
+            rs->cabeza[nivel] = hilo;
+        } else {
+            rs->cola[nivel]->next = hilo;
+        }
+        rs->cola[nivel] = hilo;
+    }
+    rs->mapa_listos |= bit;
+
+    TCB *actual  = desalojo_contra();
+    int desaloja = actual && actual != hilo && actual->state == RUNNING &&
+                   actual->scheduler == sched->origen && nivel < rms_nivel(actual);
+    desalojo_marcar(hilo, desaloja);
+    if (desaloja) {
+        desalojo_pedir();               // reencola al actual y elige al más prioritario
+    }
+}
+
+
+/**
+ * rms_siguiente_hilo
+ *
+ * Saca el primer hilo de la cola más prioritaria no vacía: el primer bit
+ * encendido del mapa (O(1)). Apaga el bit si la cola queda vacía.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo RMS.
+ *
+ * Retorna:
+ *   TCB* – puntero al TCB del hilo elegido (estado RUNNING), o NULL si no hay
+ *          hilos listos.
+ */
+static TCB *rms_siguiente_hilo(Scheduler *sched) {
+    RMS_Scheduler *rs = (RMS_Scheduler*)sched;
+    if (rs->mapa_listos == 0) {
+        return NULL;
+    }
+    int nivel   = __builtin_ctzll(rs->mapa_listos);
+    TCB *elegido = rs->cabeza[nivel];
+    rs->cabeza[nivel] = elegido->next;
+    if (rs->cabeza[nivel] == NULL) {
+        rs->cola[nivel]   = NULL;
+        rs->mapa_listos &= ~(1ULL << nivel);
+    }
+    elegido->next = NULL;
+    desalojo_registrar(elegido);
+    cambiar_estado(elegido, RUNNING);
+    return elegido;
+}
+
+
+/**
+ * rms_quitar
+ *
+ * Elimina un hilo de la cola de un nivel, recorriéndola como en Round Robin,
+ * y apaga el bit del nivel si la cola queda vacía.
+ *
+ * Entradas:
+ *   RMS_Scheduler *rs – scheduler RMS.
+ *   int nivel – cola donde buscarlo.
+ *   TCB *hilo – hilo a eliminar.
+ *
+ * Retorna:
+ *   int – 1 si estaba en esa cola, 0 si no.
+ */
+static int rms_quitar(RMS_Scheduler *rs, int nivel, TCB *hilo) {
+    TCB *anterior = NULL;
+    for (TCB *it = rs->cabeza[nivel]; it; anterior = it, it = it->next) {
+        if (it != hilo) {
+            continue;
+        }
+        if (anterior) {
+            anterior->next = it->next;
+        } else {
+            rs->cabeza[nivel] = it->next;
+        }
+        if (rs->cola[nivel] == it) {
+            rs->cola[nivel] = anterior;
+        }
+        if (rs->cabeza[nivel] == NULL) {
+            rs->mapa_listos &= ~(1ULL << nivel);
+        }
+        hilo->next = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * rms_remover_hilo
+ *
+ * Elimina un hilo específico de la cola de su prioridad, recorriéndola como
+ * en Round Robin. Si el hilo no está encolado aquí no hace nada.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo RMS.
+ *   TCB *hilo – puntero al bloque de control del hilo que se desea eliminar.
+ *
+ * Retorna:
+ *   void – no retorna valor, modifica las colas del scheduler.
+ */
+static void rms_remover_hilo(Scheduler *sched, TCB *hilo) {
+    rms_quitar((RMS_Scheduler*)sched, rms_nivel(hilo), hilo);
+}
+
+
+/**
+ * rms_actualizar_hilo
+ *
+ * Mueve a la cola de su nueva prioridad un hilo encolado cuya prioridad
+ * cambió (al heredar la de un hilo que espera un mutex suyo, al devolverla o
+ * en rms_asignar_prioridades). Como la prioridad ya cambió, se busca en las
+ * colas encendidas del mapa; reencolarlo en su nivel puede desalojar al hilo
+ * actual, igual que al despertar. Si el hilo no está encolado aquí o ya está
+ * en la cola correcta no hace nada.
+ *
+ * Entradas:
+ *   Scheduler *sched – puntero al scheduler de tipo RMS.
+ *   TCB *hilo – hilo cuya prioridad cambió.
+ *
+ * Retorna:
+ *   void
+ */
+static void rms_actualizar_hilo(Scheduler *sched, TCB *hilo) {
+    RMS_Scheduler *rs = (RMS_Scheduler*)sched;
+    int nuevo = rms_nivel(hilo);
+    for (TCB *it = rs->cabeza[nuevo]; it; it = it->next) {
+        if (it == hilo) {
+            return;
+        }
+    }
+    for (uint64_t mapa = rs->mapa_listos & ~(1ULL << nuevo); mapa; mapa &= mapa - 1) {
+        if (rms_quitar(rs, __builtin_ctzll(mapa), hilo)) {
+            rms_encolar_hilo(sched, hilo);
+            return;
+        }
+    }
+}
+
+
+/**
+ * rms_orden_tareas
+ *
+ * Orden de qsort para asignar prioridades: menor plazo primero (igual al
+ * período salvo que la tarea pida uno menor) y, si empatan, menor período.
+ *
+ * Entradas:
+ *   const void *a, const void *b – punteros a TCB* a comparar.
+ *
+ * Retorna:
+ *   int – negativo, cero o positivo según a vaya antes, empate o después de b.
+ */
+static int rms_orden_tareas(const void *a, const void *b) {
+    const TCB *x = *(TCB *const *)a;
+    const TCB *y = *(TCB *const *)b;
+    if (x->plazo_ms != y->plazo_ms) {
+        return x->plazo_ms < y->plazo_ms ? -1 : 1;
+    }
+    if (x->periodo_ms != y->periodo_ms) {
+        return x->periodo_ms < y->periodo_ms ? -1 : 1;
+    }
+    return 0;
+}
+
+
+/**
+ * rms_asignar_prioridades
+ *
+ * Asigna prioridades Rate Monotonic a las tareas periódicas vivas de este
+ * scheduler: la de período más corto recibe la prioridad primera y cada
+ * período distinto la siguiente; tareas con el mismo período comparten
+ * prioridad. Si una tarea pidió un plazo menor a su período se ordena por el
+ * plazo (Deadline Monotonic, que coincide con RMS cuando plazo y período son
+ * iguales). Las tareas listas se mueven a la cola de su nueva prioridad (en
+ * modo M:N, dentro de la cola local del worker donde estén), lo que puede
+ * desalojar al hilo actual. Se asigna la prioridad propia: la que una tarea
+ * hereda por un mutex se conserva hasta soltarlo. Los hilos que no son
+ * periódicos conservan su prioridad: conviene darles una mayor o igual al
+ * valor retornado.
+ *
+ * Entradas:
+ *   RMS_Scheduler *rs – scheduler cuyas tareas se ordenan.
+ *   int primera – prioridad de la tarea más frecuente.
+ *
+ * Retorna:
+ *   int – prioridad siguiente a la última asignada, o -1 si no hay memoria.
+ */
+int rms_asignar_prioridades(RMS_Scheduler *rs, int primera) {
+    runtime_lock();
+    size_t n = 0;
+    TCB **tareas = malloc(sizeof *tareas * (global_thread_pool.count + 1));
+    if (tareas == NULL) {
+        runtime_unlock();
+        return -1;
+    }
+    for (size_t i = 0; i < global_thread_pool.count; i++) {
+        TCB *hilo = global_thread_pool.threads[i];
+        if (hilo->scheduler == &rs->base && hilo->periodo_ms > 0 &&
+            hilo->state != TERMINATED) {
+            tareas[n++] = hilo;
+        }
+    }
+    qsort(tareas, n, sizeof *tareas, rms_orden_tareas);
+
+    int prioridad = primera;
+    for (size_t i = 0; i < n; i++) {
+        TCB *hilo = tareas[i];
+        if (i > 0 && rms_orden_tareas(&tareas[i - 1], &hilo) != 0) {
+            prioridad++;
+        }
+        if (hilo->priority_propia == prioridad) {
+            continue;
+        }
+        hilo->priority_propia = prioridad;
+        recalcular_herencia(hilo);   // conserva lo heredado y la mueve de cola (actualizar_hilo)
+    }
+    free(tareas);
+    TCB *actual = hilo_actual;
+    if (!modo_mn && actual && actual->state == RUNNING && actual->scheduler == &rs->base &&
+        rs->mapa_listos != 0 && __builtin_ctzll(rs->mapa_listos) < rms_nivel(actual)) {
+        desalojo_pendiente = 1;     // bajó la prioridad del actual: cambia en runtime_unlock
+    }
+    runtime_unlock();
+    return n > 0 ? prioridad + 1 : primera;
+}
+
+
+/**
+ * rms_replicar
+ *
+ * Crea un RMS vacío con el mismo quantum, para la cola local de un worker M:N.
+ *
+ * Entradas:
+ *   Scheduler *sched – scheduler RMS original.
+ *
+ * Retorna:
+ *   Scheduler* – la réplica, o NULL si no hay memoria.
+ */
+static Scheduler *rms_replicar(Scheduler *sched) {
+    RMS_Scheduler *copia = malloc(sizeof *copia);
+    if (copia == NULL) {
+        return NULL;
+    }
+    *copia = *(RMS_Scheduler*)sched;
+    copia->base.origen = sched;
+    for (int p = 0; p < RMS_PRIORIDADES; p++) {
+        copia->cabeza[p] = NULL;
+        copia->cola[p]   = NULL;
+    }
+    copia->mapa_listos = 0;
+    return &copia->base;
+}
+
+
+/**
+ * rms_scheduler_init
+ *
+ * Inicializa el scheduler RMS, asignando las funciones de encolado, selección, remover y
+ * actualizar hilos; deja todas las colas vacías y limita el control de admisión de tareas periódicas a
+ * ln 2 (~69 %) de la CPU, la cota de Liu y Layland para cualquier cantidad de tareas: por
+ * debajo de ella las prioridades Rate Monotonic cumplen todos los deadlines. Como EDF,
+ * desaloja al encolar un hilo más prioritario, también si lo despierta la rueda. Con
+ * quantum_ms > 0 los hilos de la misma prioridad se turnan como en Round Robin.
+ *
+ * Entradas:
+ *   RMS_Scheduler *rs – puntero al struct RMS_Scheduler a inicializar.
+ *   int quantum_ms – quantum entre hilos de igual prioridad en milisegundos (0: FIFO).
+ *
+ * Retorna:
+ *   void – no retorna valor, configura la estructura interna y el temporizador de preempción.
+ */
+void rms_scheduler_init(RMS_Scheduler *rs, int quantum_ms) {
+    rs->base.encolar_hilo    = rms_encolar_hilo;
+    rs->base.siguiente_hilo  = rms_siguiente_hilo;
+    rs->base.remover_hilo    = rms_remover_hilo;
+    rs->base.actualizar_hilo = rms_actualizar_hilo;
+    rs->base.replicar        = rms_replicar;
+    rs->base.origen          = &rs->base;
+    rs->base.quantum_us      = (long)quantum_ms * 1000;
+    rs->base.utilizacion_ppm     = 0;
+    rs->base.utilizacion_max_ppm = 693147;   // ln 2 en millonésimas
+    rs->base.desaloja_al_despertar = 1;
+    for (int p = 0; p < RMS_PRIORIDADES; p++) {
+        rs->cabeza[p] = NULL;
+        rs->cola[p]   = NULL;
+    }
+    rs->mapa_listos = 0;
+    rs->quantum     = quantum_ms;
+    scheduler_activo = 4;
+    registrar_scheduler(&rs->base);
+    if (quantum_ms > 0) {
+        start_preemption(quantum_ms);
+    } else {
+        preemption_instalar();
+    }
+}
+
+
+
+
+//--------------------------------------------------------------
+//Runtime M:N (varios kernel threads con robo de trabajo)
+//--------------------------------------------------------------
+
+
+/**
+ * Worker
+ *
+ * Kernel thread que ejecuta hilos verdes en modo M:N.
+ *
+ * Campos:
+ *   int id:
+ *     – índice del worker (el 0 es el hilo principal del proceso).
+ *
+ *   pthread_t kthread:
+ *     – kernel thread del worker (no se usa para el worker 0).
+ *
+ *   TCB ctx:
+ *     – TCB sin registrar que solo guarda el contexto del lazo del worker,
+ *       para cambiar entre él y los hilos con cambiar_contexto().
+ *
+ *   Scheduler *colas[MAX_SCHEDULERS]:
+ *     – cola local de hilos READY: una réplica (replicar) de cada scheduler
+ *       registrado, en el mismo índice que en schedulers[], creada la primera
+ *       vez que el worker recibe un hilo de ese scheduler.
+ *
+ *   int preferido:
+ *     – índice del scheduler del último hilo que ejecutó; se consulta primero,
+ *       como hace siguiente_listo en modo 1:1.
+ *
+ *   size_t largo:
+ *     – cantidad de hilos en la cola local (los ladrones lo consultan sin lock).
+ *
+ *   atomic_flag lock:
+ *     – protege la cola local (el dueño encola y elige, los demás roban).
+ *
+ *   timer_t alarma, int alarma_lista:
+ *     – temporizador del quantum del worker (su señal le llega solo a este
+ *       kernel thread) y si se pudo crear.
+ *
+ *   volatile sig_atomic_t alarma_armada, long long alarma_vence_ns:
+ *     – si la alarma está armada y para qué instante.
+ *
+ *   long long quantum_fin_ns, evento_ns:
+ *     – fin del quantum del hilo en ejecución y próximo despertar de la rueda
+ *       que puede desalojarlo (0: ninguno), como en modo 1:1.
+ *
+ *   TCB *ejecutando, int desalojo_pedido:
+ *     – hilo en ejecución (NULL entre hilos), que otros workers consultan al
+ *       encolarle uno, y si alguno de ellos pidió desalojarlo (worker_politica).
+ */
+typedef struct {
+    int          id;
+    pthread_t    kthread;
+    TCB          ctx;
+    Scheduler   *colas[MAX_SCHEDULERS];
+    int          preferido;
+    _Atomic size_t largo;
+    atomic_flag  lock;
+    timer_t      alarma;
+    int          alarma_lista;
+    volatile sig_atomic_t alarma_armada;
+    long long    alarma_vence_ns;
+    long long    quantum_fin_ns;
+    long long    evento_ns;
+    TCB *_Atomic ejecutando;
+    _Atomic int  desalojo_pedido;
+} Worker;
+
+static Worker *workers        = NULL;
+static int     worker_count   = 0;
+static _Atomic unsigned worker_siguiente = 0;    // reparto de hilos encolados fuera de un worker
+static _Thread_local Worker *worker_actual = NULL;
+
+static pthread_mutex_t ocio_mutex = PTHREAD_MUTEX_INITIALIZER;  // workers sin trabajo
+static pthread_cond_t  ocio_cond  = PTHREAD_COND_INITIALIZER;
+static _Atomic int workers_ociosos = 0;     // workers dormidos en ocio_cond
+static _Atomic int hay_sondeador   = 0;     // un worker ocioso espera en epoll la rueda o E/S
+static long long   sondeo_hasta_ms = -1;    // hasta cuándo espera (con runtime_lock), -1 sin límite
+static _Thread_local int avisos_pendientes = 0;   // AVISO_*: a quién despertar al soltar runtime_lock
+
+enum { AVISO_OCIOSO = 1, AVISO_SONDEADOR = 2 };
+
+static void mn_desalojo_pedir(Worker *w);
+
+
+/**
+ * spin_adquirir
+ *
+ * Adquiere un spinlock basado en atomic_flag. Si tras SPIN_VUELTAS sigue
+ * ocupado cede el CPU al kernel: el dueño puede ser un worker sin CPU.
+ *
+ * Entradas:
+ *   atomic_flag *f – spinlock a adquirir.
+ *
+ * Retorna:
+ *   void
+ */
+static void spin_adquirir(atomic_flag *f) {
+    int vueltas = 0;
+    while (atomic_flag_test_and_set_explicit(f, memory_order_acquire)) {
+        if (++vueltas < SPIN_VUELTAS) {
+            __builtin_ia32_pause();
+        } else {
+            vueltas = 0;
+            sched_yield();
+        }
+    }
+}
+
+
+/**
+ * spin_liberar
+ *
+ * Libera un spinlock basado en atomic_flag.
+ *
+ * Entradas:
+ *   atomic_flag *f – spinlock a liberar.
+ *
+ * Retorna:
+ *   void
+ */
+static void spin_liberar(atomic_flag *f) {
+    atomic_flag_clear_explicit(f, memory_order_release);
+}
+
+
+/**
+ * runtime_lock
+ *
+ * Abre una sección crítica (desalojo_suspender): la alarma del quantum no
+ * cambia de hilo hasta runtime_unlock(). En modo M:N además adquiere el lock
+ * global que protege las estructuras compartidas del runtime (pool de hilos,
+ * colas de espera de mutex, join, rueda de tiempo); las colas de hilos listos
+ * no dependen de él, cada worker protege la suya.
+ *
+ * Si un hilo llama a schedule() con el lock tomado (para bloquearse o
+ * terminar), el lock lo libera el worker después de cambiar de contexto, de
+ * modo que ningún otro worker pueda despertar al hilo antes de que su
+ * contexto quede guardado.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+void runtime_lock(void) {
+    desalojo_suspendido++;
+    atomic_signal_fence(memory_order_seq_cst);
+    if (modo_mn) {
+        spin_adquirir(&runtime_spin);
+    }
+    runtime_lock_tomado = 1;
+}
+
+
+/**
+ * runtime_unlock
+ *
+ * Libera el lock tomado con runtime_lock(). En modo M:N, después de soltarlo
+ * despierta a los workers ociosos que hayan quedado avisados dentro de la
+ * sección. Luego cierra la sección crítica y, si la alarma llegó dentro de
+ * ella, cambia de hilo aquí.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+void runtime_unlock(void) {
+    atomic_signal_fence(memory_order_seq_cst);
+    runtime_lock_tomado = 0;
+    if (modo_mn) {
+        spin_liberar(&runtime_spin);
+        if (avisos_pendientes) {
+            mn_enviar_avisos();     // despertar workers ya sin el lock
+        }
+    }
+    if (--desalojo_suspendido == 0 && desalojo_pendiente) {
+        desalojo_suspendido = 1;
+        desalojo_reanudar();     // la alarma llegó dentro de la sección
+    }
+}
+
+
+/**
+ * worker_cola
+ *
+ * Réplica local, en el worker, del scheduler de un hilo. La crea la primera
+ * vez que hace falta; el llamador debe tener el lock del worker. Sin réplica
+ * el hilo no tendría dónde quedar listo, así que un fallo aborta.
+ *
+ * Entradas:
+ *   Worker *w – worker dueño de la cola.
+ *   Scheduler *sched – scheduler original (hilo->scheduler).
+ *
+ * Retorna:
+ *   Scheduler* – réplica de sched en la cola local de w.
+ */
+static Scheduler *worker_cola(Worker *w, Scheduler *sched) {
+    int i = scheduler_indice(sched);
+    if (i < 0) {
+        fprintf(stderr, "M:N: scheduler no registrado (máximo %d)\n", MAX_SCHEDULERS);
+        abort();
+    }
+    if (w->colas[i] == NULL) {
+        w->colas[i] = sched->replicar(sched);
+        if (w->colas[i] == NULL) {
+            fprintf(stderr, "M:N: sin memoria para la cola local del worker %d\n", w->id);
+            abort();
+        }
+    }
+    return w->colas[i];
+}
+
+
+/**
+ * worker_politica
+ *
+ * Aplica una operación de la política (encolar_hilo o actualizar_hilo) sobre
+ * la réplica de un worker, con su lock tomado. Si el worker no es el que
+ * llama, la política compara con el hilo que ejecuta ese worker en vez de
+ * con hilo_actual y, si decide desalojarlo, se le avisa con su alarma
+ * (mn_desalojo_pedir).
+ *
+ * Entradas:
+ *   Worker *w – worker dueño de la cola.
+ *   Scheduler *cola – réplica del scheduler del hilo en w.
+ *   TCB *hilo – hilo a encolar o reubicar.
+ *   void (*operacion)(Scheduler*, TCB*) – operación de la política.
+ *
+ * Retorna:
+ *   void
+ */
+static void worker_politica(Worker *w, Scheduler *cola, TCB *hilo,
+                            void (*operacion)(Scheduler*, TCB*)) {
+    if (w == worker_actual) {
+        operacion(cola, hilo);
+        return;
+    }
+    encolando_ajena = 1;
+    ajena_actual    = atomic_load(&w->ejecutando);
+    ajena_desaloja  = 0;
+    operacion(cola, hilo);
+    encolando_ajena = 0;
+    if (ajena_desaloja) {
+        mn_desalojo_pedir(w);
+    }
+}
+
+
+/**
+ * worker_push
+ *
+ * Encola un hilo en la cola local de un worker, en la réplica de su
+ * scheduler: la política decide dónde queda.
+ *
+ * Entradas:
+ *   Worker *w – worker dueño de la cola.
+ *   TCB *hilo – hilo READY a encolar.
+ *
+ * Retorna:
+ *   void
+ */
+static void worker_push(Worker *w, TCB *hilo) {
+    desalojo_suspender();
+    spin_adquirir(&w->lock);
+    Scheduler *cola = worker_cola(w, hilo->scheduler);
+    worker_politica(w, cola, hilo, cola->encolar_hilo);
+    hilo->cola_worker = w->id;
+    w->largo++;
+    spin_liberar(&w->lock);
+    desalojo_reanudar();
+}
+
+
+/**
+ * worker_elegir
+ *
+ * Saca de la cola local de un worker el hilo que elige la política: primero
+ * en la réplica del scheduler preferido y, si ahí no hay, en las demás.
+ *
+ * Entradas:
+ *   Worker *w – worker dueño de la cola.
+ *   int preferido – índice del scheduler que se consulta primero.
+ *
+ * Retorna:
+ *   TCB* – hilo elegido o NULL si la cola estaba vacía.
+ */
+static TCB *worker_elegir(Worker *w, int preferido) {
+    if (atomic_load_explicit(&w->largo, memory_order_relaxed) == 0) {
+        return NULL;
+    }
+    TCB *hilo = NULL;
+    desalojo_suspender();
+    spin_adquirir(&w->lock);
+    for (int k = -1; k < MAX_SCHEDULERS && hilo == NULL; k++) {
+        Scheduler *cola = w->colas[k < 0 ? preferido : k];
+        if (cola != NULL && (k < 0 || k != preferido)) {
+            hilo = cola->siguiente_hilo(cola);
+        }
+    }
+    if (hilo) {
+        hilo->cola_worker = -1;
+        w->largo--;
+    }
+    spin_liberar(&w->lock);
+    desalojo_reanudar();
+    return hilo;
+}
+
+
+/**
+ * worker_pop
+ *
+ * Saca de la cola local de un worker el siguiente hilo a ejecutar.
+ *
+ * Entradas:
+ *   Worker *w – worker dueño de la cola.
+ *
+ * Retorna:
+ *   TCB* – hilo extraído o NULL si la cola estaba vacía.
+ */
+static TCB *worker_pop(Worker *w) {
+    return worker_elegir(w, w->preferido);
+}
+
+
+/**
+ * worker_robar
+ *
+ * Busca en los demás workers uno con trabajo y le roba un hilo: el que
+ * elegiría la política de la víctima, así que con EDF o RMS se roba el de
+ * deadline más cercano o más prioridad, no el primero en la cola.
+ *
+ * Entradas:
+ *   Worker *w – worker que se quedó sin trabajo.
+ *
+ * Retorna:
+ *   TCB* – hilo robado o NULL si ningún worker tenía hilos en cola.
+ */
+static TCB *worker_robar(Worker *w) {
+    for (int i = 1; i < worker_count; i++) {
+        TCB *hilo = worker_elegir(&workers[(w->id + i) % worker_count], w->preferido);
+        if (hilo != NULL) {
+            return hilo;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * mn_cola_tomar
+ *
+ * Toma el lock del worker en cuya cola local está encolado un hilo. Como el
+ * hilo puede cambiar de cola mientras se espera el lock, se comprueba
+ * cola_worker ya con el lock tomado y se reintenta si cambió.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a buscar.
+ *
+ * Retorna:
+ *   Worker* – worker con el lock tomado, o NULL si el hilo no está encolado.
+ */
+static Worker *mn_cola_tomar(TCB *hilo) {
+    for (;;) {
+        int id = hilo->cola_worker;
+        if (id < 0 || id >= worker_count) {
+            return NULL;
+        }
+        Worker *w = &workers[id];
+        spin_adquirir(&w->lock);
+        if (hilo->cola_worker == id) {
+            return w;
+        }
+        spin_liberar(&w->lock);
+    }
+}
+
+
+/**
+ * mn_sacar
+ *
+ * Saca un hilo READY de la cola local donde esté, dejando tomado el lock de
+ * ese worker para que el llamador lo cambie (de scheduler o de prioridad) y
+ * lo devuelva con mn_devolver. El llamador debe tener el desalojo suspendido.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a sacar.
+ *
+ * Retorna:
+ *   int – id del worker cuyo lock quedó tomado, o -1 si el hilo no estaba encolado.
+ */
+static int mn_sacar(TCB *hilo) {
+    Worker *w = mn_cola_tomar(hilo);
+    if (w == NULL) {
+        return -1;
+    }
+    Scheduler *cola = worker_cola(w, hilo->scheduler);
+    cola->remover_hilo(cola, hilo);
+    hilo->cola_worker = -1;
+    w->largo--;
+    return w->id;
+}
+
+
+/**
+ * mn_devolver
+ *
+ * Encola de nuevo en el mismo worker un hilo sacado con mn_sacar (en la
+ * réplica de su scheduler actual) y suelta el lock de ese worker.
+ *
+ * Entradas:
+ *   int id – worker retornado por mn_sacar.
+ *   TCB *hilo – hilo a devolver.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_devolver(int id, TCB *hilo) {
+    Worker *w = &workers[id];
+    Scheduler *cola = worker_cola(w, hilo->scheduler);
+    worker_politica(w, cola, hilo, cola->encolar_hilo);
+    hilo->cola_worker = id;
+    w->largo++;
+    spin_liberar(&w->lock);
+}
+
+
+/**
+ * mn_actualizar
+ *
+ * Versión M:N de actualizar_hilo: reubica un hilo encolado (cambiaron sus
+ * tickets o su deadline) dentro de la réplica del worker donde esté.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo cuyos pesos cambiaron.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_actualizar(TCB *hilo) {
+    Worker *w = mn_cola_tomar(hilo);
+    if (w == NULL) {
+        return;
+    }
+    Scheduler *cola = worker_cola(w, hilo->scheduler);
+    worker_politica(w, cola, hilo, cola->actualizar_hilo);
+    spin_liberar(&w->lock);
+}
+
+
+/**
+ * mn_hay_trabajo
+ *
+ * Indica si algún worker tiene hilos en su cola local.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 1 si hay al menos un hilo encolado.
+ */
+static int mn_hay_trabajo(void) {
+    for (int i = 0; i < worker_count; i++) {
+        if (atomic_load(&workers[i].largo) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * mn_hay_esperas
+ *
+ * Indica si hay hilos dormidos en la rueda o esperando E/S, es decir, si
+ * algún worker ocioso debe quedarse esperando esos eventos.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 1 si hay hilos dormidos o esperando un fd.
+ */
+static int mn_hay_esperas(void) {
+    return atomic_load_explicit(&hilos_durmiendo, memory_order_relaxed) > 0 ||
+           atomic_load_explicit(&hilos_esperando_es, memory_order_relaxed) > 0;
+}
+
+
+/**
+ * mn_avisar_sondeador
+ *
+ * Despierta al worker que espera en epoll escribiendo en el eventfd.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_avisar_sondeador(void) {
+    uint64_t uno = 1;
+    ssize_t escritos = write(es_aviso_fd, &uno, sizeof uno);
+    (void)escritos;
+}
+
+
+/**
+ * mn_enviar_avisos
+ *
+ * Despierta a los workers anotados en avisos_pendientes. Se hace con
+ * runtime_lock libre: el worker despertado puede quitarle el CPU al que avisa
+ * y, si este tuviera el lock, se quedaría girando en él todo su turno.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_enviar_avisos(void) {
+    int avisos = avisos_pendientes;
+    avisos_pendientes = 0;
+    if (avisos & AVISO_OCIOSO) {
+        pthread_mutex_lock(&ocio_mutex);
+        pthread_cond_signal(&ocio_cond);
+        pthread_mutex_unlock(&ocio_mutex);
+    }
+    if (avisos & AVISO_SONDEADOR) {
+        mn_avisar_sondeador();
+    }
+}
+
+
+/**
+ * mn_avisar_trabajo
+ *
+ * Se llama después de encolar un hilo: despierta a un worker dormido en
+ * ocio_cond o, si no hay ninguno, al que espera en epoll (al soltar
+ * runtime_lock si está tomado). El encolado y la
+ * consulta de workers_ociosos son atómicos secuenciales, igual que el
+ * anuncio y la revisión de colas en mn_esperar_trabajo, así que al menos uno
+ * de los dos lados ve al otro y ningún hilo queda encolado con todos los
+ * workers dormidos.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_avisar_trabajo(void) {
+    if (atomic_load(&workers_ociosos) > 0) {
+        avisos_pendientes |= AVISO_OCIOSO;
+    } else if (atomic_load(&hay_sondeador)) {
+        avisos_pendientes |= AVISO_SONDEADOR;
+    }
+    if (!runtime_lock_tomado) {
+        mn_enviar_avisos();
+    }
+}
+
+
+/**
+ * mn_nueva_espera
+ *
+ * Se llama (con runtime_lock) cuando un hilo empieza a dormir o a esperar un
+ * fd. Si ningún worker espera eventos despierta a uno ocioso para que lo
+ * haga; si ya hay uno y el nuevo despertar llega antes del que tenía
+ * programado, lo avisa para que acorte su espera. Un fd nuevo no necesita
+ * aviso: epoll_wait lo ve aunque se registre durante la espera. Los avisos
+ * salen en runtime_unlock (mn_enviar_avisos).
+ *
+ * Entradas:
+ *   long long despertar_ms – instante en que vence la espera, -1 si no tiene.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_nueva_espera(long long despertar_ms) {
+    if (atomic_load(&hay_sondeador)) {
+        if (despertar_ms >= 0 && (sondeo_hasta_ms < 0 || despertar_ms < sondeo_hasta_ms)) {
+            avisos_pendientes |= AVISO_SONDEADOR;
+        }
+    } else if (atomic_load(&workers_ociosos) > 0) {
+        avisos_pendientes |= AVISO_OCIOSO;
+    }
+}
+
+
+/**
+ * mn_despertar_todos
+ *
+ * Despierta a todos los workers ociosos (al terminar el runtime).
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_despertar_todos(void) {
+    pthread_mutex_lock(&ocio_mutex);
+    pthread_cond_broadcast(&ocio_cond);
+    pthread_mutex_unlock(&ocio_mutex);
+    if (es_aviso_fd >= 0) {
+        mn_avisar_sondeador();
+    }
+}
+
+
+/**
+ * mn_sondear_ocioso
+ *
+ * Espera de un worker ocioso que tomó el papel de sondeador: bloquea el
+ * kernel thread en epoll_wait hasta el próximo despertar de la rueda, un fd
+ * listo o un aviso (trabajo nuevo, un despertar más cercano o el fin del
+ * runtime), y luego despierta con runtime_lock lo que corresponda. El
+ * epoll_wait es solo para esperar: los eventos, que siguen pendientes, los
+ * atiende es_sondear. Si siguen quedando esperas, despierta a otro worker
+ * ocioso para que tome el relevo mientras este ejecuta lo que despertó.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_sondear_ocioso(void) {
+    if (mn_hay_trabajo() || threadpool_alive_count() == 0) {
+        atomic_store(&hay_sondeador, 0);
+        return;
+    }
+    runtime_lock();
+    long long proximo = temporizador_proximo();
+    sondeo_hasta_ms   = proximo;
+    runtime_unlock();
+
+    int timeout = -1;
+    if (proximo >= 0) {
+        long long falta = proximo - reloj_ms();
+        timeout = falta > 0 ? (int)falta : 0;
+    }
+    struct epoll_event eventos[16];
+    epoll_wait(es_epoll_fd, eventos, 16, timeout);
+    es_vaciar_aviso();
+
+    runtime_lock();
+    atomic_store(&hay_sondeador, 0);
+    sondeo_hasta_ms = -1;
+    temporizador_avanzar();
+    es_sondear(0);
+    runtime_unlock();
+    if (mn_hay_esperas() && atomic_load(&workers_ociosos) > 0) {
+        avisos_pendientes |= AVISO_OCIOSO;   // otro ocioso toma el relevo de la espera
+        mn_enviar_avisos();
+    }
+}
+
+
+/**
+ * mn_esperar_trabajo
+ *
+ * Estaciona a un worker que no encontró hilos que ejecutar, sin consumir CPU.
+ * Si hay hilos dormidos o esperando E/S y nadie los vigila, el worker se
+ * vuelve el sondeador (mn_sondear_ocioso); si no, duerme en ocio_cond hasta
+ * que haya trabajo en alguna cola, haga falta un sondeador o termine el
+ * runtime.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void – al volver, el worker debe revisar de nuevo las colas.
+ */
+static void mn_esperar_trabajo(void) {
+    int libre = 0;
+    if (mn_hay_esperas() && atomic_compare_exchange_strong(&hay_sondeador, &libre, 1)) {
+        mn_sondear_ocioso();
+        return;
+    }
+    pthread_mutex_lock(&ocio_mutex);
+    atomic_fetch_add(&workers_ociosos, 1);
+    while (!mn_hay_trabajo() && threadpool_alive_count() > 0 &&
+           !(mn_hay_esperas() && !atomic_load(&hay_sondeador))) {
+        pthread_cond_wait(&ocio_cond, &ocio_mutex);
+    }
+    atomic_fetch_sub(&workers_ociosos, 1);
+    pthread_mutex_unlock(&ocio_mutex);
+}
+
+
+/**
+ * mn_encolar
+ *
+ * Encola un hilo READY en modo M:N: en la cola local del worker actual, o
+ * repartido entre los workers si se llama desde fuera de ellos (por ejemplo
+ * desde main antes de arrancar). Si el worker ya tenía otro hilo esperando
+ * (o se encola desde fuera), despierta a un worker ocioso para que lo robe;
+ * un único hilo en cola lo ejecuta el propio worker en cuanto el actual ceda,
+ * sin pasarlo a otro kernel thread. El hilo que se está ejecutando no se
+ * encola aquí: su worker lo encola después de haber guardado su contexto.
+ *
+ * Entradas:
+ *   TCB *hilo – hilo a encolar.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_encolar(TCB *hilo) {
+    if (hilo->state != READY) {
+        cambiar_estado(hilo, READY);
+    }
+    if (hilo == hilo_actual) {
+        return;
+    }
+    Worker *w = worker_actual;
+    if (w == NULL) {
+        unsigned i = atomic_fetch_add_explicit(&worker_siguiente, 1, memory_order_relaxed);
+        w = &workers[i % (unsigned)worker_count];
+    }
+    worker_push(w, hilo);
+    if (worker_actual == NULL || atomic_load(&w->largo) > 1) {
+        mn_avisar_trabajo();     // el worker no lo atenderá enseguida
+    }
+}
+
+
+/**
+ * mn_schedule
+ *
+ * Versión de schedule() para el modo M:N: guarda el contexto del hilo actual
+ * y vuelve al lazo de su worker, que lo reencola si sigue listo. Como en
+ * schedule(), el nivel de desalojo_suspendido del hilo se guarda en este
+ * marco (sin el de runtime_lock, que suelta el worker) y mientras tanto rige
+ * el del lazo; al retomar, quizá en otro worker, se restaura y, si la alarma
+ * llegó durante el cambio y el hilo no está en una sección crítica, vuelve a
+ * ceder la CPU.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void – retorna cuando algún worker vuelve a elegir al hilo.
+ */
+static void mn_schedule(void) {
+    TCB *prev = hilo_actual;
+    int nivel = desalojo_suspendido;
+    if (runtime_lock_tomado) {
+        nivel--;                 // el lock lo suelta el worker (mn_despues_de_cambio)
+    }
+    for (;;) {
+        desalojo_suspendido = runtime_lock_tomado ? 2 : 1;   // nivel del lazo del worker
+        atomic_signal_fence(memory_order_seq_cst);
+        cambiar_contexto(prev, &worker_actual->ctx);
+        atomic_signal_fence(memory_order_seq_cst);
+        desalojo_suspendido = nivel;
+        if (nivel > 0 || !desalojo_pendiente || prev->state != RUNNING) {
+            break;
+        }
+        desalojo_pendiente = 0;
+    }
+}
+
+
+/**
+ * mn_despues_de_cambio
+ *
+ * Lo ejecuta el worker cuando un hilo le devuelve la CPU. Según el estado en
+ * que quedó el hilo: si sigue listo lo reencola en la cola local (todavía
+ * como hilo_actual, para que la política lo trate como el que cede la CPU:
+ * reembolso de Stride, RMS al frente de su prioridad), si terminó y nadie
+ * espera su retval lo recicla (ya nadie usa su pila). Por último libera el
+ * lock del runtime si el hilo lo dejó tomado.
+ *
+ * Entradas:
+ *   Worker *w – worker que retomó la CPU.
+ *   TCB *prev – hilo que acaba de ceder la CPU.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_despues_de_cambio(Worker *w, TCB *prev) {
+    switch (prev->state) {
+        case RUNNING:
+        case READY:
+            worker_push(w, prev);
+            hilo_actual = NULL;
+            if (atomic_load(&w->largo) > 1) {
+                mn_avisar_trabajo();     // hay cola: que un worker ocioso ayude
+            }
+            break;
+        case TERMINATED:
+            hilo_actual = NULL;
+            if (!runtime_lock_tomado) {
+                runtime_lock();
+            }
+            if (hilo_reciclable(prev)) {
+                desregistrar_hilo(&global_thread_pool, prev);
+                tcb_pool_devolver(prev);
+            }
+            break;
+        case BLOCKED:
+            hilo_actual = NULL;
+            break;
+    }
+    if (runtime_lock_tomado) {
+        runtime_unlock();
+    }
+}
+
+
+/**
+ * mn_atender_eventos
+ *
+ * Lo ejecuta el lazo de cada worker antes de elegir un hilo: despierta los
+ * hilos dormidos solo si rueda_proximo_ms ya pasó y, si ningún worker ocioso
+ * espera en epoll, sondea los fds a lo sumo una vez por milisegundo entre
+ * todos los workers. Así un worker ocupado no toma runtime_lock en cada
+ * cambio de hilo.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_atender_eventos(void) {
+    long long ahora   = reloj_ms();
+    long long proximo = atomic_load_explicit(&rueda_proximo_ms, memory_order_relaxed);
+    int rueda = proximo >= 0 && proximo <= ahora;
+    int es    = 0;
+    if (atomic_load_explicit(&hilos_esperando_es, memory_order_relaxed) > 0 &&
+        !atomic_load(&hay_sondeador)) {
+        long long ultimo = atomic_load_explicit(&es_sondeo_ms, memory_order_relaxed);
+        es = ultimo < ahora && atomic_compare_exchange_strong(&es_sondeo_ms, &ultimo, ahora);
+    }
+    if (!rueda && !es) {
+        return;
+    }
+    runtime_lock();
+    if (rueda) {
+        temporizador_avanzar();
+    }
+    if (es) {
+        es_sondear(0);
+    }
+    runtime_unlock();
+}
+
+
+/**
+ * mn_alarma_programar
+ *
+ * Arma la alarma del worker para que llegue una sola vez en el instante
+ * vence_ns (CLOCK_MONOTONIC). Se puede llamar desde mn_alarma.
+ *
+ * Entradas:
+ *   Worker *w – worker dueño de la alarma.
+ *   long long vence_ns – instante de la alarma en nanosegundos.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_alarma_programar(Worker *w, long long vence_ns) {
+    struct itimerspec its = {
+        .it_interval = { 0, 0 },
+        .it_value    = { .tv_sec  = vence_ns / 1000000000LL,
+                         .tv_nsec = vence_ns % 1000000000LL }
+    };
+    w->alarma_vence_ns = vence_ns;
+    w->alarma_armada   = 1;
+    timer_settime(w->alarma, TIMER_ABSTIME, &its, NULL);
+}
+
+
+/**
+ * mn_desalojo_pedir
+ *
+ * Lo llama otro kernel thread que encoló en w un hilo que desaloja al que
+ * ejecuta w: anota el pedido y adelanta la alarma de w para que llegue ya
+ * (mn_alarma la atiende y la reprograma). Si el aviso se cruza con un cambio
+ * de hilo en w, el nuevo hilo ya se eligió contra esa cola y no hace falta.
+ *
+ * Entradas:
+ *   Worker *w – worker a desalojar.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_desalojo_pedir(Worker *w) {
+    atomic_store(&w->desalojo_pedido, 1);
+    if (w->alarma_lista) {
+        struct itimerspec ya = { .it_interval = { 0, 0 }, .it_value = { 0, 1 } };
+        timer_settime(w->alarma, 0, &ya, NULL);
+    }
+}
+
+
+/**
+ * mn_limite
+ *
+ * Versión de desalojo_limite para un worker: fin del quantum de su hilo o
+ * próximo despertar que puede desalojarlo, el que llegue antes.
+ *
+ * Entradas:
+ *   Worker *w – worker a consultar.
+ *
+ * Retorna:
+ *   long long – instante en nanosegundos, o 0 si su hilo no tiene límite.
+ */
+static long long mn_limite(Worker *w) {
+    if (w->quantum_fin_ns == 0 || (w->evento_ns != 0 && w->evento_ns < w->quantum_fin_ns)) {
+        return w->evento_ns;
+    }
+    return w->quantum_fin_ns;
+}
+
+
+/**
+ * mn_despachar
+ *
+ * Versión de quantum_despachar para un worker: anota el quantum del hilo que
+ * va a ejecutar y, si su scheduler desaloja al despertar, el próximo
+ * despertar de la rueda; reprograma la alarma solo si no estaba armada o
+ * llegaría tarde.
+ *
+ * Entradas:
+ *   Worker *w – worker que despacha.
+ *   TCB *hilo – hilo que va a ejecutarse.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_despachar(Worker *w, TCB *hilo) {
+    if (!w->alarma_lista) {
+        return;
+    }
+    long quantum = quantum_de(hilo);
+    long long proximo = atomic_load_explicit(&rueda_proximo_ms, memory_order_relaxed);
+    w->quantum_fin_ns = quantum > 0 ? reloj_ns() + quantum * 1000LL : 0;
+    w->evento_ns      = 0;
+    if (hilo->scheduler && hilo->scheduler->desaloja_al_despertar && proximo >= 0) {
+        w->evento_ns = proximo * 1000000LL;
+    }
+    long long limite = mn_limite(w);
+    if (limite != 0 && (!w->alarma_armada || w->alarma_vence_ns > limite)) {
+        mn_alarma_programar(w, limite);
+    }
+}
+
+
+/**
+ * mn_alarma
+ *
+ * Versión de alarm_handler para el modo M:N. Cada worker tiene su propia
+ * alarma y solo atiende la suya (la señal trae el Worker en sival_ptr). Una
+ * que llega antes del límite del hilo actual se reprograma; si venció el
+ * quantum pero la cola local está vacía, el hilo sigue con un quantum nuevo
+ * (reencolarlo lo volvería a elegir a él). Un pedido de otro worker
+ * (mn_desalojo_pedir) desaloja como un despertar vencido. Si la alarma interrumpe una
+ * sección crítica o una función de biblioteca, el desalojo queda pendiente y
+ * se reintenta en REINTENTO_DESALOJO_US; si no, cede la CPU al worker.
+ *
+ * Entradas:
+ *   siginfo_t *info – origen de la señal.
+ *   void *contexto – registros del código interrumpido.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_alarma(siginfo_t *info, void *contexto) {
+    Worker *w = worker_actual;
+    if (w == NULL || info->si_code != SI_TIMER || info->si_value.sival_ptr != w) {
+        return;                      // no es la alarma de este worker
+    }
+    w->alarma_armada = 0;
+    int pedido  = atomic_exchange(&w->desalojo_pedido, 0);
+    TCB *actual = hilo_actual;
+    if (actual == NULL) {
+        return;                      // el lazo del worker despacha y la rearma
+    }
+    long long ahora  = reloj_ns();
+    long long limite = mn_limite(w);
+    if (limite == 0 && !pedido) {
+        return;
+    }
+    if (ahora < limite && !pedido) {
+        mn_alarma_programar(w, limite);
+        return;
+    }
+    int por_evento = pedido || (w->evento_ns != 0 && ahora >= w->evento_ns);
+    if (!por_evento && atomic_load_explicit(&w->largo, memory_order_relaxed) == 0) {
+        w->quantum_fin_ns = ahora + quantum_de(actual) * 1000LL;
+        mn_alarma_programar(w, mn_limite(w));
+        return;
+    }
+    if (desalojo_suspendido > 0 || interrumpio_biblioteca(contexto)) {
+        desalojo_pendiente = 1;
+        desalojos_aplazados_total++;
+        mn_alarma_programar(w, ahora + REINTENTO_DESALOJO_US * 1000LL);
+        return;
+    }
+#ifdef MY_PTHREAD_ASM_SWITCH
+    alarma_bloqueada = 1;
+#endif
+    schedule();
+#ifdef MY_PTHREAD_ASM_SWITCH
+    alarma_bloqueada = 0;
+#endif
+}
+
+
+/**
+ * mn_alarma_crear
+ *
+ * Crea la alarma del worker: un temporizador de CLOCK_MONOTONIC cuya SIGALRM
+ * se entrega solo al kernel thread que llama (SIGEV_THREAD_ID), con el
+ * Worker en sival_ptr. Si no se puede, el worker funciona sin desalojo por
+ * tiempo, como antes.
+ *
+ * Entradas:
+ *   Worker *w – worker del kernel thread que llama.
+ *
+ * Retorna:
+ *   void
+ */
+static void mn_alarma_crear(Worker *w) {
+    if (!quantum_timer_listo) {
+        return;                      // sin manejador de SIGALRM
+    }
+    struct sigevent sev;
+    memset(&sev, 0, sizeof sev);
+    sev.sigev_notify           = SIGEV_THREAD_ID;
+    sev.sigev_signo            = SIGALRM;
+    sev.sigev_value.sival_ptr  = w;
+    sev.sigev_notify_thread_id = gettid();
+    w->alarma_lista = timer_create(CLOCK_MONOTONIC, &sev, &w->alarma) == 0;
+    if (!w->alarma_lista) {
+        perror("timer_create");
+    }
+}
+
+
+/**
+ * mn_lazo_worker
+ *
+ * Lazo principal de un worker: despierta los hilos dormidos vencidos y los que
+ * esperaban un fd ya listo (mn_atender_eventos), toma de su cola local el hilo
+ * que elige la política (o lo roba de otro worker), le arma la alarma, lo
+ * ejecuta hasta que cede la CPU o la alarma lo desaloja, y repite. El lazo
+ * corre con el desalojo suspendido. Sin trabajo disponible se estaciona sin
+ * consumir CPU (mn_esperar_trabajo) hasta que haya hilos listos; termina,
+ * despertando a los demás, cuando ya no quedan hilos vivos.
+ *
+ * Entradas:
+ *   void *arg – puntero al Worker.
+ *
+ * Retorna:
+ *   void* – siempre NULL.
+ */
+static void *mn_lazo_worker(void *arg) {
+    Worker *w = arg;
+    worker_actual       = w;
+    desalojo_suspendido = 1;
+    mn_alarma_crear(w);
+
+    while (1) {
+        mn_atender_eventos();
+        atomic_store(&w->desalojo_pedido, 0);
+        TCB *hilo = worker_pop(w);
+        if (hilo == NULL) {
+            hilo = worker_robar(w);
+        }
+        if (hilo == NULL) {
+            if (threadpool_alive_count() == 0) {
+                mn_despertar_todos();
+                break;
+            }
+            mn_esperar_trabajo();
+            continue;
+        }
+        int i = scheduler_indice(hilo->scheduler);
+        if (i >= 0) {
+            w->preferido = i;
+        }
+        cambiar_estado(hilo, RUNNING);
+        mn_despachar(w, hilo);
+        desalojo_pendiente = 0;
+        hilo_actual = hilo;
+        atomic_store(&w->ejecutando, hilo);
+        cambiar_contexto(&w->ctx, hilo);
+        atomic_store(&w->ejecutando, NULL);
+        mn_despues_de_cambio(w, hilo);
+    }
+    if (w->alarma_lista) {
+        timer_delete(w->alarma);
+        w->alarma_lista = 0;
+    }
+    desalojo_suspendido = 0;
+    desalojo_pendiente  = 0;
+    worker_actual       = NULL;
+    return NULL;
+}
+
+
+/**
+ * mn_runtime_iniciar
+ *
+ * Activa el modo M:N con n_workers kernel threads. Debe llamarse desde main
+ * antes de crear los hilos; a partir de aquí my_thread_create, yield, join,
+ * end y los my_mutex reparten los hilos entre los workers. Cada worker
+ * encola los hilos en réplicas locales de sus schedulers, así que la
+ * política (quantum, tickets, deadline, prioridad) se respeta dentro de cada
+ * worker, y desaloja al hilo en ejecución con su propia alarma.
+ *
+ * Entradas:
+ *   int n_workers – cantidad de kernel threads (mínimo 1).
+ *
+ * Retorna:
+ *   int – 0 si se inicializó, -1 si n_workers no es válido o falta memoria.
+ */
+int mn_runtime_iniciar(int n_workers) {
+    if (n_workers < 1 || modo_mn) {
+        return -1;
+    }
+    workers = calloc((size_t)n_workers, sizeof(Worker));
+    if (workers == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < n_workers; i++) {
+        workers[i].id = i;
+        atomic_flag_clear(&workers[i].lock);
+    }
+    worker_count = n_workers;
+    modo_mn = 1;
+    return 0;
+}
+
+
+/**
+ * mn_runtime_ejecutar
+ *
+ * Arranca los workers 1..n-1 en kernel threads nuevos y usa el hilo que llama
+ * (normalmente main) como worker 0. Antes crea el epoll y el eventfd con que
+ * esperan los workers ociosos, instala el manejador de SIGALRM y desarma la
+ * alarma global del modo 1:1 (cada worker arma la suya). Retorna cuando
+ * todos los hilos verdes terminaron y los workers se unieron.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 0 si terminó bien, -1 si no se llamó antes mn_runtime_iniciar o no
+ *         se pudo crear el epoll o algún kernel thread.
+ */
+int mn_runtime_ejecutar(void) {
+    if (!modo_mn || es_iniciar() != 0) {
+        return -1;
+    }
+    if (preemption_instalar() == 0 && quantum_armado) {
+        struct itimerspec cero = { { 0, 0 }, { 0, 0 } };
+        timer_settime(quantum_timer, 0, &cero, NULL);
+        quantum_armado = 0;
+    }
+    int creados = 1;
+    for (; creados < worker_count; creados++) {
+        if (pthread_create(&workers[creados].kthread, NULL,
+                           mn_lazo_worker, &workers[creados]) != 0) {
+            break;
+        }
+    }
+    mn_lazo_worker(&workers[0]);
+    for (int i = 1; i < creados; i++) {
+        pthread_join(workers[i].kthread, NULL);
+    }
+    return creados == worker_count ? 0 : -1;
 }
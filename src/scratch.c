@@ -0,0 +1,115 @@
+#include "../include/scratch.h"
+#include "../include/my_pthread.h"
+#include <stdlib.h>
+
+
+/**
+ * RotateScratch
+ *
+ * Buffer de trabajo de rotate_ascii para la copia rellenada de la forma. Cada
+ * hilo tiene el suyo (clave TLS scratch_key), así se reutiliza entre pasos sin
+ * locks y se libera solo cuando el hilo termina.
+ *
+ * Campos:
+ *   char **filas:
+ *     – punteros al inicio de cada fila dentro de datos.
+ *   char *datos:
+ *     – filas contiguas de ancho + 1 bytes.
+ *   size_t capacidad, int filas_cap:
+ *     – bytes reservados en datos y punteros reservados en filas.
+ */
+typedef struct {
+    char  **filas;
+    char   *datos;
+    size_t  capacidad;
+    int     filas_cap;
+} RotateScratch;
+
+static my_thread_key_t scratch_key;
+
+
+/**
+ * free_scratch
+ *
+ * Destructor de scratch_key: libera el RotateScratch de un hilo que terminó.
+ *
+ * Entradas:
+ *   p – puntero al RotateScratch del hilo.
+ *
+ * Retorna:
+ *   void
+ */
+static void free_scratch(void *p) {
+    RotateScratch *s = p;
+    free(s->filas);
+    free(s->datos);
+    free(s);
+}
+
+
+/**
+ * scratch_init
+ *
+ * Crea la clave TLS con que cada hilo guarda su RotateScratch. Se llama una
+ * vez desde main, antes de crear los hilos que rotan formas.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   int – 0 si se creó la clave, -1 si no quedan claves.
+ */
+int scratch_init(void) {
+    return my_thread_key_create(&scratch_key, free_scratch);
+}
+
+
+/**
+ * scratch_grid
+ *
+ * Retorna una matriz de height filas de width + 1 bytes tomada del buffer de
+ * trabajo del hilo actual, agrandándolo si hace falta. Solo es válida hasta
+ * la siguiente llamada del mismo hilo. Si no se puede agrandar, el buffer
+ * anterior queda intacto (y con su capacidad) para las próximas llamadas.
+ *
+ * Entradas:
+ *   height – cantidad de filas.
+ *   width  – ancho de cada fila sin contar el '\0'.
+ *
+ * Retorna:
+ *   char** – filas del buffer de trabajo, o NULL si no hay memoria.
+ */
+char **scratch_grid(int height, int width) {
+    RotateScratch *s = my_thread_getspecific(scratch_key);
+    if (s == NULL) {
+        s = calloc(1, sizeof *s);
+        if (s == NULL) {
+            return NULL;
+        }
+        if (my_thread_setspecific(scratch_key, s) != 0) {
+            free(s);
+            return NULL;
+        }
+    }
+    size_t bytes = (size_t)height * (size_t)(width + 1);
+    if (bytes > s->capacidad) {
+        char *datos = realloc(s->datos, bytes);
+        if (datos == NULL) {
+            return NULL;
+        }
+        s->datos     = datos;
+        s->capacidad = bytes;
+    }
+    if (height > s->filas_cap) {
+        char **filas = realloc(s->filas, sizeof(char*) * height);
+        if (filas == NULL) {
+            return NULL;
+        }
+        s->filas     = filas;
+        s->filas_cap = height;
+    }
+    for (int i = 0; i < height; i++) {
+        s->filas[i] = s->datos + (size_t)i * (width + 1);
+    }
+    return s->filas;
+}
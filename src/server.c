@@ -9,30 +9,99 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <sys/time.h>
-#include <x86intrin.h>
 #include <ncurses.h>
 #include "../include/parser.h"
+#include "../include/scratch.h"
 #include "../include/my_pthread.h"
 #ifndef MAX
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #endif
-#define CPU_HZ 2800000000UL
 static int *monitor_socks;
 static int monitor_count;
 Parser *global_cfg;
-static my_mutex canvas_mutex;
+static my_rwlock canvas_lock;         // ocupación del canvas
+static CanvasPosition *occupied_positions;   // celdas ocupadas (bajo canvas_lock)
+static _Atomic unsigned long canvas_version; // cambia con cada movimiento (con canvas_lock exclusivo)
+static my_mutex canvas_mutex;         // solo para esperar cambios con canvas_cond
+static my_cond  canvas_cond;
 static long long global_start_ms;
 static Lottery_Scheduler ls;
 static EDF_Scheduler edf;
 static RR_Scheduler rr;
 static int QUANTUM_MS = 100;
+#define FRAME_MS      50   // período de los cuadros de cada figura
+#define FRAME_WCET_MS 2    // peor costo estimado de un cuadro (control de admisión)
+
+
+/**
+ * send_bytes
+ *
+ * Envía len bytes completos al socket con my_thread_write, reintentando las
+ * escrituras parciales. Si ocurre un error al enviar, imprime el mensaje de
+ * error.
+ *
+ * Entradas:
+ *   sock – descriptor del socket.
+ *   data – bytes a enviar.
+ *   len  – cantidad de bytes.
+ *
+ * Retorna:
+ *   void
+ */
+static void send_bytes(int sock, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t s = my_thread_write(sock, data, len);
+        if (s < 0) {
+            perror("send");
+            return;
+        }
+        data += s;
+        len  -= (size_t)s;
+    }
+}
+
+/**
+ * SalidaMonitor
+ *
+ * Comandos pendientes de enviar a un monitor. Los hilos de las figuras solo
+ * agregan texto aquí (en el orden en que lo deciden con canvas_lock exclusivo)
+ * y luego uno de ellos lo envía por el socket; si el monitor va lento solo se
+ * queda esperando ese hilo y los demás siguen animando.
+ *
+ * Campos:
+ *   char *datos:
+ *     – texto pendiente.
+ *
+ *   size_t largo:
+ *     – bytes pendientes en datos.
+ *
+ *   size_t capacidad:
+ *     – tamaño reservado de datos.
+ *
+ *   int enviando:
+ *     – 1 si algún hilo está enviando al socket en este momento.
+ *
+ *   my_mutex mutex:
+ *     – protege los campos anteriores (nunca se mantiene durante el envío).
+ */
+typedef struct {
+    char    *datos;
+    size_t   largo;
+    size_t   capacidad;
+    int      enviando;
+    my_mutex mutex;
+} SalidaMonitor;
+
+static SalidaMonitor *monitor_salidas;
 
 
 /**
  * send_line
  *
  * Envía una línea de texto completa (terminada en '\n') al socket indicado.
- * Si ocurre un error al enviar, imprime el mensaje de error.
+ * Si el socket no acepta más datos, el hilo actual espera con my_thread_write
+ * sin detener a los demás hilos. Si ocurre un error al enviar, imprime el
+ * mensaje de error.
  *
  * Entradas:
  *   sock – descriptor del socket al que se desea enviar.
@@ -42,21 +111,98 @@ static int QUANTUM_MS = 100;
  *   void
  */
 static void send_line(int sock, const char *line) {
+    send_bytes(sock, line, strlen(line));
+}
+
+
+/**
+ * queue_line
+ *
+ * Agrega una línea a los comandos pendientes del monitor indicado. No hace
+ * E/S; el envío lo hace flush_monitors().
+ *
+ * Entradas:
+ *   monitor – índice del monitor destino.
+ *   line    – línea a agregar (terminada en '\n').
+ *
+ * Retorna:
+ *   void
+ */
+static void queue_line(int monitor, const char *line) {
+    SalidaMonitor *out = &monitor_salidas[monitor];
     size_t len = strlen(line);
-    ssize_t s = send(sock, line, len, 0);
-    if (s < 0) {
-        perror("send");
+
+    my_mutex_lock(&out->mutex);
+    if (out->largo + len > out->capacidad) {
+        size_t nueva = out->capacidad ? out->capacidad * 2 : 4096;
+        while (nueva < out->largo + len) {
+            nueva *= 2;
+        }
+        char *datos = realloc(out->datos, nueva);
+        if (!datos) {
+            my_mutex_unlock(&out->mutex);
+            perror("realloc");
+            return;
+        }
+        out->datos     = datos;
+        out->capacidad = nueva;
+    }
+    memcpy(out->datos + out->largo, line, len);
+    out->largo += len;
+    my_mutex_unlock(&out->mutex);
+}
+
+
+/**
+ * flush_monitors
+ *
+ * Envía los comandos pendientes de cada monitor. Si otro hilo ya está enviando
+ * a un monitor, ese monitor se salta (ese hilo enviará también lo nuevo). El
+ * hilo que envía se lleva el buffer completo, suelta el mutex y escribe con
+ * my_thread_write, así que un monitor lento no detiene a las demás figuras.
+ *
+ * Entradas:
+ *   ninguna
+ *
+ * Retorna:
+ *   void
+ */
+static void flush_monitors(void) {
+    for (int m = 0; m < monitor_count; m++) {
+        SalidaMonitor *out = &monitor_salidas[m];
+
+        my_mutex_lock(&out->mutex);
+        if (out->enviando) {
+            my_mutex_unlock(&out->mutex);
+            continue;
+        }
+        out->enviando = 1;
+        while (out->largo > 0) {
+            char  *datos = out->datos;
+            size_t largo = out->largo;
+            out->datos     = NULL;
+            out->largo     = 0;
+            out->capacidad = 0;
+            my_mutex_unlock(&out->mutex);
+
+            send_bytes(monitor_socks[m], datos, largo);
+            free(datos);
+
+            my_mutex_lock(&out->mutex);
+        }
+        out->enviando = 0;
+        my_mutex_unlock(&out->mutex);
     }
 }
 
 /**
  * send_draw
  *
- * Construye y envía un comando "DRAW" al socket para dibujar un carácter
- * en las coordenadas globales (x, y) con el par de color indicado.
+ * Construye y encola un comando "DRAW" para el monitor indicado, que dibuja un
+ * carácter en las coordenadas globales (x, y) con el par de color indicado.
  *
  * Entradas:
- *   sock       – descriptor del socket donde se enviará el comando.
+ *   monitor    – índice del monitor donde se enviará el comando.
  *   x          – coordenada global en el eje X donde se dibujará.
  *   y          – coordenada global en el eje Y donde se dibujará.
  *   c          – carácter a dibujar en la posición (x, y).
@@ -65,28 +211,28 @@ static void send_line(int sock, const char *line) {
  * Retorna:
  *   void
  */
-static void send_draw(int sock, int x, int y, char c, int color_pair) {
+static void send_draw(int monitor, int x, int y, char c, int color_pair) {
     char buf[48];
 
 
     int n = snprintf(buf, sizeof(buf), "DRAW %d %d %c %d\n", x, y, c, color_pair);
-    send_line(sock, buf);
+    queue_line(monitor, buf);
 }
 
 /**
  * send_refresh
  *
- * Envía el comando "REFRESH" al socket para indicar que la ventana del monitor
+ * Encola el comando "REFRESH" para indicar que la ventana del monitor
  * debe refrescarse y mostrar los cambios acumulados.
  *
  * Entradas:
- *   sock – descriptor del socket al que se enviará el comando.
+ *   monitor – índice del monitor al que se enviará el comando.
  *
  * Retorna:
  *   void
  */
-static void send_refresh(int sock) {
-    send_line(sock, "REFRESH\n");
+static void send_refresh(int monitor) {
+    queue_line(monitor, "REFRESH\n");
 }
 
 
@@ -107,16 +253,19 @@ static void send_refresh(int sock) {
  *   out_w    – puntero a entero donde se guardará el nuevo ancho tras rotar.
  *
  * Retorna:
- *   char** – matriz dinámica de cadenas (cada una terminada en '\0') con la forma rotada.
+ *   char** – matriz dinámica de cadenas (cada una terminada en '\0') con la forma rotada,
+ *            o NULL si no hay memoria para el buffer de trabajo.
  *
  */
 char **rotate_ascii(char **lines, int height, int width,
                     int rotation, int *out_h, int *out_w)
 {
 
-    char **grid = malloc(sizeof(char*) * height);
+    char **grid = scratch_grid(height, width);
+    if (grid == NULL) {
+        return NULL;
+    }
     for (int i = 0; i < height; i++) {
-        grid[i] = malloc(width+1);
         int len = strlen(lines[i]);
         memcpy(grid[i], lines[i], len);
         memset(grid[i] + len, ' ', width - len);
@@ -182,8 +331,6 @@ char **rotate_ascii(char **lines, int height, int width,
     }
 
 
-    for (int i = 0; i < height; i++) free(grid[i]);
-    free(grid);
     return res;
 }
 
@@ -194,7 +341,6 @@ char **rotate_ascii(char **lines, int height, int width,
  * a current_tid o si está fuera de los límites definidos en global_cfg.
  *
  * Entradas:
- *   mutex       – puntero al mutex que contiene la lista enlazada de CanvasPosition.
  *   x           – coordenada global en el eje X.
  *   y           – coordenada global en el eje Y.
  *   current_tid – identificador (tid) del hilo que desea ocupar esa posición.
@@ -203,13 +349,13 @@ char **rotate_ascii(char **lines, int height, int width,
  *   int – 1 si la posición está ocupada (o fuera de rango), 0 si está libre o pertenece
  *         al mismo hilo current_tid.
  */
-static int is_position_occupied(my_mutex *mutex, int x, int y, int current_tid) {
+static int is_position_occupied(int x, int y, int current_tid) {
 
     if (x < 0 || x >= global_cfg->width || y < 0 || y >= global_cfg->height) {
         return 1;
     }
 
-    CanvasPosition *pos = mutex->occupied_positions;
+    CanvasPosition *pos = occupied_positions;
     while (pos) {
         if (pos->x == x && pos->y == y) {
 
@@ -223,11 +369,10 @@ static int is_position_occupied(my_mutex *mutex, int x, int y, int current_tid)
 /**
  * occupy_position
  *
- * Marca la posición global (x, y) como ocupada en el mutex por el hilo identificado
+ * Marca la posición global (x, y) como ocupada por el hilo identificado
  * con owner_tid. Inserta una nueva posición al inicio de la lista de posiciones ocupadas.
  *
  * Entradas:
- *   mutex     – puntero al mutex que contiene la lista de CanvasPosition.
  *   x         – coordenada global en el eje X que se desea marcar.
  *   y         – coordenada global en el eje Y que se desea marcar.
  *   owner_tid – identificador (tid) del hilo que ocupa esa posición.
@@ -235,24 +380,23 @@ static int is_position_occupied(my_mutex *mutex, int x, int y, int current_tid)
  * Retorna:
  *   void
  */
-static void occupy_position(my_mutex *mutex, int x, int y, int owner_tid) {
+static void occupy_position(int x, int y, int owner_tid) {
     CanvasPosition *new_pos = malloc(sizeof(CanvasPosition));
     new_pos->x = x;
     new_pos->y = y;
     new_pos->owner_tid = owner_tid;
-    new_pos->next = mutex->occupied_positions;
-    mutex->occupied_positions = new_pos;
+    new_pos->next = occupied_positions;
+    occupied_positions = new_pos;
 }
 
 
 /**
  * free_position
  *
- * Libera la marca de ocupación de la posición (x, y) para el hilo owner_tid en el mutex.
+ * Libera la marca de ocupación de la posición (x, y) para el hilo owner_tid.
  * Busca en la lista enlazada y remueve el nodo correspondiente.
  *
  * Entradas:
- *   mutex     – puntero al mutex que contiene la lista de CanvasPosition.
  *   x         – coordenada global en el eje X que se desea liberar.
  *   y         – coordenada global en el eje Y que se desea liberar.
  *   owner_tid – identificador (tid) del hilo que liberó esa posición.
@@ -260,8 +404,8 @@ static void occupy_position(my_mutex *mutex, int x, int y, int owner_tid) {
  * Retorna:
  *   void
  */
-static void free_position(my_mutex *mutex, int x, int y, int owner_tid) {
-    CanvasPosition **ptr = &mutex->occupied_positions;
+static void free_position(int x, int y, int owner_tid) {
+    CanvasPosition **ptr = &occupied_positions;
     while (*ptr) {
         if ((*ptr)->x == x && (*ptr)->y == y && (*ptr)->owner_tid == owner_tid) {
             CanvasPosition *to_free = *ptr;
@@ -273,58 +417,86 @@ static void free_position(my_mutex *mutex, int x, int y, int owner_tid) {
     }
 }
 
-
 /**
- * rdtsc_counter
+ * footprint_free
  *
- * Retorna el valor actual del contador de ciclos de la CPU usando la instrucción
- * RDTSC. Este valor se utiliza para medir tiempos de alta resolución.
+ * Verifica si todos los caracteres visibles de una forma rotada caben libres
+ * con su esquina superior izquierda en (x, y). Se llama con canvas_lock
+ * tomado (basta el modo compartido).
  *
  * Entradas:
- *   ninguna
+ *   rotated     – matriz de la forma rotada.
+ *   rot_h       – alto de la matriz.
+ *   rot_w       – ancho de la matriz.
+ *   x           – coordenada global X de la esquina superior izquierda.
+ *   y           – coordenada global Y de la esquina superior izquierda.
+ *   current_tid – tid del hilo que quiere ocupar esas posiciones.
  *
  * Retorna:
- *   uint64_t – valor de lectura del contador de tiempo de CPU.
+ *   int – 1 si todas las posiciones están libres, 0 si alguna está ocupada.
  */
-static inline uint64_t rdtsc_counter(void) {
-    return __rdtsc();
+static int footprint_free(char **rotated, int rot_h, int rot_w,
+                          int x, int y, int current_tid) {
+    for (int row = 0; row < rot_h; row++) {
+        for (int col = 0; col < rot_w; col++) {
+            if (rotated[row][col] != ' ' &&
+                is_position_occupied(x + col, y + row, current_tid)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
 }
 
+/**
+ * notify_canvas_change
+ *
+ * Despierta a las figuras que esperan en canvas_cond a que cambie el canvas.
+ * Se llama después de soltar canvas_lock, con canvas_version ya incrementada.
+ *
+ * Entradas:
+ *   Ninguna.
+ *
+ * Retorna:
+ *   void
+ */
+static void notify_canvas_change(void) {
+    my_mutex_lock(&canvas_mutex);
+    my_cond_broadcast(&canvas_cond);
+    my_mutex_unlock(&canvas_mutex);
+}
 
 /**
- * custom_napms
+ * wait_canvas_change
  *
- * Suspende la ejecución del hilo activo durante aproximadamente 'ms' milisegundos,
- * usando el contador de CPU (RDTSC) para medir el tiempo transcurrido. Internamente,
- * cede el procesamiento cada 5 ms llamando a my_thread_yield() si hay más de un hilo vivo.
+ * Bloquea al hilo hasta que canvas_version deje de valer seen_version (otra
+ * figura se movió o terminó) o hasta llegar a limit_ms.
  *
  * Entradas:
- *   ms – número de milisegundos que se desea dormir el hilo actual.
+ *   seen_version – versión del canvas que vio el hilo al verificar su paso.
+ *   limit_ms     – instante límite en la escala de reloj_ms().
  *
  * Retorna:
  *   void
  */
-void custom_napms(uint64_t ms) {
-    uint64_t start          = rdtsc_counter();
-    uint64_t target         = start + (CPU_HZ / 1000ULL) * ms;
-    uint64_t last_yield_ts  = start;
-    uint64_t yield_interval = (CPU_HZ / 1000ULL) * 5;  // cede cada 5 ms
-
-    while (rdtsc_counter() < target) {
-        uint64_t now = rdtsc_counter();
-        if (now - last_yield_ts >= yield_interval) {
-            last_yield_ts = now;
-            if (threadpool_alive_count() > 1) my_thread_yield();
+static void wait_canvas_change(unsigned long seen_version, long long limit_ms) {
+    my_mutex_lock(&canvas_mutex);
+    while (canvas_version == seen_version) {
+        if (my_cond_timedwait(&canvas_cond, &canvas_mutex, limit_ms) != 0) {
+            break;
         }
-
     }
+    my_mutex_unlock(&canvas_mutex);
 }
 
+
+
+
 /**
  * switch_to_rr
  *
  * Función que cambia el planificador de todos los hilos vivos al Scheduler Round Robin (RR)
- * con quantum de 100 ms. Una vez reasignados, marca el hilo actual como TERMINATED y llama a schedule()
+ * con quantum de 100 ms. Una vez reasignados, termina el hilo actual con my_thread_end()
  * para ceder el control al siguiente hilo disponible.
  *
  * Entradas:
@@ -352,17 +524,16 @@ static void switch_to_rr(void *arg) {
     }
 
 
-    hilo_actual->state = TERMINATED;
-    schedule();
+    my_thread_end();
 }
 
 
 /**
  * switch_to_lottery
  *
- * Función que espera 1500 ms (usando custom_napms), luego cambia el planificador
+ * Función que duerme 1500 ms (con my_thread_sleep), luego cambia el planificador
  * de todos los hilos vivos al Scheduler Lottery con quantum de 100 tickets. Después
- * marca el hilo actual como TERMINATED y llama a schedule() para ceder el control.
+ * termina el hilo actual con my_thread_end() para ceder el control.
  *
  * Entradas:
  *   arg
@@ -373,7 +544,7 @@ static void switch_to_rr(void *arg) {
 static void switch_to_lottery(void *arg) {
     (void)arg;
 
-    custom_napms(1500);
+    my_thread_sleep(1500);
 
     printf("\n>> Cambio a Lottery <<\n");
 
@@ -388,28 +559,38 @@ static void switch_to_lottery(void *arg) {
         }
     }
 
-    hilo_actual->state = TERMINATED;
-    schedule();
+    my_thread_end();
 }
 
 /**
  * animate_shape_server
  *
  * Ejecuta la animación de una forma ASCII en el servidor, enviando comandos a múltiples monitores.
+ * Cada cuadro es un trabajo de una tarea periódica (período FRAME_MS): el runtime
+ * libera el primero en sh->start_time y los siguientes cada FRAME_MS, con deadline
+ * al final de cada período. Si la figura no pasó el control de admisión y se creó
+ * como hilo común, duerme hasta sh->start_time y entre cuadros con my_thread_sleep.
  * La animación:
- *   1) Espera hasta sh->start_time antes de comenzar (usando napms custom).
+ *   1) Espera hasta sh->start_time (liberación del primer cuadro).
  *   2) Calcula la trayectoria lineal desde (x_start, y_start) hasta (x_end, y_end).
  *   3) En cada paso:
  *        - Rota la forma según sh->rotation.
- *        - Verifica con is_position_occupied() si la posición siguiente está libre.
- *        - Si puede moverse:
+ *        - Verifica con footprint_free() si la posición siguiente está libre, con
+ *          canvas_lock en modo compartido para no frenar a las demás figuras.
+ *        - Si puede moverse, toma canvas_lock exclusivo (revalidando si el canvas
+ *          cambió entretanto) y:
  *            a) Libera ocupación y envía comandos DRAW con carácter 'a' (espacio coloreado)
  *               para borrar la forma anterior en cada monitor correspondiente.
  *            b) Asigna nuevas posiciones como ocupadas y envía comandos DRAW para la nueva forma.
  *            c) Envía REFRESH a todos los monitores.
  *            d) Actualiza prev_x, prev_y y libera memoria de la forma previa rotada.
- *        - Si no puede moverse, descarta la forma rotada actual y repite el paso anterior (i--).
- *        - Cede procesamiento con napms o custom_napms (50 ms) según scheduler_activo.
+ *            e) Incrementa canvas_version, suelta el lock y despierta con canvas_cond a
+ *               las figuras que esperaban posiciones libres.
+ *            f) Envía los comandos encolados con flush_monitors() y espera la liberación
+ *               del siguiente cuadro (my_thread_next_job), cediendo la CPU a los demás hilos.
+ *        - Si no puede moverse, descarta la forma rotada actual, espera a que cambie
+ *          canvas_version (hasta que otra figura se mueva o llegue su deadline) y
+ *          repite el paso (i--).
  *   4) Tras finalizar todos los pasos o llegar a deadline, borra la forma final:
  *        - Libera ocupaciones (free_position) y envía DRAW 'a' para borrar en cada monitor.
  *        - Envía REFRESH final a todos los monitores.
@@ -437,21 +618,12 @@ void animate_shape_server(void *arg) {
         orig_w = MAX(orig_w, (int)strlen(sh->shape_lines[k]));
     }
 
-    struct timeval tv0;
-    gettimeofday(&tv0, NULL);
-    long thread_start_ms = tv0.tv_sec * 1000 + tv0.tv_usec / 1000;
-
-    while (1) {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        long now = tv.tv_sec*1000 + tv.tv_usec/1000;
-        if (now - thread_start_ms >= sh->start_time) break;
-        if (scheduler_activo != 1) napms(10);
-        else custom_napms(10);
-
+    int periodica = my_thread_job_stats(my_thread_self(), NULL, NULL) == 0;
+    if (!periodica) {
+        my_thread_sleep(sh->start_time);
     }
 
-    long deadline_ms = thread_start_ms + sh->start_time + sh->end_time;
+    long deadline_ms = sh->start_ms + sh->start_time + sh->end_time;
 
     int prev_x = sh->x_start;
     int prev_y = sh->y_start;
@@ -461,9 +633,12 @@ void animate_shape_server(void *arg) {
         sh->shape_lines, orig_h, orig_w,
         current_angle, &rot_h_prev, &rot_w_prev
     );
+    if (rotated_prev == NULL) {
+        my_thread_end();    // sin memoria para rotar la forma
+    }
 
 
-    int current_tid = hilo_actual->tid;
+    int current_tid = my_thread_self();
 
 
     for (int i = 0; i < steps; i++) {
@@ -489,20 +664,27 @@ void animate_shape_server(void *arg) {
             sh->shape_lines, orig_h, orig_w,
             current_angle, &rot_h, &rot_w
         );
+        if (rotated == NULL) {
+            break;          // sin memoria: se borra la forma y termina
+        }
 
 
-        int can_move = 1;
-        my_mutex_lock(&canvas_mutex);
-        for (int row = 0; row < rot_h && can_move; row++) {
-            for (int col = 0; col < rot_w; col++) {
-                if (rotated[row][col] != ' ') {
-                    int xx = x_global + col;
-                    int yy = y_global + row;
-                    if (is_position_occupied(&canvas_mutex, xx, yy, current_tid)) {
-                        can_move = 0;
-                        break;
-                    }
-                }
+        my_rwlock_rdlock(&canvas_lock);
+        int can_move = footprint_free(rotated, rot_h, rot_w,
+                                      x_global, y_global, current_tid);
+        unsigned long seen_version = canvas_version;
+        my_rwlock_unlock(&canvas_lock);
+
+        if (can_move) {
+            my_rwlock_wrlock(&canvas_lock);
+            // Si otra figura se movió entre ambos locks hay que volver a verificar
+            if (canvas_version != seen_version) {
+                seen_version = canvas_version;
+                can_move = footprint_free(rotated, rot_h, rot_w,
+                                          x_global, y_global, current_tid);
+            }
+            if (!can_move) {
+                my_rwlock_unlock(&canvas_lock);
             }
         }
 
@@ -514,16 +696,15 @@ void animate_shape_server(void *arg) {
                         int xx_old = prev_x + col;
                         int yy_old = prev_y + row;
 
-                        free_position(&canvas_mutex, xx_old, yy_old, current_tid);
+                        free_position(xx_old, yy_old, current_tid);
 
                         int ancho_por_monitor = global_cfg->width / monitor_count;
                         int m_old = xx_old / ancho_por_monitor;
                         if (m_old < 0) m_old = 0;
                         if (m_old >= monitor_count) m_old = monitor_count - 1;
-                        if (!is_position_occupied(&canvas_mutex,
-                                                  prev_x + col, prev_y + row,
+                        if (!is_position_occupied(prev_x + col, prev_y + row,
                                                   current_tid)) {
-                            send_draw(monitor_socks[m_old], xx_old, yy_old, 'a', sh->color_pair);
+                            send_draw(m_old, xx_old, yy_old, 'a', sh->color_pair);
                         }
                     }
                 }
@@ -535,19 +716,19 @@ void animate_shape_server(void *arg) {
                     if (rotated[row][col] != ' ') {
                         int xx = x_global + col;
                         int yy = y_global + row;
-                        occupy_position(&canvas_mutex, xx, yy, current_tid);
+                        occupy_position(xx, yy, current_tid);
 
                         int ancho_por_monitor = global_cfg->width / monitor_count;
                         int m_new = xx / ancho_por_monitor;
                         if (m_new < 0) m_new = 0;
                         if (m_new >= monitor_count) m_new = monitor_count - 1;
                         char c = rotated[row][col];
-                        send_draw(monitor_socks[m_new], xx, yy, c, sh->color_pair);
+                        send_draw(m_new, xx, yy, c, sh->color_pair);
                     }
                 }
             }
             for (int m = 0; m < monitor_count; m++) {
-                send_refresh(monitor_socks[m]);
+                send_refresh(m);
             }
 
             prev_x = x_global;
@@ -558,38 +739,41 @@ void animate_shape_server(void *arg) {
             rotated_prev = rotated;
             rot_h_prev   = rot_h;
             rot_w_prev   = rot_w;
-
-
+            canvas_version++;
+            my_rwlock_unlock(&canvas_lock);
+            notify_canvas_change();   // posiciones liberadas
+
+            flush_monitors();
+            if (periodica) {
+                my_thread_next_job();
+            } else {
+                my_thread_sleep(FRAME_MS);
+            }
         } else {
 
             for (int k = 0; k < rot_h; k++) free(rotated[k]);
             free(rotated);
             i--;
+            // Espera a que otra figura se mueva o termine (o a su deadline)
+            wait_canvas_change(seen_version, reloj_ms() + (deadline_ms - now_loop));
         }
-        my_mutex_unlock(&canvas_mutex);
-
-
-
-        if (scheduler_activo != 1) napms(50);
-        else custom_napms(50);
     }
-    my_mutex_lock(&canvas_mutex);
+    my_rwlock_wrlock(&canvas_lock);
     for (int row = 0; row < rot_h_prev; row++) {
         for (int col = 0; col < rot_w_prev; col++) {
             if (rotated_prev[row][col] != ' ') {
                 int xx = prev_x + col;
                 int yy = prev_y + row;
-                free_position(&canvas_mutex, xx, yy, current_tid);
+                free_position(xx, yy, current_tid);
 
                 int ancho_por_monitor = global_cfg->width / monitor_count;
                 int m_fin = xx / ancho_por_monitor;
                 if (m_fin < 0) m_fin = 0;
                 if (m_fin >= monitor_count) m_fin = monitor_count - 1;
-                if (!is_position_occupied(&canvas_mutex,
-                                          prev_x + col, prev_y + row,
+                if (!is_position_occupied(prev_x + col, prev_y + row,
                                           current_tid)) {
 
-                    send_draw(monitor_socks[m_fin], xx, yy, 'a', sh->color_pair);
+                    send_draw(m_fin, xx, yy, 'a', sh->color_pair);
 
                 }
             }
@@ -597,9 +781,12 @@ void animate_shape_server(void *arg) {
     }
 
     for (int m = 0; m < monitor_count; m++) {
-        send_refresh(monitor_socks[m]);
+        send_refresh(m);
     }
-    my_mutex_unlock(&canvas_mutex);
+    canvas_version++;
+    my_rwlock_unlock(&canvas_lock);
+    notify_canvas_change();
+    flush_monitors();
 
     for (int k = 0; k < rot_h_prev; k++) free(rotated_prev[k]);
     free(rotated_prev);
@@ -618,16 +805,26 @@ void animate_shape_server(void *arg) {
  *   3) Crea sockets y espera conexiones de monitores (monitor_count conexiones).
  *   4) Envía a cada monitor su región (REGION x_off w h).
  *   5) Asigna un par de colores (color_pair) distinto a cada ShapeConfig.
- *   6) Inicializa el mutex del canvas y el scheduler EDF.
- *   7) Crea hilos para cada forma (animate_shape_server) y dos hilos extra que
- *      cambiarán el planificador a RR y a Lottery en tiempos específicos.
+ *   6) Inicializa el mutex del canvas y el scheduler EDF, y precalienta el pool
+ *      de TCB con una pila por cada hilo que se va a crear.
+ *   7) Crea una tarea periódica por forma (animate_shape_server, un cuadro cada
+ *      FRAME_MS desde su start_time; si no pasa el control de admisión, un hilo
+ *      común) y dos hilos extra que cambiarán el planificador a RR y a Lottery en
+ *      tiempos específicos.
  *   8) Inicia la primera rutina del scheduler EDF y cede el contexto al primer hilo.
- *   9) Al terminar todos los hilos, envía "END" a cada monitor y cierra los sockets.
+ *      Si se pidieron varios workers, en su lugar reparte los hilos entre kernel
+ *      threads con el runtime M:N (sin los hilos de cambio de planificador).
+ *   9) Al terminar todos los hilos, muestra las inversiones de prioridad evitadas por
+ *      los mutex (y el uso de pila por función si se pidió medirlo), envía "END"
+ *      a cada monitor y cierra los sockets.
  *
  * Entradas:
  *   argc, argv:
  *     argc debe ser ≥ 2 (nombre_programa, config.ini).
  *     argv[1] = ruta al archivo de configuración INI.
+ *     argv[2] = (opcional) cantidad de workers del runtime M:N; por defecto 1.
+ *     argv[3] = (opcional) "medir" para medir el uso de pila de los hilos, o
+ *               "auto" para además ajustar las pilas a lo medido.
  *
  * Retorna:
  *   int – 0 si finaliza correctamente, 1 si ocurre algún error en:
@@ -639,9 +836,13 @@ int main(int argc, char *argv[]) {
     }
 
     if (argc < 2) {
-        fprintf(stderr, "Uso: %s config.ini\n", argv[0]);
+        fprintf(stderr, "Uso: %s config.ini [workers] [medir|auto]\n", argv[0]);
         return 1;
     }
+    int workers = (argc > 2) ? atoi(argv[2]) : 1;
+    if (argc > 3) {
+        pila_perfil_modo(strcmp(argv[3], "auto") == 0 ? PILA_PERFIL_AUTO : PILA_PERFIL_MEDIR);
+    }
 
 
     global_cfg = load_config(argv[1]);
@@ -657,6 +858,10 @@ int main(int argc, char *argv[]) {
 
     monitor_count = global_cfg->monitor_count;
     monitor_socks = malloc(sizeof(int) * monitor_count);
+    monitor_salidas = calloc(monitor_count, sizeof(SalidaMonitor));
+    for (int i = 0; i < monitor_count; i++) {
+        my_mutex_init(&monitor_salidas[i].mutex);
+    }
 
     int server_sock = socket(AF_INET, SOCK_STREAM, 0);
     if (server_sock < 0) { perror("socket"); return 1; }
@@ -677,9 +882,9 @@ int main(int argc, char *argv[]) {
     for (int i = 0; i < monitor_count; i++) {
         struct sockaddr_in cli_addr;
         socklen_t cli_len = sizeof(cli_addr);
-        monitor_socks[i] = accept(server_sock,
-                                  (struct sockaddr*)&cli_addr,
-                                  &cli_len);
+        monitor_socks[i] = my_thread_accept(server_sock,
+                                            (struct sockaddr*)&cli_addr,
+                                            &cli_len);
         if (monitor_socks[i] < 0) {
             perror("accept"); return 1;
         }
@@ -710,9 +915,17 @@ int main(int argc, char *argv[]) {
         global_cfg->shapes[i].color_pair = i + 1;
     }
 
+    scratch_init();
+    my_rwlock_init(&canvas_lock);
     my_mutex_init(&canvas_mutex);
+    my_cond_init(&canvas_cond);
 
     edf_scheduler_init(&edf);
+    tcb_pool_precalentar((size_t)global_cfg->shape_count + 2);
+    if (workers > 1 && mn_runtime_iniciar(workers) != 0) {
+        fprintf(stderr, "No se pudo iniciar el runtime M:N\n");
+        return 1;
+    }
 
 
     struct timeval tv;
@@ -724,39 +937,89 @@ int main(int argc, char *argv[]) {
         ShapeConfig *sh = &global_cfg->shapes[i];
         sh->start_ms = global_start_ms;
 
-        my_thread_create(
-            animate_shape_server,
-            sh,
+        my_thread_attr_t attr;
+        my_thread_attr_init(&attr);
+        attr.scheduler = (Scheduler*)&edf;
+        attr.nombre    = sh->name;
+        attr.tickets   = sh->tickets;
+        attr.periodo_ms = FRAME_MS;
+        attr.desfase_ms = sh->start_time;
+        attr.wcet_ms    = FRAME_WCET_MS;
+        int tid = my_thread_create_attr(animate_shape_server, sh, &attr);
+        if (tid < 0) {
+            // No cabe en el control de admisión: se anima sin garantía de plazos
+            printf("Figura %s no admitida como tarea periódica\n", sh->name);
+            attr.periodo_ms = 0;
+            attr.deadline   = (long)(reloj_ms() + sh->start_time + sh->end_time);
+            tid = my_thread_create_attr(animate_shape_server, sh, &attr);
+        }
+        my_thread_detach(tid);   // nadie hace join: se recicla al terminar
+    }
+
+    if (modo_mn) {
+        mn_runtime_ejecutar();
+    } else {
+        my_thread_detach(my_thread_create(
+            switch_to_rr,
+            NULL,
             (Scheduler*)&edf,
-            sh->tickets,
             0,
-            sh->end_time
-        );
-    }
+            0,
+            (long)(reloj_ms() + 4000)
+        ));
 
-    my_thread_create(
-        switch_to_rr,
-        NULL,
-        (Scheduler*)&edf,
-        0,
-        0,
-        4000
-    );
 
+        my_thread_detach(my_thread_create(
+            switch_to_lottery,
+            NULL,
+            (Scheduler*)&edf,
+            0,
+            0,
+            (long)(reloj_ms() + 5000)
+        ));
 
-    my_thread_create(
-        switch_to_lottery,
-        NULL,
-        (Scheduler*)&edf,
-        0,
-        0,
-        5000
-    );
+        TCB *first = edf.base.siguiente_hilo((Scheduler*)&edf);
+        hilo_actual = first;
+        swapcontext(&scheduler_ctx, &hilo_actual->context);
+    }
 
-    TCB *first = edf.base.siguiente_hilo((Scheduler*)&edf);
-    hilo_actual = first;
-    swapcontext(&scheduler_ctx, &hilo_actual->context);
 
+    printf("Inversiones de prioridad evitadas: %ld\n", my_mutex_inversiones_evitadas());
+    printf("Desalojos aplazados a un punto seguro: %ld\n", desalojos_aplazados());
+
+    long trabajos, plazos_perdidos;
+    my_thread_estadisticas_rt(&trabajos, &plazos_perdidos);
+    printf("Cuadros periódicos: %ld, plazos perdidos: %ld\n", trabajos, plazos_perdidos);
+
+    EstadisticasQuantum eq;
+    estadisticas_quantum(&eq);
+    printf("Alarmas del quantum: %lld (retraso medio %.1f us, máximo %.1f us), "
+           "despachos sin alarma: %lld\n",
+           eq.alarmas,
+           eq.alarmas ? eq.retraso_total_ns / 1000.0 / eq.alarmas : 0.0,
+           eq.retraso_max_ns / 1000.0,
+           eq.desarmados);
+
+    EstadisticasDesalojo ed;
+    estadisticas_desalojo(&ed);
+    printf("Desalojos por deadline: %lld (latencia media %.1f us, máxima %.1f us)\n",
+           ed.desalojos,
+           ed.desalojos ? ed.latencia_total_ns / 1000.0 / ed.desalojos : 0.0,
+           ed.latencia_max_ns / 1000.0);
+
+    PerfilPila perfiles[8];
+    int n_perfiles = pila_perfiles(perfiles, 8);
+    for (int i = 0; i < n_perfiles; i++) {
+        void (*f)(void*) = perfiles[i].funcion;
+        printf("Pila de %s: %ld hilos, pico medio %zu B, máximo %zu B, reservada %zu B\n",
+               f == animate_shape_server ? "animate_shape_server" :
+               f == switch_to_rr         ? "switch_to_rr" :
+               f == switch_to_lottery    ? "switch_to_lottery" : "?",
+               perfiles[i].hilos,
+               perfiles[i].pico_total / (size_t)perfiles[i].hilos,
+               perfiles[i].pico_max,
+               perfiles[i].pila_tam);
+    }
 
     for (int i = 0; i < monitor_count; i++) {
         send_line(monitor_socks[i], "END\n");
@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/my_pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Herencia de prioridad en RMS: un hilo de prioridad baja toma el mutex, uno
+ * de prioridad media despierta y calcula sin ceder el CPU, y uno de prioridad
+ * alta despierta después y se bloquea en el mutex. El dueño debe heredar la
+ * prioridad alta, desalojar al de media y soltar el mutex antes de que este
+ * termine; sin herencia el de alta esperaría todo el cálculo del de media
+ * (inversión de prioridad no acotada).
+ *
+ * Uso: test_herencia_rms (retorna 0 si pasa)
+ */
+
+#define BAJA_MS     30      // el dueño retiene el mutex hasta este instante
+#define MEDIA_MS    10      // el de media despierta aquí...
+#define MEDIA_DURA  300     // ...y calcula durante este tiempo
+#define ALTA_MS     20      // el de alta despierta aquí y pide el mutex
+
+static RMS_Scheduler rms;
+static my_mutex mutex;
+static long long inicio;
+static volatile int media_termino = 0;
+static volatile int alta_con_media_activa = -1;
+static volatile int prioridad_prestada = -1;
+
+static long long transcurrido(void) {
+    return reloj_ms() - inicio;
+}
+
+static void baja(void *arg) {
+    (void)arg;
+    my_mutex_lock(&mutex);
+    while (transcurrido() < BAJA_MS) {
+        // calcula sin ceder: solo el de media (o la herencia) lo interrumpe
+    }
+    prioridad_prestada = hilo_actual->priority;
+    my_mutex_unlock(&mutex);
+}
+
+static void media(void *arg) {
+    (void)arg;
+    my_thread_sleep(MEDIA_MS);
+    long long fin = transcurrido() + MEDIA_DURA;
+    while (transcurrido() < fin) {
+        // spinner: nunca cede el CPU
+    }
+    media_termino = 1;
+}
+
+static void alta(void *arg) {
+    (void)arg;
+    my_thread_sleep(ALTA_MS);
+    my_mutex_lock(&mutex);
+    alta_con_media_activa = !media_termino;
+    my_mutex_unlock(&mutex);
+}
+
+int main(void) {
+    if (getcontext(&scheduler_ctx) == -1) {
+        perror("getcontext scheduler");
+        return 1;
+    }
+    rms_scheduler_init(&rms, 0);
+    my_mutex_init(&mutex);
+    inicio = reloj_ms();
+    // El de alta y el de media arrancan durmiendo: el de baja toma el mutex primero
+    if (my_thread_create(alta, NULL, (Scheduler*)&rms, 1, 0, 0) < 0 ||
+        my_thread_create(media, NULL, (Scheduler*)&rms, 1, 5, 0) < 0 ||
+        my_thread_create(baja, NULL, (Scheduler*)&rms, 1, 10, 0) < 0) {
+        fprintf(stderr, "No se pudieron crear los hilos\n");
+        return 1;
+    }
+
+    hilo_actual = rms.base.siguiente_hilo((Scheduler*)&rms);
+    swapcontext(&scheduler_ctx, &hilo_actual->context);
+
+    int ok = alta_con_media_activa == 1 && prioridad_prestada == 0;
+    printf("%s: prioridad del dueño al soltar = %d (esperada 0), "
+           "el de alta tomó el mutex %s que terminara el de media\n",
+           ok ? "ok" : "FALLO", prioridad_prestada,
+           alta_con_media_activa == 1 ? "antes de" : "después de");
+    return ok ? 0 : 1;
+}